@@ -0,0 +1,61 @@
+#include "accelerator.h"
+
+#include "intersection.h"
+
+BVHAccel::BVHAccel(const std::vector<std::shared_ptr<Primitive> >& primitives)
+    : Primitive(std::shared_ptr<Material>()), primitives(primitives)
+{
+    rebuild();
+}
+
+BVHAccel::~BVHAccel()
+{}
+
+void BVHAccel::rebuild()
+{
+    std::vector<BBox> bounds(primitives.size());
+    for (size_t i = 0; i < primitives.size(); ++i)
+        bounds[i] = primitives[i]->worldBound();
+
+    bvh.build(bounds, 1);
+}
+
+const BVH& BVHAccel::hierarchy() const
+{
+    return bvh;
+}
+
+bool BVHAccel::intersectNearest(const TraversalRay& ray, SurfaceHit& hit)
+{
+    bool found = false;
+    bvh.intersect(ray, hit.t, [&](uint32_t i) {
+        if (primitives[i]->intersectNearest(ray, hit))
+            found = true;
+    });
+
+    return found;
+}
+
+bool BVHAccel::intersectP(const TraversalRay& ray)
+{
+    return bvh.intersectP(ray, ray.tMax, [&](uint32_t i) {
+        return primitives[i]->intersectP(ray);
+    });
+}
+
+uint64_t BVHAccel::intersectPacketP(const ShadowPacket& packet, uint64_t active)
+{
+    return bvh.intersectP(packet, active, [&](uint32_t i, uint64_t mask) {
+        return primitives[i]->intersectPacketP(packet, mask);
+    });
+}
+
+size_t BVHAccel::memoryUsage() const
+{
+    return sizeof(*this) + bvh.memoryUsage() + primitives.size() * sizeof(primitives[0]);
+}
+
+BBox BVHAccel::worldBound() const
+{
+    return bvh.bounds();
+}
@@ -0,0 +1,47 @@
+#ifndef ACCELERATOR_H
+#define ACCELERATOR_H
+
+#include <memory>
+#include <vector>
+
+#include "core.h"
+
+#include "bvh.h"
+#include "primitive.h"
+
+/*!
+ * Agregat primitiv urychleny pomoci BVH. Slouzi jako horni uroven
+ * nad instancemi objektu; po presunu instanci staci zavolat rebuild().
+ */
+class BVHAccel : public Primitive
+{
+public:
+    /*!
+     * Konstruktor, postavi hierarchii nad zadanymi primitivy.
+     * \param primitives primitiva agregatu
+     */
+    explicit BVHAccel(const std::vector<std::shared_ptr<Primitive> >& primitives);
+    virtual ~BVHAccel();
+
+    virtual bool intersectNearest(const TraversalRay& ray, SurfaceHit& hit);
+    virtual bool intersectP(const TraversalRay& ray);
+    virtual uint64_t intersectPacketP(const ShadowPacket& packet, uint64_t active);
+    virtual BBox worldBound() const;
+    virtual size_t memoryUsage() const;
+
+    /*!
+     * Znovu postavi hierarchii podle aktualnich obalovych kvadru primitiv.
+     */
+    void rebuild();
+
+    /*!
+     * Hierarchie agregatu.
+     */
+    const BVH& hierarchy() const;
+
+private:
+    std::vector<std::shared_ptr<Primitive> > primitives;
+    BVH bvh;
+};
+
+#endif // ACCELERATOR_H
@@ -0,0 +1,114 @@
+#include "budget.h"
+
+#include <algorithm>
+#include <functional>
+#include <utility>
+
+namespace {
+
+size_t reverseBits(size_t value, unsigned int bits)
+{
+    size_t result = 0;
+    for (unsigned int i = 0; i < bits; ++i, value >>= 1)
+        result = (result << 1) | (value & 1);
+    return result;
+}
+
+}
+
+SampleBudget::SampleBudget(size_t tileCount, unsigned int maxSamples)
+    : tiles(tileCount), maxSamples(std::max(maxSamples, BUDGET_MIN_SAMPLES))
+{
+    for (size_t t = 0; t < tiles.size(); ++t) {
+        tiles[t].samples = 0;
+        tiles[t].time = 0.0;
+        tiles[t].error = 0.0;
+    }
+}
+
+void SampleBudget::record(size_t tile, unsigned int samples, double seconds)
+{
+    tiles[tile].samples += samples;
+    tiles[tile].time += seconds;
+}
+
+void SampleBudget::setError(size_t tile, double error)
+{
+    tiles[tile].error = error;
+}
+
+std::vector<SampleJob> SampleBudget::plan(double cpuTime) const
+{
+    std::vector<SampleJob> jobs;
+
+    //bez dvou vzorku nelze odhadnout chybu; po jednom vzorku na kolo, aby se
+    //pri kratkem limitu nejdrive pokryl cely obraz. Dlazdice jdou v poradi
+    //bitove obraceneho indexu, takze i neuplne kolo pokryje obraz rovnomerne
+    //a ne jen jeho horni cast.
+    unsigned int bits = 0;
+    while ((size_t(1) << bits) < tiles.size())
+        ++bits;
+
+    for (unsigned int n = 0; n < BUDGET_MIN_SAMPLES && jobs.empty(); ++n) {
+        for (size_t k = 0; k < (size_t(1) << bits); ++k) {
+            const size_t t = reverseBits(k, bits);
+            if (t < tiles.size() && tiles[t].samples == n) {
+                SampleJob job = { t, 1 };
+                jobs.push_back(job);
+            }
+        }
+    }
+    if (!jobs.empty())
+        return jobs;
+
+    //ubytek chyby jednim dalsim vzorkem je error / (n + 1), vztazeny na cenu pruchodu
+    std::vector<std::pair<double, size_t> > order;
+    for (size_t t = 0; t < tiles.size(); ++t) {
+        const TileState& s = tiles[t];
+        if (s.samples >= maxSamples || s.error <= 0.0)
+            continue;
+
+        order.push_back(std::make_pair(s.error / (s.samples + 1) / std::max(passCost(t), 1e-9), t));
+    }
+    std::sort(order.begin(), order.end(), std::greater<std::pair<double, size_t> >());
+
+    double budget = cpuTime;
+    for (size_t i = 0; i < order.size() && budget > 0.0; ++i) {
+        const size_t t = order[i].second;
+        const TileState& s = tiles[t];
+        const double cost = std::max(passCost(t), 1e-9);
+
+        //pocet vzorku roste geometricky, aby kol nebylo prilis mnoho
+        unsigned int step = std::min(std::max(s.samples / 2, 1u), maxSamples - s.samples);
+        step = static_cast<unsigned int>(std::min<double>(step, budget / cost));
+        if (step == 0)
+            continue;
+
+        SampleJob job = { t, step };
+        jobs.push_back(job);
+        budget -= step * cost;
+    }
+
+    return jobs;
+}
+
+unsigned int SampleBudget::samples(size_t tile) const
+{
+    return tiles[tile].samples;
+}
+
+double SampleBudget::passCost(size_t tile) const
+{
+    const TileState& s = tiles[tile];
+    return s.samples > 0 ? s.time / s.samples : 0.0;
+}
+
+double SampleBudget::error(size_t tile) const
+{
+    return tiles[tile].error;
+}
+
+size_t SampleBudget::tileCount() const
+{
+    return tiles.size();
+}
@@ -0,0 +1,138 @@
+#ifndef BUDGET_H
+#define BUDGET_H
+
+/*!
+ * \file
+ * Rozdelovani vzorku mezi dlazdice pri renderovani s casovym limitem.\n
+ * Kazda dlazdice si pamatuje pocet vzorku na pixel, cas, ktery na ni vlakna
+ * stravila, a odhad zbyvajici chyby. Planovac v kazdem kole rozdeli cast
+ * zbyvajiciho casu tem dlazdicim, u kterych dalsi vzorek odstrani nejvic
+ * chyby za jednotku casu.
+ */
+
+#include <cstddef>
+#include <vector>
+
+#include "core.h"
+
+#include "color.h"
+
+const unsigned int BUDGET_MIN_SAMPLES = 2; ///< vzorku na pixel, nez lze odhadnout rozptyl
+const unsigned int BUDGET_MAX_SAMPLES = 1024; ///< vychozi horni mez vzorku na pixel
+
+/*!
+ * Soucty vzorku jednoho pixelu pro prumer a odhad rozptylu.
+ */
+struct PixelMoments {
+    PixelMoments()
+        : lum(0.0), lum2(0.0)
+    {}
+
+    /*!
+     * \brief Prida vzorek.
+     */
+    void add(const RGBColor& c)
+    {
+        const double y = 0.2126 * c.r + 0.7152 * c.g + 0.0722 * c.b;
+        sum += c;
+        lum += y;
+        lum2 += y * y;
+    }
+
+    /*!
+     * \brief Relativni stredni kvadraticka chyba prumeru n vzorku (odhad z vyberoveho rozptylu jasu).
+     * \param n pocet vzorku
+     */
+    double error(unsigned int n) const
+    {
+        if (n < 2)
+            return 0.0;
+
+        const double mean = lum / n;
+        const double variance = std::max(0.0, (lum2 - lum * mean) / (n - 1));
+        //konstanta ve jmenovateli brani tomu, aby tmave pixely dominovaly
+        return variance / n / (mean * mean + 1e-3);
+    }
+
+    RGBColor sum; ///< soucet barev
+    double lum; ///< soucet jasu
+    double lum2; ///< soucet druhych mocnin jasu
+};
+
+/*!
+ * Prace jednoho vlakna v kole: dalsi vzorky vsech pixelu jedne dlazdice.
+ */
+struct SampleJob {
+    size_t tile; ///< index dlazdice
+    unsigned int samples; ///< pocet pridanych vzorku na pixel
+};
+
+/*!
+ * Planovac vzorku pro render s casovym limitem.
+ */
+class SampleBudget
+{
+public:
+    /*!
+     * \brief Konstruktor.
+     * \param tileCount pocet dlazdic
+     * \param maxSamples horni mez vzorku na pixel
+     */
+    SampleBudget(size_t tileCount, unsigned int maxSamples = BUDGET_MAX_SAMPLES);
+
+    /*!
+     * \brief Zaznamena dokonceny pruchod dlazdici. Pro jednu dlazdici smi
+     * v jednom okamziku volat jen jedno vlakno.
+     * \param tile index dlazdice
+     * \param samples pocet pridanych vzorku na pixel
+     * \param seconds doba pruchodu
+     */
+    void record(size_t tile, unsigned int samples, double seconds);
+
+    /*!
+     * \brief Nastavi odhad chyby dlazdice (soucet PixelMoments::error pres pixely).
+     */
+    void setError(size_t tile, double error);
+
+    /*!
+     * \brief Naplanuje dalsi kolo. Dokud nema kazda dlazdice BUDGET_MIN_SAMPLES
+     * vzorku, dostane kazda v kazdem kole jeden, a to v poradi rozptylenem po
+     * celem obrazu (bitove obraceny index dlazdice). Potom se dlazdice radi podle ubytku chyby na
+     * sekundu a vybiraji se, dokud se nevycerpa rozpocet kola.
+     * \param cpuTime rozpocet kola v sekundach prace vsech vlaken
+     * \return prace kola, nejvyse jedna pro kazdou dlazdici (prazdne = neni co delat)
+     */
+    std::vector<SampleJob> plan(double cpuTime) const;
+
+    /*!
+     * \brief Pocet vzorku na pixel dlazdice.
+     */
+    unsigned int samples(size_t tile) const;
+
+    /*!
+     * \brief Prumerna doba jednoho pruchodu dlazdici (0 = zatim nemereno).
+     */
+    double passCost(size_t tile) const;
+
+    /*!
+     * \brief Odhad chyby dlazdice.
+     */
+    double error(size_t tile) const;
+
+    /*!
+     * \brief Pocet dlazdic.
+     */
+    size_t tileCount() const;
+
+private:
+    struct TileState {
+        unsigned int samples; ///< vzorku na pixel
+        double time; ///< celkova doba vsech pruchodu
+        double error; ///< soucet chyb pixelu
+    };
+
+    std::vector<TileState> tiles;
+    unsigned int maxSamples;
+};
+
+#endif // BUDGET_H
@@ -0,0 +1,455 @@
+#include "bvh.h"
+
+#include <algorithm>
+#include <limits>
+#include <thread>
+
+namespace {
+
+const int BIN_COUNT = 16; ///< pocet binu v kazde ose
+const float TRAVERSAL_COST = 0.125f; ///< cena pruchodu uzlem vuci testu prvku
+const size_t PARALLEL_THRESHOLD = 1 << 15; ///< od tohoto poctu prvku se binuje a deli paralelne
+const size_t TASK_THRESHOLD = 1 << 12; ///< od tohoto poctu prvku se podstrom stavi jako uloha
+const size_t MAX_LEAF_COUNT = std::numeric_limits<uint16_t>::max();
+//od teto hloubky se deli medianem, do BVH_MAX_DEPTH tak zbyva 20 puleni a list
+//ma nejvyse 2^32 / 2^20 prvku, coz se vejde do MAX_LEAF_COUNT
+const size_t MEDIAN_DEPTH = BVH_MAX_DEPTH - 20;
+
+struct BuildItem {
+    BBox bounds;
+    Point centroid;
+    uint32_t index;
+};
+
+/*!
+ * Obalove kvadry a pocty prvku v binech vsech tri os.
+ */
+struct Bins {
+    BBox bounds[3][BIN_COUNT];
+    uint32_t count[3][BIN_COUNT];
+
+    Bins()
+    {
+        std::fill(&count[0][0], &count[0][0] + 3 * BIN_COUNT, 0);
+    }
+
+    void merge(const Bins& other)
+    {
+        for (int axis = 0; axis < 3; ++axis) {
+            for (int i = 0; i < BIN_COUNT; ++i) {
+                bounds[axis][i].expand(other.bounds[axis][i]);
+                count[axis][i] += other.count[axis][i];
+            }
+        }
+    }
+};
+
+/*!
+ * Zvolene deleni uzlu.
+ */
+struct Split {
+    int axis;
+    int bin; ///< prvky v binech <= bin jdou do prvniho potomka
+    float cost;
+};
+
+/*!
+ * \brief Rozdeli interval [0, count) na souvisle useky a zpracuje je na vlaknech.
+ * Prvni usek zpracuje volajici vlakno.
+ * \param f funkce (index useku, zacatek, konec)
+ */
+template<class F>
+void parallelFor(size_t count, size_t threads, F f)
+{
+    const size_t chunks = std::max<size_t>(1, std::min(threads, count));
+    std::vector<std::thread> workers;
+
+    for (size_t c = 1; c < chunks; ++c)
+        workers.push_back(std::thread(f, c, count * c / chunks, count * (c + 1) / chunks));
+
+    f(0, 0, count / chunks);
+
+    for (size_t i = 0; i < workers.size(); ++i)
+        workers[i].join();
+}
+
+inline int binIndex(const Point& centroid, const BBox& centroidBounds, int axis)
+{
+    const float extent = centroidBounds.pMax[axis] - centroidBounds.pMin[axis];
+    const int b = static_cast<int>(BIN_COUNT * ((centroid[axis] - centroidBounds.pMin[axis]) / extent));
+    return std::max(0, std::min(b, BIN_COUNT - 1));
+}
+
+/*!
+ * Stavba BVH. Kazda uloha stavi podstrom do vlastnich poli uzlu a indexu,
+ * ktere se po dokonceni pripoji za rodice. Useky pole prvku zpracovavane
+ * soubezne se neprekryvaji.
+ */
+class Builder
+{
+public:
+    Builder(std::vector<BuildItem>& items, size_t maxLeafSize)
+        : items(items), maxLeafSize(maxLeafSize)
+    {}
+
+    void build(size_t begin, size_t end, size_t threads, size_t depth,
+               std::vector<BVHNode>& nodes, std::vector<uint32_t>& indices);
+
+private:
+    void computeBounds(size_t begin, size_t end, size_t threads, BBox& bounds, BBox& centroidBounds) const;
+    bool findSplit(size_t begin, size_t end, size_t threads, const BBox& bounds,
+                   const BBox& centroidBounds, Split& split) const;
+    size_t partition(size_t begin, size_t end, size_t threads, const Split& split,
+                     const BBox& centroidBounds);
+    void makeLeaf(BVHNode& node, const BBox& bounds, size_t begin, size_t end,
+                  std::vector<uint32_t>& indices) const;
+    static void append(std::vector<BVHNode>& nodes, std::vector<uint32_t>& indices,
+                       const std::vector<BVHNode>& subNodes, const std::vector<uint32_t>& subIndices);
+
+private:
+    std::vector<BuildItem>& items;
+    size_t maxLeafSize;
+};
+
+void Builder::computeBounds(size_t begin, size_t end, size_t threads,
+                            BBox& bounds, BBox& centroidBounds) const
+{
+    const size_t count = end - begin;
+    if (threads < 2 || count < PARALLEL_THRESHOLD) {
+        for (size_t i = begin; i < end; ++i) {
+            bounds.expand(items[i].bounds);
+            centroidBounds.expand(items[i].centroid);
+        }
+        return;
+    }
+
+    std::vector<BBox> partial(2 * threads);
+    parallelFor(count, threads, [&](size_t c, size_t from, size_t to) {
+        for (size_t i = begin + from; i < begin + to; ++i) {
+            partial[2 * c].expand(items[i].bounds);
+            partial[2 * c + 1].expand(items[i].centroid);
+        }
+    });
+
+    for (size_t c = 0; c < threads; ++c) {
+        bounds.expand(partial[2 * c]);
+        centroidBounds.expand(partial[2 * c + 1]);
+    }
+}
+
+bool Builder::findSplit(size_t begin, size_t end, size_t threads, const BBox& bounds,
+                        const BBox& centroidBounds, Split& split) const
+{
+    const size_t count = end - begin;
+
+    auto binRange = [&](Bins& bins, size_t from, size_t to) {
+        for (size_t i = from; i < to; ++i) {
+            for (int axis = 0; axis < 3; ++axis) {
+                if (centroidBounds.pMax[axis] == centroidBounds.pMin[axis])
+                    continue;
+                const int b = binIndex(items[i].centroid, centroidBounds, axis);
+                bins.bounds[axis][b].expand(items[i].bounds);
+                ++bins.count[axis][b];
+            }
+        }
+    };
+
+    Bins bins;
+    if (threads < 2 || count < PARALLEL_THRESHOLD) {
+        binRange(bins, begin, end);
+    } else {
+        std::vector<Bins> partial(threads);
+        parallelFor(count, threads, [&](size_t c, size_t from, size_t to) {
+            binRange(partial[c], begin + from, begin + to);
+        });
+        for (size_t c = 0; c < threads; ++c)
+            bins.merge(partial[c]);
+    }
+
+    const float invArea = 1.f / std::max(bounds.surfaceArea(), std::numeric_limits<float>::min());
+    bool found = false;
+
+    for (int axis = 0; axis < 3; ++axis) {
+        if (centroidBounds.pMax[axis] == centroidBounds.pMin[axis])
+            continue;
+
+        //povrch a pocet prvku vpravo od kazde hranice
+        float rightArea[BIN_COUNT];
+        uint32_t rightCount[BIN_COUNT];
+        BBox right;
+        uint32_t n = 0;
+        for (int i = BIN_COUNT - 1; i > 0; --i) {
+            right.expand(bins.bounds[axis][i]);
+            n += bins.count[axis][i];
+            rightArea[i] = right.surfaceArea();
+            rightCount[i] = n;
+        }
+
+        BBox left;
+        n = 0;
+        for (int i = 0; i < BIN_COUNT - 1; ++i) {
+            left.expand(bins.bounds[axis][i]);
+            n += bins.count[axis][i];
+            if (n == 0 || rightCount[i + 1] == 0)
+                continue;
+
+            const float cost = TRAVERSAL_COST
+                               + (n * left.surfaceArea() + rightCount[i + 1] * rightArea[i + 1]) * invArea;
+            if (!found || cost < split.cost) {
+                split.axis = axis;
+                split.bin = i;
+                split.cost = cost;
+                found = true;
+            }
+        }
+    }
+
+    return found;
+}
+
+size_t Builder::partition(size_t begin, size_t end, size_t threads, const Split& split,
+                          const BBox& centroidBounds)
+{
+    auto isLeft = [&](const BuildItem& item) {
+        return binIndex(item.centroid, centroidBounds, split.axis) <= split.bin;
+    };
+
+    const size_t count = end - begin;
+    if (threads < 2 || count < PARALLEL_THRESHOLD)
+        return std::partition(items.begin() + begin, items.begin() + end, isLeft) - items.begin();
+
+    //kazdy usek se rozdeli zvlast, leve a prave casti se pak poskladaji za sebe
+    std::vector<size_t> chunkBegin(threads + 1), leftCount(threads);
+    parallelFor(count, threads, [&](size_t c, size_t from, size_t to) {
+        chunkBegin[c] = begin + from;
+        leftCount[c] = std::partition(items.begin() + begin + from, items.begin() + begin + to, isLeft)
+                       - (items.begin() + begin + from);
+    });
+    chunkBegin[threads] = end;
+
+    std::vector<size_t> leftOffset(threads), rightOffset(threads);
+    size_t totalLeft = 0;
+    for (size_t c = 0; c < threads; ++c) {
+        leftOffset[c] = totalLeft;
+        totalLeft += leftCount[c];
+    }
+    size_t right = totalLeft;
+    for (size_t c = 0; c < threads; ++c) {
+        rightOffset[c] = right;
+        right += chunkBegin[c + 1] - chunkBegin[c] - leftCount[c];
+    }
+
+    std::vector<BuildItem> scratch(count);
+    parallelFor(threads, threads, [&](size_t, size_t from, size_t to) {
+        for (size_t c = from; c < to; ++c) {
+            const size_t mid = chunkBegin[c] + leftCount[c];
+            std::copy(items.begin() + chunkBegin[c], items.begin() + mid, scratch.begin() + leftOffset[c]);
+            std::copy(items.begin() + mid, items.begin() + chunkBegin[c + 1], scratch.begin() + rightOffset[c]);
+        }
+    });
+    parallelFor(count, threads, [&](size_t, size_t from, size_t to) {
+        std::copy(scratch.begin() + from, scratch.begin() + to, items.begin() + begin + from);
+    });
+
+    return begin + totalLeft;
+}
+
+void Builder::makeLeaf(BVHNode& node, const BBox& bounds, size_t begin, size_t end,
+                       std::vector<uint32_t>& indices) const
+{
+    node.bounds = bounds;
+    node.offset = static_cast<uint32_t>(indices.size());
+    node.count = static_cast<uint16_t>(end - begin);
+    node.axis = 0;
+
+    for (size_t i = begin; i < end; ++i)
+        indices.push_back(items[i].index);
+}
+
+void Builder::append(std::vector<BVHNode>& nodes, std::vector<uint32_t>& indices,
+                     const std::vector<BVHNode>& subNodes, const std::vector<uint32_t>& subIndices)
+{
+    const uint32_t nodeBase = static_cast<uint32_t>(nodes.size());
+    const uint32_t indexBase = static_cast<uint32_t>(indices.size());
+
+    for (size_t i = 0; i < subNodes.size(); ++i) {
+        BVHNode node = subNodes[i];
+        node.offset += node.count > 0 ? indexBase : nodeBase;
+        nodes.push_back(node);
+    }
+
+    indices.insert(indices.end(), subIndices.begin(), subIndices.end());
+}
+
+void Builder::build(size_t begin, size_t end, size_t threads, size_t depth,
+                    std::vector<BVHNode>& nodes, std::vector<uint32_t>& indices)
+{
+    const uint32_t nodeIndex = static_cast<uint32_t>(nodes.size());
+    nodes.push_back(BVHNode());
+
+    BBox bounds, centroidBounds;
+    computeBounds(begin, end, threads, bounds, centroidBounds);
+
+    const size_t count = end - begin;
+
+    //v nejvetsi hloubce vzdy list, zasobniky pruchodu vic urovni nepojmou
+    if (depth >= BVH_MAX_DEPTH || (depth >= MEDIAN_DEPTH && count <= maxLeafSize)) {
+        makeLeaf(nodes[nodeIndex], bounds, begin, end, indices);
+        return;
+    }
+
+    Split split;
+    const bool canSplit = count > 1 && depth < MEDIAN_DEPTH
+                          && findSplit(begin, end, threads, bounds, centroidBounds, split);
+
+    //list, pokud je deleni drazsi nez test vsech prvku nebo nejde rozdelit
+    if (count <= MAX_LEAF_COUNT && depth < MEDIAN_DEPTH
+            && (!canSplit || (count <= maxLeafSize && split.cost >= count))) {
+        makeLeaf(nodes[nodeIndex], bounds, begin, end, indices);
+        return;
+    }
+
+    size_t mid = canSplit ? partition(begin, end, threads, split, centroidBounds) : begin;
+    if (mid == begin || mid == end) {
+        //vsechny stredy v jednom binu (nebo v jednom bode), deli se na poloviny
+        mid = begin + count / 2;
+        split.axis = centroidBounds.maximumExtent();
+        std::nth_element(items.begin() + begin, items.begin() + mid, items.begin() + end,
+                         [&split](const BuildItem& a, const BuildItem& b) {
+                             return a.centroid[split.axis] < b.centroid[split.axis];
+                         });
+    }
+
+    uint32_t second;
+    if (threads > 1 && count >= TASK_THRESHOLD) {
+        //prvni podstrom na novem vlakne, druhy na aktualnim
+        const size_t firstThreads = threads / 2;
+        std::vector<BVHNode> firstNodes, secondNodes;
+        std::vector<uint32_t> firstIndices, secondIndices;
+
+        std::thread task([&]() {
+            build(begin, mid, firstThreads, depth + 1, firstNodes, firstIndices);
+        });
+        build(mid, end, threads - firstThreads, depth + 1, secondNodes, secondIndices);
+        task.join();
+
+        append(nodes, indices, firstNodes, firstIndices);
+        second = static_cast<uint32_t>(nodes.size());
+        append(nodes, indices, secondNodes, secondIndices);
+    } else {
+        build(begin, mid, 1, depth + 1, nodes, indices);
+        second = static_cast<uint32_t>(nodes.size());
+        build(mid, end, 1, depth + 1, nodes, indices);
+    }
+
+    BVHNode& node = nodes[nodeIndex];
+    node.bounds = bounds;
+    node.offset = second;
+    node.count = 0;
+    node.axis = static_cast<uint8_t>(split.axis);
+}
+
+}
+
+BVH::BVH()
+    : nodeData(0), nodeTotal(0), indexData(0), indexTotal(0)
+{}
+
+void BVH::build(const std::vector<BBox>& bounds, size_t maxLeafSize, size_t threads)
+{
+    clear();
+
+    if (bounds.empty())
+        return;
+
+    std::vector<BuildItem> items(bounds.size());
+    for (size_t i = 0; i < bounds.size(); ++i) {
+        items[i].bounds = bounds[i];
+        items[i].centroid = bounds[i].centroid();
+        items[i].index = static_cast<uint32_t>(i);
+    }
+
+    nodes.reserve(2 * bounds.size());
+    indices.reserve(bounds.size());
+
+    Builder builder(items, std::max<size_t>(maxLeafSize, 1));
+    builder.build(0, items.size(), std::max<size_t>(threads, 1), 0, nodes, indices);
+
+    nodeData = nodes.data();
+    nodeTotal = nodes.size();
+    indexData = indices.data();
+    indexTotal = indices.size();
+}
+
+void BVH::adopt(const std::shared_ptr<GeometryFile>& file, const BVHNode* nodes, size_t nodeCount,
+                const uint32_t* indices, size_t indexCount)
+{
+    clear();
+
+    mapping = file;
+    nodeData = nodes;
+    nodeTotal = nodeCount;
+    indexData = indices;
+    indexTotal = indexCount;
+}
+
+void BVH::clear()
+{
+    std::vector<BVHNode>().swap(nodes);
+    std::vector<uint32_t>().swap(indices);
+    mapping.reset();
+
+    nodeData = 0;
+    nodeTotal = 0;
+    indexData = 0;
+    indexTotal = 0;
+}
+
+BBox BVH::bounds() const
+{
+    return nodeTotal == 0 ? BBox() : nodeData[0].bounds;
+}
+
+size_t BVH::nodeCount() const
+{
+    return nodeTotal;
+}
+
+size_t BVH::memoryUsage() const
+{
+    return nodeTotal * sizeof(BVHNode) + indexTotal * sizeof(uint32_t);
+}
+
+const BVHNode* BVH::getNodes() const
+{
+    return nodeData;
+}
+
+const uint32_t* BVH::getIndices() const
+{
+    return indexData;
+}
+
+size_t BVH::indexCount() const
+{
+    return indexTotal;
+}
+
+float BVH::sahCost() const
+{
+    if (nodeTotal == 0)
+        return 0.f;
+
+    const float rootArea = nodeData[0].bounds.surfaceArea();
+    if (rootArea <= 0.f)
+        return static_cast<float>(indexTotal);
+
+    double cost = 0.0;
+    for (size_t i = 0; i < nodeTotal; ++i) {
+        const BVHNode& node = nodeData[i];
+        const float area = node.bounds.surfaceArea() / rootArea;
+        cost += node.count > 0 ? area * node.count : area * TRAVERSAL_COST;
+    }
+
+    return static_cast<float>(cost);
+}
@@ -0,0 +1,279 @@
+#ifndef BVH_H
+#define BVH_H
+
+/*!
+ * \file
+ * Hierarchie obalovych kvadru (BVH) nad libovolnou mnozinou prvku.
+ * Struktura zna jen obalove kvadry prvku, test pruniku s prvkem dodava
+ * volajici, takze stejny kod slouzi pro koule v SphereSet (spodni uroven)
+ * i pro instance objektu ve scene (horni uroven).
+ */
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "core.h"
+
+#include "geometry.h"
+#include "geometryfile.h"
+#include "packet.h"
+
+/*!
+ * Nejvetsi hloubka listu (koren ma hloubku 0). Stavba ji nepresahne ani pro
+ * degenerovany vstup, zasobniky pruchodu proto staci na BVH_MAX_DEPTH + 1 polozek.
+ */
+const size_t BVH_MAX_DEPTH = 63;
+
+/*!
+ * Uzel linearizovane BVH (32 B). Uzly jsou ulozeny do hloubky, prvni potomek
+ * vnitrniho uzlu lezi hned za nim.
+ */
+struct BVHNode {
+    BBox bounds; ///< obalovy kvadr uzlu
+    uint32_t offset; ///< list: prvni index v poli indexu, vnitrni uzel: index druheho potomka
+    uint16_t count; ///< pocet prvku listu (0 = vnitrni uzel)
+    uint8_t axis; ///< osa deleni, urcuje poradi pruchodu potomku
+    uint8_t pad;
+};
+
+/*!
+ * Hierarchie obalovych kvadru.
+ */
+class BVH
+{
+public:
+    BVH();
+
+    /*!
+     * \brief Postavi hierarchii nad zadanymi kvadry binovanou heuristikou
+     * povrchu (SAH). Velke uzly se binuji a rozdeluji paralelne, podstromy
+     * se stavi jako samostatne ulohy na dostupnych vlaknech. Blizko hloubky
+     * BVH_MAX_DEPTH se deli na poloviny podle medianu, v ni se vzdy vytvori list.
+     * \param bounds obalove kvadry prvku, index v poli je identifikator prvku
+     * \param maxLeafSize pocet prvku, pod ktery se smi vytvorit list
+     * \param threads pocet vlaken pro stavbu (1 = seriova stavba)
+     */
+    void build(const std::vector<BBox>& bounds, size_t maxLeafSize = 4, size_t threads = 1);
+
+    /*!
+     * \brief Najde vsechny prvky, jejichz kvadr paprsek protne pred tMax.
+     * \param ray paprsek
+     * \param tMax reference na aktualne nejblizsi prusecik, visit ji muze zmensit
+     * \param visit funkce volana s indexem prvku
+     */
+    template<class Visit>
+    void intersect(const TraversalRay& ray, const float& tMax, Visit visit) const;
+
+    /*!
+     * \brief Zjisti, zda paprsek zasahne nejaky prvek. Konci pri prvnim zasahu.
+     * \param ray paprsek
+     * \param tMax nejvetsi uvazovana hodnota parametru t
+     * \param visit funkce volana s indexem prvku, vraci true pri zasahu
+     */
+    template<class Visit>
+    bool intersectP(const TraversalRay& ray, float tMax, Visit visit) const;
+
+    /*!
+     * \brief Test zakryti pro cely svazek paprsku. Uzel se zahodi, pokud
+     * nezasahuje do kvadru svazku nebo ho neprotne zadny aktivni paprsek.
+     * \param packet svazek paprsku
+     * \param active maska testovanych paprsku
+     * \param visit funkce (index prvku, maska paprsku) vracejici masku zakrytych paprsku
+     * \return maska zakrytych paprsku z active
+     */
+    template<class Visit>
+    uint64_t intersectP(const ShadowPacket& packet, uint64_t active, Visit visit) const;
+
+    /*!
+     * \brief Obalovy kvadr vsech prvku.
+     */
+    BBox bounds() const;
+
+    /*!
+     * \brief Pocet uzlu.
+     */
+    size_t nodeCount() const;
+
+    /*!
+     * \brief Pamet obsazena uzly a indexy v bajtech.
+     */
+    size_t memoryUsage() const;
+
+    /*!
+     * \brief Kvalita stromu: ocekavana cena pruchodu nahodneho paprsku podle
+     * SAH, vztazena k cene testu pruniku s jednim prvkem.
+     */
+    float sahCost() const;
+
+    /*!
+     * \brief Pouzije hotovou hierarchii primo z namapovaneho souboru (bez kopirovani).
+     * \param file soubor, ktery zustane namapovany po dobu zivota hierarchie
+     * \param nodes uzly ulozene do hloubky
+     * \param nodeCount pocet uzlu
+     * \param indices indexy prvku serazene podle listu
+     * \param indexCount pocet indexu
+     */
+    void adopt(const std::shared_ptr<GeometryFile>& file, const BVHNode* nodes, size_t nodeCount,
+               const uint32_t* indices, size_t indexCount);
+
+    /*!
+     * \brief Uvolni hierarchii.
+     */
+    void clear();
+
+    /*!
+     * \brief Uzly ulozene do hloubky (napr. pro prevod do jineho formatu).
+     */
+    const BVHNode* getNodes() const;
+
+    /*!
+     * \brief Indexy prvku serazene podle listu.
+     */
+    const uint32_t* getIndices() const;
+
+    /*!
+     * \brief Pocet indexu.
+     */
+    size_t indexCount() const;
+
+private:
+    BVH(const BVH&);
+    BVH& operator =(const BVH&);
+
+private:
+    std::vector<BVHNode> nodes; ///< vlastni uzly (po build())
+    std::vector<uint32_t> indices; ///< vlastni indexy (po build())
+    std::shared_ptr<GeometryFile> mapping; ///< namapovany soubor (po adopt())
+
+    const BVHNode* nodeData; ///< uzly pouzivane pri pruchodu
+    size_t nodeTotal; ///< pocet uzlu
+    const uint32_t* indexData; ///< indexy pouzivane pri pruchodu
+    size_t indexTotal; ///< pocet indexu
+};
+
+template<class Visit>
+void BVH::intersect(const TraversalRay& ray, const float& tMax, Visit visit) const
+{
+    if (nodeTotal == 0)
+        return;
+
+    uint32_t stack[BVH_MAX_DEPTH + 1];
+    int stackSize = 0;
+    uint32_t current = 0;
+
+    while (true) {
+        const BVHNode& node = nodeData[current];
+
+        if (node.bounds.intersectP(ray, tMax)) {
+            if (node.count > 0) {
+                for (uint32_t i = 0; i < node.count; ++i)
+                    visit(indexData[node.offset + i]);
+
+                if (stackSize == 0)
+                    break;
+                current = stack[--stackSize];
+            } else if (ray.negative(node.axis)) {
+                //nejdrive blizsi potomek
+                stack[stackSize++] = current + 1;
+                current = node.offset;
+            } else {
+                stack[stackSize++] = node.offset;
+                current = current + 1;
+            }
+        } else {
+            if (stackSize == 0)
+                break;
+            current = stack[--stackSize];
+        }
+    }
+}
+
+template<class Visit>
+bool BVH::intersectP(const TraversalRay& ray, float tMax, Visit visit) const
+{
+    if (nodeTotal == 0)
+        return false;
+
+    uint32_t stack[BVH_MAX_DEPTH + 1];
+    int stackSize = 0;
+    uint32_t current = 0;
+
+    while (true) {
+        const BVHNode& node = nodeData[current];
+
+        if (node.bounds.intersectP(ray, tMax)) {
+            if (node.count > 0) {
+                for (uint32_t i = 0; i < node.count; ++i) {
+                    if (visit(indexData[node.offset + i]))
+                        return true;
+                }
+
+                if (stackSize == 0)
+                    break;
+                current = stack[--stackSize];
+            } else if (ray.negative(node.axis)) {
+                stack[stackSize++] = current + 1;
+                current = node.offset;
+            } else {
+                stack[stackSize++] = node.offset;
+                current = current + 1;
+            }
+        } else {
+            if (stackSize == 0)
+                break;
+            current = stack[--stackSize];
+        }
+    }
+
+    return false;
+}
+
+template<class Visit>
+uint64_t BVH::intersectP(const ShadowPacket& packet, uint64_t active, Visit visit) const
+{
+    if (nodeTotal == 0 || active == 0)
+        return 0;
+
+    struct Entry {
+        uint32_t node;
+        uint64_t mask; ///< paprsky, ktere protnuly rodice
+    } stack[BVH_MAX_DEPTH + 1];
+    int stackSize = 0;
+
+    stack[stackSize].node = 0;
+    stack[stackSize++].mask = active;
+
+    uint64_t occluded = 0;
+    while (stackSize > 0) {
+        const Entry entry = stack[--stackSize];
+        const BVHNode& node = nodeData[entry.node];
+
+        if (!packet.overlaps(node.bounds))
+            continue;
+
+        const uint64_t mask = packet.intersectBox(node.bounds, entry.mask & ~occluded);
+        if (mask == 0)
+            continue;
+
+        if (node.count > 0) {
+            for (uint32_t i = 0; i < node.count; ++i) {
+                occluded |= visit(indexData[node.offset + i], mask & ~occluded);
+                if ((mask & ~occluded) == 0)
+                    break;
+            }
+
+            if (occluded == active)
+                return occluded;
+        } else {
+            stack[stackSize].node = node.offset;
+            stack[stackSize++].mask = mask;
+            stack[stackSize].node = entry.node + 1;
+            stack[stackSize++].mask = mask;
+        }
+    }
+
+    return occluded;
+}
+
+#endif // BVH_H
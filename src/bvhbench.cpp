@@ -0,0 +1,129 @@
+/*!
+ * \file
+ * Srovnani seriove a paralelni stavby BVH.\n
+ * Kvadry se berou z koulí souboru geometrie, nebo se vygeneruji nahodne.
+ * Pro kazdy pocet vlaken se vypise cas stavby, pocet uzlu a SAH cena stromu.
+ *
+ * \code
+ * bvhbench [--threads <n>] [--runs <n>] (<soubor.geom> | --random <pocet>)
+ * \endcode
+ */
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include "bvh.h"
+#include "geometryfile.h"
+
+using namespace std;
+
+/*!
+ * \brief Nahodne kvadry podobne scenam z geomconv --random.
+ */
+void generateRandom(size_t count, vector<BBox>& bounds)
+{
+    srand(1);
+
+    bounds.resize(count);
+    for (size_t i = 0; i < count; ++i) {
+        const Point c(8.f * (rand() / (float)RAND_MAX - 0.5f),
+                      8.f * (rand() / (float)RAND_MAX - 0.5f),
+                      8.f * (rand() / (float)RAND_MAX - 0.5f));
+        const float r = 0.02f + 0.1f * rand() / (float)RAND_MAX;
+        bounds[i] = BBox(c - Vector(r, r, r), c + Vector(r, r, r));
+    }
+}
+
+/*!
+ * \brief Kvadry koulí ze souboru geometrie.
+ * \return false pokud soubor nelze otevrit
+ */
+bool loadSpheres(const string& path, vector<BBox>& bounds)
+{
+    GeometryFile file;
+    if (!file.open(path)) {
+        cerr << "Chyba: " << file.errorString() << endl;
+        return false;
+    }
+
+    size_t count;
+    const SphereRecord* spheres = file.spheres(count);
+
+    bounds.resize(count);
+    for (size_t i = 0; i < count; ++i) {
+        const SphereRecord& s = spheres[i];
+        const Point c(s.center[0], s.center[1], s.center[2]);
+        const Vector r(s.radius, s.radius, s.radius);
+        bounds[i] = BBox(c - r, c + r);
+    }
+
+    return true;
+}
+
+/*!
+ * \brief Nejkratsi cas stavby z nekolika behu.
+ */
+double benchmark(const vector<BBox>& bounds, size_t threads, size_t runs, BVH& bvh)
+{
+    double best = 0.0;
+    for (size_t i = 0; i < runs; ++i) {
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        bvh.build(bounds, 4, threads);
+        chrono::duration<double> time = chrono::steady_clock::now() - start;
+
+        if (i == 0 || time.count() < best)
+            best = time.count();
+    }
+
+    return best;
+}
+
+int main(int argc, char* argv[])
+{
+    size_t threads = thread::hardware_concurrency();
+    size_t runs = 3;
+    vector<BBox> bounds;
+
+    bool loaded = false;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            threads = strtoul(argv[++i], 0, 10);
+        } else if (strcmp(argv[i], "--runs") == 0 && i + 1 < argc) {
+            runs = strtoul(argv[++i], 0, 10);
+        } else if (strcmp(argv[i], "--random") == 0 && i + 1 < argc) {
+            generateRandom(strtoul(argv[++i], 0, 10), bounds);
+            loaded = true;
+        } else if (argv[i][0] != '-') {
+            if (!loadSpheres(argv[i], bounds))
+                return 1;
+            loaded = true;
+        } else {
+            loaded = false;
+            break;
+        }
+    }
+
+    if (!loaded || threads == 0 || runs == 0) {
+        cout << "Pouziti: " << argv[0] << " [--threads <n>] [--runs <n>] (<soubor.geom> | --random <pocet>)\n";
+        return 1;
+    }
+
+    cout << "Primitives: " << bounds.size() << endl;
+
+    BVH serial, parallel;
+    const double serialTime = benchmark(bounds, 1, runs, serial);
+    cout << "Serial build time: " << serialTime << ", nodes: " << serial.nodeCount()
+         << ", SAH cost: " << serial.sahCost() << endl;
+
+    const double parallelTime = benchmark(bounds, threads, runs, parallel);
+    cout << "Parallel build time (" << threads << " threads): " << parallelTime
+         << ", nodes: " << parallel.nodeCount() << ", SAH cost: " << parallel.sahCost() << endl;
+
+    cout << "Speedup: " << serialTime / parallelTime << endl;
+
+    return 0;
+}
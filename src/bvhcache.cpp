@@ -0,0 +1,154 @@
+#include "bvhcache.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+uint64_t mix(uint64_t h, uint64_t value)
+{
+    h ^= value;
+    h *= 0x100000001b3ull;
+    return h ^ (h >> 29);
+}
+
+//tvar hierarchie zavisi jen na polohach a polomerech, ne na materialech
+uint64_t floatBits(float f)
+{
+    uint32_t bits;
+    memcpy(&bits, &f, sizeof(bits));
+    return bits;
+}
+
+}
+
+uint64_t sphereGeometryHash(const SphereRecord* spheres, size_t count, size_t maxLeafSize)
+{
+    uint64_t h = 0xcbf29ce484222325ull;
+    h = mix(h, BVH_CACHE_VERSION);
+    h = mix(h, sizeof(BVHNode));
+    h = mix(h, maxLeafSize);
+    h = mix(h, count);
+
+    for (size_t i = 0; i < count; ++i) {
+        const SphereRecord& s = spheres[i];
+        h = mix(h, floatBits(s.center[0]) | floatBits(s.center[1]) << 32);
+        h = mix(h, floatBits(s.center[2]) | floatBits(s.radius) << 32);
+    }
+
+    return h;
+}
+
+std::string bvhCachePath(const std::string& dir, uint64_t hash)
+{
+    char name[32];
+    snprintf(name, sizeof(name), "%016llx.bvh", static_cast<unsigned long long>(hash));
+
+    if (dir.empty() || dir[dir.size() - 1] == '/')
+        return dir + name;
+    return dir + "/" + name;
+}
+
+bool loadBVHCache(const std::string& path, uint64_t hash, size_t primitiveCount,
+                  size_t maxLeafSize, BVH& bvh)
+{
+    std::shared_ptr<GeometryFile> file = std::make_shared<GeometryFile>();
+    if (!file->open(path))
+        return false;
+
+    size_t infoCount;
+    const BVHCacheInfo* info = static_cast<const BVHCacheInfo*>(
+                                   file->section(GEOMETRY_SECTION_CACHE_INFO, sizeof(BVHCacheInfo), infoCount));
+    if (!info || infoCount != 1
+            || info->hash != hash
+            || info->version != BVH_CACHE_VERSION
+            || info->nodeSize != sizeof(BVHNode)
+            || info->primitiveCount != primitiveCount
+            || info->maxLeafSize != maxLeafSize)
+        return false;
+
+    size_t nodeCount, indexCount;
+    const BVHNode* nodes = static_cast<const BVHNode*>(
+                               file->section(GEOMETRY_SECTION_NODES, sizeof(BVHNode), nodeCount));
+    const uint32_t* indices = static_cast<const uint32_t*>(
+                                  file->section(GEOMETRY_SECTION_INDICES, sizeof(uint32_t), indexCount));
+    if ((!nodes || !indices) && primitiveCount > 0)
+        return false;
+    if (indexCount != primitiveCount)
+        return false;
+
+    //poskozeny soubor se stejnym otiskem nesmi vest k pristupu mimo pole
+    for (size_t i = 0; i < nodeCount; ++i) {
+        const BVHNode& node = nodes[i];
+        if (node.count > 0 ? node.offset + static_cast<size_t>(node.count) > indexCount
+                           : node.offset <= i + 1 || node.offset >= nodeCount)
+            return false;
+    }
+    for (size_t i = 0; i < indexCount; ++i) {
+        if (indices[i] >= primitiveCount)
+            return false;
+    }
+
+    //potomci lezi vzdy za rodicem, hloubky staci projit jednou dopredu;
+    //hlubsi strom by pretekl zasobniky pruchodu
+    std::vector<uint8_t> depth(nodeCount, 0);
+    for (size_t i = 0; i < nodeCount; ++i) {
+        if (nodes[i].count > 0)
+            continue;
+        if (depth[i] >= BVH_MAX_DEPTH)
+            return false;
+
+        const uint8_t child = depth[i] + 1;
+        depth[i + 1] = std::max(depth[i + 1], child);
+        depth[nodes[i].offset] = std::max(depth[nodes[i].offset], child);
+    }
+
+    bvh.adopt(file, nodes, nodeCount, indices, indexCount);
+    return true;
+}
+
+bool saveBVHCache(const std::string& path, uint64_t hash, size_t primitiveCount,
+                  size_t maxLeafSize, const BVH& bvh)
+{
+    BVHCacheInfo info;
+    memset(&info, 0, sizeof(info));
+    info.hash = hash;
+    info.version = BVH_CACHE_VERSION;
+    info.nodeSize = sizeof(BVHNode);
+    info.primitiveCount = primitiveCount;
+    info.maxLeafSize = static_cast<uint32_t>(maxLeafSize);
+
+    GeometryFileWriter writer;
+    writer.addSection(GEOMETRY_SECTION_CACHE_INFO, sizeof(BVHCacheInfo), &info, 1);
+    writer.addSection(GEOMETRY_SECTION_NODES, sizeof(BVHNode), bvh.getNodes(), bvh.nodeCount());
+    writer.addSection(GEOMETRY_SECTION_INDICES, sizeof(uint32_t), bvh.getIndices(), bvh.indexCount());
+
+    const std::string dir = path.substr(0, path.find_last_of('/') + 1);
+    if (!dir.empty())
+        mkdir(dir.c_str(), 0755);
+
+    //stejnou hierarchii muze soucasne ukladat vic procesu i vlaken
+    static std::atomic<unsigned int> serial(0);
+    char suffix[48];
+    snprintf(suffix, sizeof(suffix), ".tmp%ld.%u", static_cast<long>(getpid()), serial++);
+    const std::string temporary = path + suffix;
+
+    if (!writer.write(temporary)) {
+        unlink(temporary.c_str());
+        return false;
+    }
+
+    if (rename(temporary.c_str(), path.c_str()) != 0) {
+        unlink(temporary.c_str());
+        return false;
+    }
+
+    return true;
+}
@@ -0,0 +1,86 @@
+#ifndef BVHCACHE_H
+#define BVHCACHE_H
+
+/*!
+ * \file
+ * Diskova cache postavenych hierarchii BVH.\n
+ * Hierarchie se uklada ve formatu souboru geometrie (viz geometryfile.h) pod
+ * jmenem odvozenym z otisku geometrie. Pri dalsim spusteni nad stejnou
+ * geometrii se soubor jen namapuje a uzly se pouzivaji primo z mapovane pameti,
+ * takze odpada cela stavba. Pri neshode otisku, verze nebo rozmeru se cache
+ * ignoruje a hierarchie se postavi znovu.
+ */
+
+#include <cstdint>
+#include <string>
+
+#include "bvh.h"
+#include "geometryfile.h"
+
+const uint32_t BVH_CACHE_VERSION = 2; ///< verze obsahu cache, zvysit pri zmene BVHNode nebo stavby
+
+/*!
+ * Sekce souboru cache s popisem ulozene hierarchie.
+ */
+struct BVHCacheInfo {
+    uint64_t hash; ///< otisk geometrie
+    uint32_t version; ///< BVH_CACHE_VERSION
+    uint32_t nodeSize; ///< sizeof(BVHNode) v dobe zapisu
+    uint64_t primitiveCount; ///< pocet prvku
+    uint32_t maxLeafSize; ///< parametr stavby
+    uint32_t reserved;
+};
+
+/*!
+ * Vysledek pokusu o pouziti cache.
+ */
+struct BVHCacheStats {
+    BVHCacheStats()
+        : enabled(false), hit(false), saved(false), hashTime(0.0), loadTime(0.0), buildTime(0.0)
+    {}
+
+    bool enabled; ///< cache byla zapnuta
+    bool hit; ///< hierarchie byla nactena z cache
+    bool saved; ///< nove postavena hierarchie byla ulozena
+    double hashTime; ///< doba vypoctu otisku [s]
+    double loadTime; ///< doba nacteni z cache [s]
+    double buildTime; ///< doba stavby [s]
+    std::string path; ///< soubor cache
+};
+
+/*!
+ * \brief Otisk geometrie kouli, na kterem zavisi tvar hierarchie.
+ * \param spheres pole kouli
+ * \param count pocet kouli
+ * \param maxLeafSize parametr stavby
+ */
+uint64_t sphereGeometryHash(const SphereRecord* spheres, size_t count, size_t maxLeafSize);
+
+/*!
+ * \brief Cesta k souboru cache pro dany otisk.
+ * \param dir adresar cache
+ * \param hash otisk geometrie
+ */
+std::string bvhCachePath(const std::string& dir, uint64_t hash);
+
+/*!
+ * \brief Namapuje hierarchii ze souboru cache.
+ * \param path soubor cache
+ * \param hash ocekavany otisk
+ * \param primitiveCount ocekavany pocet prvku
+ * \param maxLeafSize ocekavany parametr stavby
+ * \param [out] bvh hierarchie, pri neuspechu se nemeni
+ * \return true pokud soubor existuje, odpovida geometrii a strom neni hlubsi nez BVH_MAX_DEPTH
+ */
+bool loadBVHCache(const std::string& path, uint64_t hash, size_t primitiveCount,
+                  size_t maxLeafSize, BVH& bvh);
+
+/*!
+ * \brief Ulozi hierarchii do cache. Zapisuje se do docasneho souboru, ktery se
+ * nakonec prejmenuje, takze soubeznym ctenarum se nikdy neukaze rozepsany soubor.
+ * \return true pri uspechu
+ */
+bool saveBVHCache(const std::string& path, uint64_t hash, size_t primitiveCount,
+                  size_t maxLeafSize, const BVH& bvh);
+
+#endif // BVHCACHE_H
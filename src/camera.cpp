@@ -21,3 +21,8 @@ Ray PerspectiveCamera::generateRay(const CameraSample& sample) const
 
     return Ray(eye, dir);
 }
+
+float PerspectiveCamera::spread() const
+{
+    return film->size() / d;
+}
@@ -51,6 +51,13 @@ public:
      */
     virtual Ray generateRay(const CameraSample& sample) const = 0;
 
+    /**
+     * Úhel, o který se rozbíhají paprsky sousedních pixelů. Šířka stopy
+     * paprsku ve vzdálenosti t je přibližně spread() * t.
+     * @return úhel v radiánech
+     */
+    virtual float spread() const = 0;
+
 protected:
     /**
      * Výpočet ortonormální báze pohledu.
@@ -86,6 +93,7 @@ public:
     virtual ~PerspectiveCamera();
 
     virtual Ray generateRay(const CameraSample& sample) const;
+    virtual float spread() const;
 
 private:
     float d;
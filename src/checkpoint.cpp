@@ -0,0 +1,180 @@
+#include "checkpoint.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+#include "color.h"
+#include "film.h"
+
+const uint32_t CHECKPOINT_MAGIC = 0x54504b43; ///< "CKPT"
+const uint32_t CHECKPOINT_VERSION = 3;
+
+namespace {
+
+uint64_t pathHash(const std::string& path)
+{
+    uint64_t h = 0xcbf29ce484222325ull;
+    for (size_t i = 0; i < path.size(); ++i) {
+        h ^= static_cast<unsigned char>(path[i]);
+        h *= 0x100000001b3ull;
+    }
+    return h;
+}
+
+}
+
+Checkpoint::Checkpoint(const std::string& path, const TileGrid& grid, unsigned int spp,
+                       unsigned int seed, const std::string& scene)
+    : path(path), grid(grid), spp(spp), seed(seed), scene(scene),
+      sceneStamp(scene.empty() ? FileStamp() : fileStamp(scene))
+{}
+
+Checkpoint::Header Checkpoint::header(const Film& film) const
+{
+    Header h;
+    memset(&h, 0, sizeof(h));
+
+    h.magic = CHECKPOINT_MAGIC;
+    h.version = CHECKPOINT_VERSION;
+    h.filmWidth = film.width();
+    h.filmHeight = film.height();
+    h.x0 = grid.window().x0;
+    h.y0 = grid.window().y0;
+    h.x1 = grid.window().x1;
+    h.y1 = grid.window().y1;
+    h.tileSize = grid.tileSize();
+    h.tileCount = grid.count();
+    h.aovs = film.hasAOVs() ? 1 : 0;
+    h.spp = spp;
+    h.seed = seed;
+    h.sceneHash = pathHash(scene);
+    h.sceneSize = sceneStamp.size;
+    h.sceneTime = sceneStamp.mtime;
+
+    return h;
+}
+
+size_t Checkpoint::load(Film& film, TileFlags& done, bool& stale) const
+{
+    stale = false;
+
+    std::ifstream ifs(path, std::ios::binary | std::ios::in);
+    if (!ifs)
+        return 0;
+
+    Header expected = header(film);
+    Header h;
+    if (!ifs.read(reinterpret_cast<char*>(&h), sizeof(h))
+            || memcmp(&h, &expected, sizeof(h)) != 0) {
+        stale = true;
+        return 0;
+    }
+
+    std::vector<unsigned char> flags(grid.count());
+    if (!ifs.read(reinterpret_cast<char*>(flags.data()), flags.size()))
+        return 0;
+
+    size_t restored = 0;
+    std::vector<float> pixels;
+    std::vector<AOVRecord> aovs;
+    for (size_t i = 0; i < grid.count(); ++i) {
+        if (!flags[i])
+            continue;
+
+        const Tile t = grid.tile(i);
+        pixels.resize(t.pixelCount() * 3);
+        if (!ifs.read(reinterpret_cast<char*>(pixels.data()), pixels.size() * sizeof(float)))
+            return restored;
+
+        const float* p = pixels.data();
+        for (size_t y = t.y0; y < t.y1; ++y) {
+            for (size_t x = t.x0; x < t.x1; ++x, p += 3)
+                film.setPixelColor(RGBColor(p[0], p[1], p[2]), x, y);
+        }
+
+        if (film.hasAOVs()) {
+            aovs.resize(t.pixelCount());
+            if (!ifs.read(reinterpret_cast<char*>(aovs.data()), aovs.size() * sizeof(AOVRecord)))
+                return restored;
+
+            const AOVRecord* r = aovs.data();
+            for (size_t y = t.y0; y < t.y1; ++y) {
+                for (size_t x = t.x0; x < t.x1; ++x, ++r) {
+                    AOVSample aov;
+                    aov.depth = r->depth;
+                    aov.normal = Normal(r->normal[0], r->normal[1], r->normal[2]);
+                    aov.albedo = RGBColor(r->albedo[0], r->albedo[1], r->albedo[2]);
+                    aov.objectId = r->objectId;
+                    film.setAOV(aov, x, y);
+                }
+            }
+        }
+
+        done[i].store(true);
+        ++restored;
+    }
+
+    return restored;
+}
+
+bool Checkpoint::save(const Film& film, const TileFlags& done) const
+{
+    //snimek priznaku, dlazdice dokoncene behem zapisu se ulozi priste
+    std::vector<unsigned char> flags(grid.count());
+    for (size_t i = 0; i < flags.size(); ++i)
+        flags[i] = done[i].load(std::memory_order_acquire) ? 1 : 0;
+
+    const std::string temp = path + ".tmp";
+    std::ofstream ofs(temp, std::ios::binary | std::ios::out);
+    if (!ofs)
+        return false;
+
+    Header h = header(film);
+    ofs.write(reinterpret_cast<const char*>(&h), sizeof(h));
+    ofs.write(reinterpret_cast<const char*>(flags.data()), flags.size());
+
+    std::vector<float> pixels;
+    std::vector<AOVRecord> aovs;
+    for (size_t i = 0; i < grid.count(); ++i) {
+        if (!flags[i])
+            continue;
+
+        const Tile t = grid.tile(i);
+        pixels.clear();
+        aovs.clear();
+        for (size_t y = t.y0; y < t.y1; ++y) {
+            for (size_t x = t.x0; x < t.x1; ++x) {
+                RGBColor c = film.getPixelColor(x, y);
+                pixels.push_back(c.r);
+                pixels.push_back(c.g);
+                pixels.push_back(c.b);
+
+                if (film.hasAOVs()) {
+                    const AOVSample& aov = film.getAOV(x, y);
+                    AOVRecord r = {
+                        aov.depth,
+                        { aov.normal.x, aov.normal.y, aov.normal.z },
+                        { aov.albedo.r, aov.albedo.g, aov.albedo.b },
+                        aov.objectId
+                    };
+                    aovs.push_back(r);
+                }
+            }
+        }
+
+        ofs.write(reinterpret_cast<const char*>(pixels.data()), pixels.size() * sizeof(float));
+        ofs.write(reinterpret_cast<const char*>(aovs.data()), aovs.size() * sizeof(AOVRecord));
+    }
+
+    ofs.close();
+    if (!ofs)
+        return false;
+
+    return std::rename(temp.c_str(), path.c_str()) == 0;
+}
+
+void Checkpoint::remove() const
+{
+    std::remove(path.c_str());
+}
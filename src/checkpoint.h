@@ -0,0 +1,100 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "core.h"
+
+#include "geometryfile.h"
+#include "tile.h"
+
+/*!
+ * Kontrolni bod rozpracovaneho renderu. Uklada seznam dokoncenych dlazdic
+ * a hodnoty jejich pixelu, aby bylo mozne po padu nebo preruseni ulohy
+ * pokracovat tam, kde se skoncilo.
+ *
+ * Soubor se zapisuje do docasneho souboru a potom se prejmenuje, takze
+ * na disku je vzdy cely platny kontrolni bod. Kontrolni bod jineho renderu
+ * (jiny vyrez, dlazdice, pocet vzorku, seminko nebo scena) se nepouzije.
+ */
+class Checkpoint
+{
+public:
+    /*!
+     * \brief Konstruktor.
+     * \param path cesta k souboru kontrolniho bodu
+     * \param grid rozdeleni renderovaneho vyrezu na dlazdice
+     * \param spp pocet vzorku na pixel
+     * \param seed seminko generatoru nahodnych cisel
+     * \param scene soubor geometrie (prazdny = vychozi scena)
+     */
+    Checkpoint(const std::string& path, const TileGrid& grid, unsigned int spp, unsigned int seed,
+               const std::string& scene);
+
+    /*!
+     * \brief Nacte kontrolni bod, pokud existuje a patri ke stejnemu renderu.
+     * \param film film, do ktereho se obnovi dokoncene dlazdice
+     * \param done priznaky dokoncenych dlazdic (velikost grid.count())
+     * \param [out] stale soubor existuje, ale patri k jinemu renderu
+     * \return pocet obnovenych dlazdic
+     */
+    size_t load(Film& film, TileFlags& done, bool& stale) const;
+
+    /*!
+     * \brief Ulozi dokoncene dlazdice. Lze volat soubezne s renderovanim,
+     * cte se pouze z dlazdic oznacenych jako dokoncene.
+     * \param film renderovany film
+     * \param done priznaky dokoncenych dlazdic
+     * \return true pri uspechu
+     */
+    bool save(const Film& film, const TileFlags& done) const;
+
+    /*!
+     * \brief Smaze soubor kontrolniho bodu po uspesnem dokonceni renderu.
+     */
+    void remove() const;
+
+private:
+    /*!
+     * Hlavicka souboru, podle ktere se overuje, ze kontrolni bod patri
+     * ke stejnemu renderu.
+     */
+    struct Header {
+        uint32_t magic;
+        uint32_t version;
+        uint64_t filmWidth, filmHeight;
+        uint64_t x0, y0, x1, y1;
+        uint64_t tileSize;
+        uint64_t tileCount;
+        uint64_t aovs; ///< obsahuje i pomocne kanaly
+        uint64_t spp; ///< pocet vzorku na pixel
+        uint64_t seed; ///< seminko generatoru nahodnych cisel
+        uint64_t sceneHash; ///< otisk cesty k souboru geometrie
+        uint64_t sceneSize; ///< velikost souboru geometrie
+        int64_t sceneTime; ///< cas posledni zmeny souboru geometrie
+    };
+
+    /*!
+     * Zaznam pomocnych kanalu jednoho pixelu v souboru.
+     */
+    struct AOVRecord {
+        float depth;
+        float normal[3];
+        float albedo[3];
+        uint32_t objectId;
+    };
+
+    Header header(const Film& film) const;
+
+private:
+    std::string path;
+    const TileGrid& grid;
+    unsigned int spp;
+    unsigned int seed;
+    std::string scene;
+    FileStamp sceneStamp; ///< soubor geometrie v dobe vytvoreni objektu
+};
+
+#endif // CHECKPOINT_H
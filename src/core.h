@@ -17,22 +17,24 @@ class  Vector;
 class  Normal;
 class  Vector;
 class  Ray;
+struct TraversalRay;
 struct Intersection;
+struct SurfaceHit;
 class  Film;
 class  RGBColor;
 class  Light;
 class  Primitive;
+class  Instance;
 class  Camera;
 class  Material;
 
 template<class T>
-inline T clamp(const T& val, T& from, T& to)
+inline T clamp(const T& val, const T& from, const T& to)
 {
-    if (from > to)
-        std::swap(from, to);
+    const T lo = std::min(from, to);
+    const T hi = std::max(from, to);
 
-    const T t = val < from ? to : val;
-    return t > to ? from : t;
+    return val < lo ? lo : (val > hi ? hi : val);
 }
 
 
@@ -0,0 +1,132 @@
+#include "denoise.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <thread>
+#include <vector>
+
+#include "color.h"
+#include "film.h"
+
+DenoiseParams::DenoiseParams()
+    : radius(5), sigmaSpatial(3.f), sigmaColor(0.2f), sigmaNormal(0.1f),
+      sigmaDepth(0.05f), sigmaAlbedo(0.1f)
+{}
+
+namespace {
+
+const float ALBEDO_EPSILON = 1e-3f; ///< pod touto hodnotou se osvetleni nedeli albedem
+
+inline float luminance(const RGBColor& c)
+{
+    return 0.2126f * c.r + 0.7152f * c.g + 0.0722f * c.b;
+}
+
+inline float demodulate(float c, float albedo)
+{
+    return albedo > ALBEDO_EPSILON ? c / albedo : c;
+}
+
+inline float remodulate(float c, float albedo)
+{
+    return albedo > ALBEDO_EPSILON ? c * albedo : c;
+}
+
+}
+
+void denoise(Film& film, const CropWindow& window, const DenoiseParams& params, size_t threads)
+{
+    const size_t w = window.width();
+    const size_t h = window.height();
+
+    //osvetleni bez vlivu materialu, filtruje se z kopie
+    std::vector<RGBColor> irradiance(w * h);
+    for (size_t y = 0; y < h; ++y) {
+        for (size_t x = 0; x < w; ++x) {
+            const RGBColor c = film.getPixelColor(window.x0 + x, window.y0 + y);
+            const RGBColor& a = film.getAOV(window.x0 + x, window.y0 + y).albedo;
+            irradiance[y * w + x] = RGBColor(demodulate(c.r, a.r), demodulate(c.g, a.g),
+                                             demodulate(c.b, a.b));
+        }
+    }
+
+    const int radius = params.radius;
+    std::vector<float> spatial((2 * radius + 1) * (2 * radius + 1));
+    for (int dy = -radius; dy <= radius; ++dy) {
+        for (int dx = -radius; dx <= radius; ++dx) {
+            spatial[(dy + radius) * (2 * radius + 1) + dx + radius] =
+                std::exp(-(dx * dx + dy * dy) / (2.f * params.sigmaSpatial * params.sigmaSpatial));
+        }
+    }
+
+    const float invColor = 1.f / (2.f * params.sigmaColor * params.sigmaColor);
+    const float invNormal = 1.f / (2.f * params.sigmaNormal * params.sigmaNormal);
+    const float invDepth = 1.f / (2.f * params.sigmaDepth * params.sigmaDepth);
+    const float invAlbedo = 1.f / (2.f * params.sigmaAlbedo * params.sigmaAlbedo);
+
+    std::atomic<size_t> nextRow(0);
+
+    auto worker = [&]() {
+        for (size_t y = nextRow++; y < h; y = nextRow++) {
+            for (size_t x = 0; x < w; ++x) {
+                const AOVSample& p = film.getAOV(window.x0 + x, window.y0 + y);
+
+                //pozadi se nefiltruje
+                if (p.objectId == 0)
+                    continue;
+
+                const RGBColor& center = irradiance[y * w + x];
+                const float centerLum = luminance(center);
+
+                RGBColor sum;
+                float weightSum = 0.f;
+
+                const size_t y0 = y > (size_t)radius ? y - radius : 0;
+                const size_t y1 = std::min(h, y + radius + 1);
+                const size_t x0 = x > (size_t)radius ? x - radius : 0;
+                const size_t x1 = std::min(w, x + radius + 1);
+
+                for (size_t qy = y0; qy < y1; ++qy) {
+                    for (size_t qx = x0; qx < x1; ++qx) {
+                        const AOVSample& q = film.getAOV(window.x0 + qx, window.y0 + qy);
+                        if (q.objectId != p.objectId)
+                            continue;
+
+                        const RGBColor& value = irradiance[qy * w + qx];
+                        const Normal dn = p.normal - q.normal;
+                        const RGBColor da = p.albedo - q.albedo;
+                        const float dd = (p.depth - q.depth) / p.depth;
+                        const float dc = (luminance(value) - centerLum) / (centerLum + 1e-2f);
+
+                        const float exponent = dn.squarredLenght() * invNormal
+                                               + dd * dd * invDepth
+                                               + (da.r * da.r + da.g * da.g + da.b * da.b) * invAlbedo
+                                               + dc * dc * invColor;
+
+                        const int sx = (int)qx - (int)x + radius;
+                        const int sy = (int)qy - (int)y + radius;
+                        const float weight = spatial[sy * (2 * radius + 1) + sx] * std::exp(-exponent);
+
+                        sum += value * weight;
+                        weightSum += weight;
+                    }
+                }
+
+                //vaha stredu je vzdy 1, deleni je bezpecne
+                const RGBColor filtered = sum / weightSum;
+                film.setPixelColor(RGBColor(remodulate(filtered.r, p.albedo.r),
+                                            remodulate(filtered.g, p.albedo.g),
+                                            remodulate(filtered.b, p.albedo.b)),
+                                   window.x0 + x, window.y0 + y);
+            }
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (size_t i = 0; i < std::max<size_t>(threads, 1); ++i)
+        workers.push_back(std::thread(worker));
+
+    for (size_t i = 0; i < workers.size(); ++i)
+        workers[i].join();
+}
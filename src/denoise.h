@@ -0,0 +1,36 @@
+#ifndef DENOISE_H
+#define DENOISE_H
+
+#include <cstddef>
+
+#include "core.h"
+
+#include "tile.h"
+
+/*!
+ * Parametry spolecneho bilateralniho filtru. Vahy souseda jsou soucinem
+ * prostorove gaussovky a gaussovek rozdilu v jednotlivych kanalech.
+ */
+struct DenoiseParams {
+    DenoiseParams();
+
+    int radius; ///< polomer okna filtru v pixelech
+    float sigmaSpatial; ///< prostorova odchylka v pixelech
+    float sigmaColor; ///< odchylka osvetleni (relativne k jasu)
+    float sigmaNormal; ///< odchylka normal
+    float sigmaDepth; ///< odchylka hloubky (relativne k hloubce)
+    float sigmaAlbedo; ///< odchylka albeda
+};
+
+/*!
+ * \brief Odstrani sum z vyrezu filmu spolecnym bilateralnim filtrem rizenym
+ * pomocnymi kanaly. Filtruje se osvetleni (barva vydelena albedem), takze
+ * detaily materialu zustanou ostre. Pixely ruznych objektu se nemichaji.
+ * \param film film s alokovanymi pomocnymi kanaly
+ * \param window vyrez filmu, ktery se filtruje
+ * \param params parametry filtru
+ * \param threads pocet vlaken
+ */
+void denoise(Film& film, const CropWindow& window, const DenoiseParams& params, size_t threads);
+
+#endif // DENOISE_H
@@ -1,9 +1,11 @@
 #include "film.h"
 
+#include <assert.h>
+
 #include "color.h"
 
 Film::Film(size_t w, size_t h, float size)
-    : _width(w), _height(h), _size(size)
+    : _width(w), _height(h), _size(size), aovs(0)
 {
     _pixelCount = w * h;
     data = new RGBColor[_pixelCount];
@@ -13,6 +15,9 @@ Film::~Film()
 {
     delete [] data;
     data = 0;
+
+    delete [] aovs;
+    aovs = 0;
 }
 
 size_t Film::pixelCount() const
@@ -45,3 +50,32 @@ RGBColor Film::getPixelColor(const size_t w, const size_t h) const
 {
     return data[offset(w, h)];
 }
+
+const float* Film::row(const size_t w, const size_t h) const
+{
+    static_assert(sizeof(RGBColor) == 3 * sizeof(float), "RGBColor musi byt tri floaty za sebou");
+    return &data[offset(w, h)].r;
+}
+
+void Film::enableAOVs()
+{
+    if (!aovs)
+        aovs = new AOVSample[_pixelCount];
+}
+
+bool Film::hasAOVs() const
+{
+    return aovs != 0;
+}
+
+void Film::setAOV(const AOVSample& aov, const size_t w, const size_t h)
+{
+    assert(aovs);
+    aovs[offset(w, h)] = aov;
+}
+
+const AOVSample& Film::getAOV(const size_t w, const size_t h) const
+{
+    assert(aovs);
+    return aovs[offset(w, h)];
+}
@@ -1,8 +1,27 @@
 #ifndef FILM_H
 #define FILM_H
 
+#include <cstdint>
+
 #include "core.h"
 
+#include "color.h"
+#include "geometry.h"
+
+/*!
+ * Pomocne kanaly (AOV) primarniho pruseciku jednoho pixelu.
+ */
+struct AOVSample {
+    AOVSample()
+        : depth(0.f), objectId(0)
+    {}
+
+    float depth; ///< vzdalenost pruseciku od kamery (0 = pozadi)
+    Normal normal; ///< normala v miste dopadu
+    RGBColor albedo; ///< odrazivost materialu
+    uint32_t objectId; ///< identifikator objektu (0 = pozadi)
+};
+
 /*!
  * Třída Film reprezentuje film v kameře. Narozdíl od klasického filmu v reálném světě,
  * tento uchovává takové atributy, které jsou potom využitelné pro práci s počítačovou grafikou.
@@ -53,6 +72,40 @@ public:
      */
     RGBColor getPixelColor(const size_t w, const size_t h) const;
 
+    /*!
+     * \brief Primy pristup k radku pixelu pro davkove zpracovani.
+     * Pixely jsou ulozeny za sebou po radcich, kazdy jako tri hodnoty float (r, g, b).
+     * \param w poloha prvniho pixelu ve vodorovnem smeru
+     * \param h radek
+     * \return ukazatel na slozku r prvniho pixelu
+     */
+    const float* row(const size_t w, const size_t h) const;
+
+    /*!
+     * \brief Alokuje pomocne kanaly (hloubka, normala, albedo, id objektu).
+     */
+    void enableAOVs();
+
+    /*!
+     * \brief Jsou pomocne kanaly alokovany?
+     */
+    bool hasAOVs() const;
+
+    /*!
+     * \brief Ulozi pomocne kanaly pixelu. Film musi mit kanaly alokovany.
+     * \param aov hodnoty kanalu
+     * \param w poloha ve vodorovnem smeru
+     * \param h poloha ve svislem smeru
+     */
+    void setAOV(const AOVSample& aov, const size_t w, const size_t h);
+
+    /*!
+     * \brief Vraci pomocne kanaly pixelu.
+     * \param w poloha ve vodorovnem smeru
+     * \param h poloha ve svislem smeru
+     */
+    const AOVSample& getAOV(const size_t w, const size_t h) const;
+
 private:
     /*!
      * \brief Index pixelu v jednorozmernem poli data.
@@ -62,7 +115,7 @@ private:
      */
     inline size_t offset(const size_t x, const size_t y) const
     {
-        return x * _width + y;
+        return y * _width + x;
     }
 
 private:
@@ -71,6 +124,7 @@ private:
     size_t _pixelCount;
     float _size; ///< velikost pixelu
     RGBColor* data; ///< buffer na hodnoty pixelu
+    AOVSample* aovs; ///< buffer pomocnych kanalu (0 = nealokovano)
 };
 
 #endif // FILM_H
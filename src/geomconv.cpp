@@ -0,0 +1,170 @@
+/*!
+ * \file
+ * Nastroj pro prevod textoveho popisu geometrie do binarniho formatu
+ * souboru geometrie (viz geometryfile.h).
+ *
+ * Textovy format, jeden zaznam na radek:
+ * \code
+ * # komentar
+ * material <r> <g> <b> <kd>
+ * sphere <x> <y> <z> <polomer> [index materialu]
+ * texture <index materialu> <soubor.tex>
+ * \endcode
+ */
+
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "geometryfile.h"
+
+using namespace std;
+
+/*!
+ * \brief Nacte textovy popis geometrie.
+ * \return false pri chybe ve vstupu
+ */
+bool parseText(const string& path, vector<SphereRecord>& spheres, vector<MaterialRecord>& materials,
+               vector<TextureRecord>& textures)
+{
+    ifstream ifs(path);
+    if (!ifs) {
+        cerr << "Nelze otevrit " << path << endl;
+        return false;
+    }
+
+    string line;
+    size_t lineNumber = 0;
+    while (getline(ifs, line)) {
+        ++lineNumber;
+
+        istringstream in(line);
+        string keyword;
+        if (!(in >> keyword) || keyword[0] == '#')
+            continue;
+
+        if (keyword == "material") {
+            MaterialRecord m;
+            if (!(in >> m.color[0] >> m.color[1] >> m.color[2] >> m.kd)) {
+                cerr << path << ":" << lineNumber << ": neplatny material" << endl;
+                return false;
+            }
+            materials.push_back(m);
+        } else if (keyword == "sphere") {
+            SphereRecord s;
+            memset(&s, 0, sizeof(s));
+            if (!(in >> s.center[0] >> s.center[1] >> s.center[2] >> s.radius)) {
+                cerr << path << ":" << lineNumber << ": neplatna koule" << endl;
+                return false;
+            }
+            if (!(in >> s.material))
+                s.material = 0;
+            spheres.push_back(s);
+        } else if (keyword == "texture") {
+            TextureRecord t;
+            memset(&t, 0, sizeof(t));
+            string file;
+            if (!(in >> t.material >> file) || file.size() >= sizeof(t.path)) {
+                cerr << path << ":" << lineNumber << ": neplatna textura" << endl;
+                return false;
+            }
+            memcpy(t.path, file.c_str(), file.size());
+            textures.push_back(t);
+        } else {
+            cerr << path << ":" << lineNumber << ": neznamy zaznam " << keyword << endl;
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/*!
+ * \brief Vygeneruje nahodnou scenu kouli pro testovani velkych souboru.
+ * \param count pocet kouli
+ */
+void generateRandom(size_t count, vector<SphereRecord>& spheres, vector<MaterialRecord>& materials)
+{
+    srand(1);
+
+    for (int i = 0; i < 8; ++i) {
+        MaterialRecord m;
+        m.color[0] = rand() / (float)RAND_MAX;
+        m.color[1] = rand() / (float)RAND_MAX;
+        m.color[2] = rand() / (float)RAND_MAX;
+        m.kd = 0.8f;
+        materials.push_back(m);
+    }
+
+    for (size_t i = 0; i < count; ++i) {
+        SphereRecord s;
+        memset(&s, 0, sizeof(s));
+        s.center[0] = 8.f * (rand() / (float)RAND_MAX - 0.5f);
+        s.center[1] = 8.f * (rand() / (float)RAND_MAX - 0.5f);
+        s.center[2] = 8.f * (rand() / (float)RAND_MAX - 0.5f);
+        s.radius = 0.02f + 0.1f * rand() / (float)RAND_MAX;
+        s.material = rand() % materials.size();
+        spheres.push_back(s);
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    vector<SphereRecord> spheres;
+    vector<MaterialRecord> materials;
+    vector<TextureRecord> textures;
+    string output;
+
+    if (argc == 4 && strcmp(argv[1], "--random") == 0) {
+        generateRandom(strtoul(argv[2], 0, 10), spheres, materials);
+        output = argv[3];
+    } else if (argc == 3) {
+        if (!parseText(argv[1], spheres, materials, textures))
+            return 1;
+        output = argv[2];
+    } else {
+        cout << "Pouziti: " << argv[0] << " <vstup.txt> <vystup.geom>\n"
+             << "         " << argv[0] << " --random <pocet> <vystup.geom>\n";
+        return 1;
+    }
+
+    if (materials.empty()) {
+        MaterialRecord m = { { 1.f, 0.f, 0.f }, 0.8f };
+        materials.push_back(m);
+    }
+
+    for (size_t i = 0; i < spheres.size(); ++i) {
+        if (spheres[i].material >= materials.size()) {
+            cerr << "Koule " << i << " odkazuje na neexistujici material" << endl;
+            return 1;
+        }
+    }
+
+    for (size_t i = 0; i < textures.size(); ++i) {
+        if (textures[i].material >= materials.size()) {
+            cerr << "Textura " << textures[i].path << " odkazuje na neexistujici material" << endl;
+            return 1;
+        }
+    }
+
+    GeometryFileWriter writer;
+    writer.addSection(GEOMETRY_SECTION_SPHERES, sizeof(SphereRecord), spheres.data(), spheres.size());
+    writer.addSection(GEOMETRY_SECTION_MATERIALS, sizeof(MaterialRecord), materials.data(), materials.size());
+    if (!textures.empty())
+        writer.addSection(GEOMETRY_SECTION_TEXTURES, sizeof(TextureRecord), textures.data(), textures.size());
+
+    if (!writer.write(output)) {
+        cerr << "Zapis do " << output << " selhal" << endl;
+        return 1;
+    }
+
+    cout << "Spheres: " << spheres.size() << ", materials: " << materials.size()
+         << ", textures: " << textures.size()
+         << ", written: " << output << endl;
+
+    return 0;
+}
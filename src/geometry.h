@@ -10,6 +10,7 @@
 #include <cmath>
 #include <algorithm>
 #include <assert.h>
+#include <cstdint>
 #include <limits>
 
 #include "core.h"
@@ -732,7 +733,7 @@ public:
      * Bezparametrický konstruktor.
      */
     Ray()
-        : mint(0.f), maxt(std::numeric_limits<float>::max()), rayEpsilon(EPSILON), depth(0)
+        : mint(0.f), maxt(std::numeric_limits<float>::max()), depth(0)
     {}
 
     /*!
@@ -741,12 +742,11 @@ public:
      * \param _d směr paprsku
      * \param start minimální hodnota parametru t
      * \param end maximální hodnota parametru t
-     * \param eps hodnota epsilon pro eliminaci chyb při výpočtech s desetinnou čárkou
      * \param _depth hloubka rekurze
      */
     Ray(const Point& _o, const Vector& _d, float start = 0.f, float end = std::numeric_limits<float>::max(),
-        float eps = EPSILON, int _depth = 0)
-        : o(_o), d(_d), mint(start), maxt(end), rayEpsilon(eps), depth(_depth)
+        int _depth = 0)
+        : o(_o), d(_d), mint(start), maxt(end), depth(_depth)
     {}
 
     /*!
@@ -761,10 +761,51 @@ public:
 
     Point o; ///< pocatek paprsku
     Vector d; ///< smer paprsku
-    mutable float mint; ///< minimalni hodnota parametru t
-    mutable float maxt; ///< maximalni hodnota parametru t
-    mutable float rayEpsilon; ///< vypocitane epsilon (zamezuje vzniku artefaktu)
-    mutable int depth; ///< hloubka rekurze
+    float mint; ///< minimalni hodnota parametru t
+    float maxt; ///< maximalni hodnota parametru t
+    int depth; ///< hloubka rekurze
+};
+
+/*!
+ * Paprsek pripraveny pro pruchod akceleracnimi strukturami a testy pruniku
+ * (48 B). Sestavi se jednou z Ray a behem pruchodu se nemeni, takze ho
+ * prekladac muze drzet v registrech a muze ho sdilet vice vlaken.
+ */
+struct TraversalRay {
+    /*!
+     * Konstruktor, predpocita prevracene hodnoty smeru a znamenka.
+     * \param o pocatek paprsku
+     * \param d smer paprsku
+     * \param tMin minimalni hodnota parametru t
+     * \param tMax maximalni hodnota parametru t
+     */
+    TraversalRay(const Point& o, const Vector& d, float tMin, float tMax)
+        : o(o), d(d), invDir(1.f / d.x, 1.f / d.y, 1.f / d.z), tMin(tMin), tMax(tMax),
+          signs((invDir.x < 0.f ? 1u : 0u) | (invDir.y < 0.f ? 2u : 0u) | (invDir.z < 0.f ? 4u : 0u))
+    {}
+
+    /*!
+     * Paprsek pro pruchod z paprsku ray. Dolni mez je nejmene EPSILON,
+     * aby se paprsek nezachytil na povrchu, ze ktereho vychazi.
+     */
+    explicit TraversalRay(const Ray& ray)
+        : TraversalRay(ray.o, ray.d, std::max(ray.mint, EPSILON), ray.maxt)
+    {}
+
+    /*!
+     * Je slozka smeru v ose axis zaporna? Urcuje poradi pruchodu potomku.
+     */
+    bool negative(int axis) const
+    {
+        return (signs >> axis) & 1u;
+    }
+
+    Point o; ///< pocatek paprsku
+    Vector d; ///< smer paprsku
+    Vector invDir; ///< prevracene hodnoty slozek smeru
+    float tMin; ///< minimalni hodnota parametru t
+    float tMax; ///< maximalni hodnota parametru t
+    uint32_t signs; ///< bit osy je 1, pokud je slozka smeru zaporna
 };
 
 /*!
@@ -843,4 +884,137 @@ inline float distance(const Point& p1, const Point& p2)
     Vector v(p1 - p2);
     return v.length();
 }
+
+/*!
+ * Osove zarovnany obalovy kvadr.\n
+ * Prazdny kvadr ma pMin = +nekonecno a pMax = -nekonecno, takze rozsireni
+ * o libovolny bod nebo kvadr funguje bez zvlastnich pripadu.
+ */
+class BBox
+{
+public:
+    /*!
+     * Defaultni konstruktor, vytvori prazdny kvadr.
+     */
+    BBox()
+        : pMin(std::numeric_limits<float>::infinity(), std::numeric_limits<float>::infinity(),
+               std::numeric_limits<float>::infinity()),
+          pMax(-std::numeric_limits<float>::infinity(), -std::numeric_limits<float>::infinity(),
+               -std::numeric_limits<float>::infinity())
+    {
+    }
+
+    /*!
+     * Konstruktor kvadru obsahujiciho jediny bod.
+     */
+    BBox(const Point& p)
+        : pMin(p), pMax(p)
+    {
+    }
+
+    /*!
+     * Konstruktor kvadru obsahujiciho dva body.
+     */
+    BBox(const Point& p1, const Point& p2)
+        : pMin(std::min(p1.x, p2.x), std::min(p1.y, p2.y), std::min(p1.z, p2.z)),
+          pMax(std::max(p1.x, p2.x), std::max(p1.y, p2.y), std::max(p1.z, p2.z))
+    {
+    }
+
+    /*!
+     * Rozsiri kvadr tak, aby obsahoval bod p.
+     * \return reference na this
+     */
+    BBox& expand(const Point& p)
+    {
+        pMin = Point(std::min(pMin.x, p.x), std::min(pMin.y, p.y), std::min(pMin.z, p.z));
+        pMax = Point(std::max(pMax.x, p.x), std::max(pMax.y, p.y), std::max(pMax.z, p.z));
+        return *this;
+    }
+
+    /*!
+     * Rozsiri kvadr tak, aby obsahoval kvadr b.
+     * \return reference na this
+     */
+    BBox& expand(const BBox& b)
+    {
+        pMin = Point(std::min(pMin.x, b.pMin.x), std::min(pMin.y, b.pMin.y), std::min(pMin.z, b.pMin.z));
+        pMax = Point(std::max(pMax.x, b.pMax.x), std::max(pMax.y, b.pMax.y), std::max(pMax.z, b.pMax.z));
+        return *this;
+    }
+
+    /*!
+     * Je kvadr prazdny?
+     */
+    bool isEmpty() const
+    {
+        return pMin.x > pMax.x || pMin.y > pMax.y || pMin.z > pMax.z;
+    }
+
+    /*!
+     * Stred kvadru.
+     */
+    Point centroid() const
+    {
+        return (pMin + pMax) * 0.5f;
+    }
+
+    /*!
+     * Uhlopricka kvadru.
+     */
+    Vector diagonal() const
+    {
+        return pMax - pMin;
+    }
+
+    /*!
+     * Povrch kvadru (pro prazdny kvadr 0).
+     */
+    float surfaceArea() const
+    {
+        if (isEmpty())
+            return 0.f;
+
+        Vector d = diagonal();
+        return 2.f * (d.x * d.y + d.x * d.z + d.y * d.z);
+    }
+
+    /*!
+     * Index osy (0, 1, 2), ve ktere je kvadr nejdelsi.
+     */
+    int maximumExtent() const
+    {
+        Vector d = diagonal();
+        if (d.x > d.y && d.x > d.z)
+            return 0;
+        return d.y > d.z ? 1 : 2;
+    }
+
+    /*!
+     * Test pruniku paprsku s kvadrem metodou slabu.
+     * \param ray paprsek
+     * \param tMax nejvetsi uvazovana hodnota parametru t
+     * \return true pokud paprsek protne kvadr v intervalu [0, tMax]
+     */
+    bool intersectP(const TraversalRay& ray, float tMax) const
+    {
+        float t0 = 0.f, t1 = tMax;
+        for (int i = 0; i < 3; ++i) {
+            float tNear = (pMin[i] - ray.o[i]) * ray.invDir[i];
+            float tFar = (pMax[i] - ray.o[i]) * ray.invDir[i];
+            if (tNear > tFar)
+                std::swap(tNear, tFar);
+
+            t0 = tNear > t0 ? tNear : t0;
+            t1 = tFar < t1 ? tFar : t1;
+            if (t0 > t1)
+                return false;
+        }
+
+        return true;
+    }
+
+    Point pMin; ///< roh s nejmensimi souradnicemi
+    Point pMax; ///< roh s nejvetsimi souradnicemi
+};
 #endif
@@ -0,0 +1,220 @@
+#include "geometryfile.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+GeometryFile::GeometryFile()
+    : data(0), size(0)
+{}
+
+GeometryFile::~GeometryFile()
+{
+    close();
+}
+
+bool GeometryFile::open(const std::string& path)
+{
+    close();
+
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return fail("nelze otevrit soubor " + path);
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(GeometryFileHeader)) {
+        ::close(fd);
+        return fail("soubor " + path + " je prilis kratky");
+    }
+
+    void* mapped = mmap(0, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (mapped == MAP_FAILED)
+        return fail("mmap souboru " + path + " selhal");
+
+    data = static_cast<const unsigned char*>(mapped);
+    size = st.st_size;
+
+    const GeometryFileHeader* header = reinterpret_cast<const GeometryFileHeader*>(data);
+    if (header->magic != GEOMETRY_FILE_MAGIC)
+        return fail(path + " neni soubor geometrie");
+    if (header->version != GEOMETRY_FILE_VERSION)
+        return fail(path + " ma nepodporovanou verzi formatu");
+    if (header->sectionCount > GEOMETRY_FILE_MAX_SECTIONS)
+        return fail(path + " ma poskozenou tabulku sekci");
+
+    for (uint32_t i = 0; i < header->sectionCount; ++i) {
+        const GeometrySection& s = header->sections[i];
+        //soucin count * stride muze u poskozeneho souboru pretect, deli se
+        if (s.offset % GEOMETRY_FILE_ALIGNMENT != 0
+                || s.offset > size
+                || s.stride == 0
+                || s.count > (size - s.offset) / s.stride)
+            return fail(path + " ma sekci mimo rozsah souboru");
+    }
+
+    //prochazeni sekci je nahodne podle toho, kam miri paprsky
+    madvise(mapped, size, MADV_RANDOM);
+
+    return true;
+}
+
+void GeometryFile::close()
+{
+    if (data)
+        munmap(const_cast<unsigned char*>(data), size);
+
+    data = 0;
+    size = 0;
+}
+
+const std::string& GeometryFile::errorString() const
+{
+    return error;
+}
+
+const void* GeometryFile::section(uint32_t type, uint32_t stride, size_t& count) const
+{
+    count = 0;
+    if (!data)
+        return 0;
+
+    const GeometryFileHeader* header = reinterpret_cast<const GeometryFileHeader*>(data);
+    for (uint32_t i = 0; i < header->sectionCount; ++i) {
+        const GeometrySection& s = header->sections[i];
+        if (s.type == type && s.stride == stride) {
+            count = s.count;
+            return data + s.offset;
+        }
+    }
+
+    return 0;
+}
+
+const SphereRecord* GeometryFile::spheres(size_t& count) const
+{
+    return static_cast<const SphereRecord*>(
+               section(GEOMETRY_SECTION_SPHERES, sizeof(SphereRecord), count));
+}
+
+const MaterialRecord* GeometryFile::materials(size_t& count) const
+{
+    return static_cast<const MaterialRecord*>(
+               section(GEOMETRY_SECTION_MATERIALS, sizeof(MaterialRecord), count));
+}
+
+const TextureRecord* GeometryFile::textures(size_t& count) const
+{
+    return static_cast<const TextureRecord*>(
+               section(GEOMETRY_SECTION_TEXTURES, sizeof(TextureRecord), count));
+}
+
+size_t GeometryFile::fileSize() const
+{
+    return size;
+}
+
+size_t GeometryFile::residentBytes() const
+{
+    if (!data)
+        return 0;
+
+    const size_t page = sysconf(_SC_PAGESIZE);
+    const size_t pages = (size + page - 1) / page;
+    std::vector<unsigned char> vec(pages);
+
+    if (mincore(const_cast<unsigned char*>(data), size, vec.data()) != 0)
+        return 0;
+
+    size_t resident = 0;
+    for (size_t i = 0; i < pages; ++i) {
+        if (vec[i] & 1)
+            resident += page;
+    }
+
+    return std::min(resident, size);
+}
+
+FileStamp fileStamp(const std::string& path)
+{
+    FileStamp stamp;
+    struct stat st;
+    if (stat(path.c_str(), &st) == 0) {
+        stamp.size = st.st_size;
+        stamp.mtime = static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+    }
+
+    return stamp;
+}
+
+bool GeometryFile::fail(const std::string& message)
+{
+    close();
+    error = message;
+    return false;
+}
+
+
+//GeometryFileWriter
+void GeometryFileWriter::addSection(uint32_t type, uint32_t stride, const void* records, size_t count)
+{
+    PendingSection s;
+    s.type = type;
+    s.stride = stride;
+    s.count = count;
+
+    const unsigned char* bytes = static_cast<const unsigned char*>(records);
+    s.bytes.assign(bytes, bytes + stride * count);
+
+    pending.push_back(s);
+}
+
+bool GeometryFileWriter::write(const std::string& path) const
+{
+    if (pending.size() > GEOMETRY_FILE_MAX_SECTIONS)
+        return false;
+
+    GeometryFileHeader header;
+    memset(&header, 0, sizeof(header));
+    header.magic = GEOMETRY_FILE_MAGIC;
+    header.version = GEOMETRY_FILE_VERSION;
+    header.sectionCount = static_cast<uint32_t>(pending.size());
+
+    //rozlozeni sekci, kazda zacina na nove strance
+    uint64_t offset = GEOMETRY_FILE_ALIGNMENT;
+    for (size_t i = 0; i < pending.size(); ++i) {
+        GeometrySection& s = header.sections[i];
+        s.type = pending[i].type;
+        s.stride = pending[i].stride;
+        s.count = pending[i].count;
+        s.offset = offset;
+
+        uint64_t bytes = pending[i].bytes.size();
+        offset += (bytes + GEOMETRY_FILE_ALIGNMENT - 1) / GEOMETRY_FILE_ALIGNMENT * GEOMETRY_FILE_ALIGNMENT;
+    }
+
+    std::ofstream ofs(path, std::ios::binary | std::ios::out);
+    if (!ofs)
+        return false;
+
+    std::vector<char> padding(GEOMETRY_FILE_ALIGNMENT, 0);
+
+    ofs.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    ofs.write(padding.data(), GEOMETRY_FILE_ALIGNMENT - sizeof(header));
+
+    for (size_t i = 0; i < pending.size(); ++i) {
+        const std::vector<unsigned char>& bytes = pending[i].bytes;
+        ofs.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+
+        size_t tail = bytes.size() % GEOMETRY_FILE_ALIGNMENT;
+        if (tail != 0)
+            ofs.write(padding.data(), GEOMETRY_FILE_ALIGNMENT - tail);
+    }
+
+    return ofs.good();
+}
@@ -0,0 +1,223 @@
+#ifndef GEOMETRYFILE_H
+#define GEOMETRYFILE_H
+
+/*!
+ * \file
+ * Binarni format geometrie sceny urceny pro primy pristup pomoci mmap.\n
+ * Soubor se sklada z hlavicky a tabulky sekci. Kazda sekce zacina na hranici
+ * stranky (GEOMETRY_FILE_ALIGNMENT), takze ji lze po namapovani pouzivat primo
+ * jako pole zaznamu bez jakehokoliv parsovani. Operacni system nacita jen ty
+ * stranky, na ktere paprsky skutecne sahnou.
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "core.h"
+
+const uint32_t GEOMETRY_FILE_MAGIC = 0x4d4f4547; ///< "GEOM" v little endian
+const uint32_t GEOMETRY_FILE_VERSION = 1; ///< verze formatu
+const size_t GEOMETRY_FILE_ALIGNMENT = 4096; ///< zarovnani sekci (velikost stranky)
+const uint32_t GEOMETRY_FILE_MAX_SECTIONS = 16; ///< maximalni pocet sekci
+
+/*!
+ * Typy sekci v souboru geometrie.
+ */
+enum GeometrySectionType {
+    GEOMETRY_SECTION_SPHERES = 1, ///< pole SphereRecord
+    GEOMETRY_SECTION_MATERIALS = 2, ///< pole MaterialRecord
+    GEOMETRY_SECTION_NODES = 3, ///< uzly akceleracni struktury
+    GEOMETRY_SECTION_INDICES = 4, ///< indexy prvku serazene podle listu hierarchie
+    GEOMETRY_SECTION_CACHE_INFO = 5, ///< popis hierarchie ulozene v cache (BVHCacheInfo)
+    GEOMETRY_SECTION_TEXTURES = 6 ///< pole TextureRecord
+};
+
+/*!
+ * Zaznam jedne koule. Velikost 32 B, tj. dva zaznamy na polovinu cache line.
+ */
+struct SphereRecord {
+    float center[3]; ///< stred koule
+    float radius; ///< polomer
+    uint32_t material; ///< index do sekce materialu
+    uint32_t reserved[3]; ///< vyplne do 32 B
+};
+
+/*!
+ * Zaznam materialu typu Matte.
+ */
+struct MaterialRecord {
+    float color[3]; ///< zakladni barva
+    float kd; ///< difuzni koeficient
+};
+
+/*!
+ * Prirazeni textury materialu. Barvu materialu pak urcuje textura,
+ * difuzni koeficient zustava z MaterialRecord.
+ */
+struct TextureRecord {
+    uint32_t material; ///< index do sekce materialu
+    char path[124]; ///< soubor textury, relativni cesta je vztazena k souboru geometrie
+};
+
+/*!
+ * Popis jedne sekce v tabulce sekci.
+ */
+struct GeometrySection {
+    uint32_t type; ///< GeometrySectionType
+    uint32_t stride; ///< velikost jednoho zaznamu v bajtech
+    uint64_t offset; ///< pozice zacatku sekce od zacatku souboru
+    uint64_t count; ///< pocet zaznamu
+};
+
+/*!
+ * Hlavicka souboru geometrie. Lezi na zacatku prvni stranky.
+ */
+struct GeometryFileHeader {
+    uint32_t magic; ///< GEOMETRY_FILE_MAGIC
+    uint32_t version; ///< GEOMETRY_FILE_VERSION
+    uint32_t sectionCount; ///< pocet platnych zaznamu v sections
+    uint32_t reserved;
+    GeometrySection sections[GEOMETRY_FILE_MAX_SECTIONS]; ///< tabulka sekci
+};
+
+/*!
+ * Velikost a cas posledni zmeny souboru, podle kterych se pozna,
+ * ze byl soubor od posledniho nacteni prepsan.
+ */
+struct FileStamp {
+    FileStamp()
+        : size(0), mtime(0)
+    {}
+
+    uint64_t size; ///< velikost v bajtech
+    int64_t mtime; ///< cas posledni zmeny v ns (0 = soubor neexistuje)
+
+    bool operator ==(const FileStamp& other) const
+    {
+        return size == other.size && mtime == other.mtime;
+    }
+
+    bool operator !=(const FileStamp& other) const
+    {
+        return !(*this == other);
+    }
+};
+
+/*!
+ * \brief Zjisti velikost a cas posledni zmeny souboru.
+ * \param path cesta k souboru
+ * \return prazdny otisk, pokud soubor neexistuje
+ */
+FileStamp fileStamp(const std::string& path);
+
+/*!
+ * Soubor geometrie namapovany do pameti. Data jsou jen pro cteni a zustavaji
+ * platna po celou dobu zivota objektu.
+ */
+class GeometryFile
+{
+public:
+    GeometryFile();
+    ~GeometryFile();
+
+    /*!
+     * \brief Namapuje soubor do pameti a zkontroluje hlavicku.
+     * \param path cesta k souboru
+     * \return true pokud se soubor podarilo otevrit
+     */
+    bool open(const std::string& path);
+
+    /*!
+     * \brief Odmapuje soubor.
+     */
+    void close();
+
+    /*!
+     * \brief Popis posledni chyby.
+     */
+    const std::string& errorString() const;
+
+    /*!
+     * \brief Najde sekci daneho typu.
+     * \param type typ sekce
+     * \param stride ocekavana velikost zaznamu
+     * \param [out] count pocet zaznamu v sekci
+     * \return ukazatel na prvni zaznam, nebo 0 pokud sekce neexistuje
+     */
+    const void* section(uint32_t type, uint32_t stride, size_t& count) const;
+
+    /*!
+     * \brief Pole kouli primo v namapovane pameti.
+     */
+    const SphereRecord* spheres(size_t& count) const;
+
+    /*!
+     * \brief Pole materialu primo v namapovane pameti.
+     */
+    const MaterialRecord* materials(size_t& count) const;
+
+    /*!
+     * \brief Pole prirazeni textur primo v namapovane pameti.
+     */
+    const TextureRecord* textures(size_t& count) const;
+
+    /*!
+     * \brief Velikost souboru v bajtech.
+     */
+    size_t fileSize() const;
+
+    /*!
+     * \brief Pocet bajtu souboru, ktere jsou prave v operacni pameti.
+     */
+    size_t residentBytes() const;
+
+private:
+    GeometryFile(const GeometryFile&);
+    GeometryFile& operator =(const GeometryFile&);
+
+    bool fail(const std::string& message);
+
+private:
+    const unsigned char* data; ///< zacatek namapovane oblasti
+    size_t size; ///< velikost namapovane oblasti
+    std::string error; ///< posledni chyba
+};
+
+/*!
+ * Pomocna trida pro zapis souboru geometrie. Sekce se drzi v pameti
+ * a zapisi se najednou metodou write().
+ */
+class GeometryFileWriter
+{
+public:
+    /*!
+     * \brief Prida sekci.
+     * \param type typ sekce
+     * \param stride velikost zaznamu
+     * \param records ukazatel na zaznamy
+     * \param count pocet zaznamu
+     */
+    void addSection(uint32_t type, uint32_t stride, const void* records, size_t count);
+
+    /*!
+     * \brief Zapise hlavicku a vsechny sekce zarovnane na GEOMETRY_FILE_ALIGNMENT.
+     * \param path cilovy soubor
+     * \return true pri uspechu
+     */
+    bool write(const std::string& path) const;
+
+private:
+    struct PendingSection {
+        uint32_t type;
+        uint32_t stride;
+        size_t count;
+        std::vector<unsigned char> bytes;
+    };
+
+    std::vector<PendingSection> pending;
+};
+
+#endif // GEOMETRYFILE_H
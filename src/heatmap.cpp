@@ -0,0 +1,140 @@
+#include "heatmap.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "imageio.h"
+
+namespace {
+
+/*!
+ * Body barevne skaly od nejlevnejsiho po nejdrazsi pixel.
+ */
+const float RAMP[][3] = {
+    { 0.f, 0.f, 0.f },
+    { 0.1f, 0.1f, 0.7f },
+    { 0.8f, 0.1f, 0.5f },
+    { 1.f, 0.5f, 0.f },
+    { 1.f, 1.f, 0.2f },
+    { 1.f, 1.f, 1.f }
+};
+
+const int RAMP_STEPS = sizeof(RAMP) / sizeof(RAMP[0]) - 1;
+
+void falseColor(float value, unsigned char* rgb)
+{
+    const float position = std::min(std::max(value, 0.f), 1.f) * RAMP_STEPS;
+    const int i = std::min(static_cast<int>(position), RAMP_STEPS - 1);
+    const float f = position - i;
+
+    for (int c = 0; c < 3; ++c)
+        rgb[c] = static_cast<unsigned char>(255.f * (RAMP[i][c] + f * (RAMP[i + 1][c] - RAMP[i][c])) + 0.5f);
+}
+
+}
+
+PixelCost& PixelCost::operator +=(const PixelCost& c)
+{
+    tests += c.tests;
+    shadowRays += c.shadowRays;
+    cycles += c.cycles;
+    return *this;
+}
+
+uint64_t readCycleCounter()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+CostHeatmap::CostHeatmap(const CropWindow& window)
+    : window(window), pixels(window.pixelCount())
+{}
+
+void CostHeatmap::add(size_t x, size_t y, const PixelCost& cost)
+{
+    pixels[(y - window.y0) * window.width() + x - window.x0] += cost;
+}
+
+const PixelCost& CostHeatmap::at(size_t x, size_t y) const
+{
+    return pixels[(y - window.y0) * window.width() + x - window.x0];
+}
+
+bool CostHeatmap::write(const std::string& ppmPath, const std::string& pfmPath) const
+{
+    //takty maji dlouhy chvost (silueta, husta geometrie), proto logaritmicka skala;
+    //horni mez je 99.9. percentil, aby skalu neurcil par pixelu preruseni planovacem
+    std::vector<float> values(pixels.size());
+    for (size_t i = 0; i < pixels.size(); ++i)
+        values[i] = std::log1p(static_cast<float>(pixels[i].cycles));
+
+    float low = 0.f, high = 0.f;
+    if (!values.empty()) {
+        low = *std::min_element(values.begin(), values.end());
+        std::vector<float>::iterator top = values.begin() + (values.size() - 1) * 999 / 1000;
+        std::nth_element(values.begin(), top, values.end());
+        high = *top;
+    }
+    const float range = high > low ? high - low : 1.f;
+
+    std::ofstream ofs(ppmPath, std::ios::binary | std::ios::out);
+    if (!ofs)
+        return false;
+
+    ofs << "P6\n" << window.width() << " " << window.height() << "\n255\n";
+
+    std::vector<unsigned char> row(window.width() * 3);
+    std::vector<float> raw(pixels.size() * 3);
+    for (size_t y = 0; y < window.height(); ++y) {
+        for (size_t x = 0; x < window.width(); ++x) {
+            const size_t i = y * window.width() + x;
+            falseColor((std::log1p(static_cast<float>(pixels[i].cycles)) - low) / range, &row[3 * x]);
+
+            raw[3 * i] = static_cast<float>(pixels[i].tests);
+            raw[3 * i + 1] = static_cast<float>(pixels[i].shadowRays);
+            raw[3 * i + 2] = static_cast<float>(pixels[i].cycles);
+        }
+        ofs.write(reinterpret_cast<const char*>(row.data()), row.size());
+    }
+
+    ofs.close();
+    if (!ofs)
+        return false;
+
+    return writePFM(pfmPath, window.width(), window.height(), 3, raw.data());
+}
+
+void CostHeatmap::printSummary(std::ostream& out) const
+{
+    PixelCost total;
+    size_t expensive = 0;
+    for (size_t i = 0; i < pixels.size(); ++i) {
+        total += pixels[i];
+        if (pixels[i].cycles > pixels[expensive].cycles)
+            expensive = i;
+    }
+
+    const double count = static_cast<double>(std::max<size_t>(pixels.size(), 1));
+    out << "Pixel cost: " << total.tests / count << " primitive tests, "
+        << total.shadowRays / count << " shadow rays, " << total.cycles / count
+        << " cycles per pixel" << std::endl;
+
+    if (!pixels.empty()) {
+        const PixelCost& max = pixels[expensive];
+        out << "Most expensive pixel: " << window.x0 + expensive % window.width() << " "
+            << window.y0 + expensive / window.width() << ", " << max.tests << " tests, "
+            << max.shadowRays << " shadow rays, " << max.cycles << " cycles ("
+            << max.cycles * count / std::max<double>(total.cycles, 1.0) << "x mean)" << std::endl;
+    }
+}
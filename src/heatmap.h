@@ -0,0 +1,85 @@
+#ifndef HEATMAP_H
+#define HEATMAP_H
+
+/*!
+ * \file
+ * Diagnosticka mapa ceny pixelu.\n
+ * Pro kazdy pixel se pocita pocet testu pruseciku s primitivy (primarni
+ * i stinove paprsky), pocet stinovych paprsku a takty procesoru straveny
+ * sledovanim a stinovanim jeho vzorku. Mapa se ulozi jako obrazek
+ * v nepravych barvach a jako surova data v PFM.
+ */
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "tile.h"
+
+/*!
+ * Cena jednoho pixelu, soucet pres vsechny jeho vzorky.
+ */
+struct PixelCost {
+    PixelCost()
+        : tests(0), shadowRays(0), cycles(0)
+    {}
+
+    PixelCost& operator +=(const PixelCost& c);
+
+    uint64_t tests; ///< testy pruseciku s primitivy
+    uint64_t shadowRays; ///< sledovane stinove paprsky
+    uint64_t cycles; ///< takty procesoru (bez rdtsc nanosekundy)
+};
+
+/*!
+ * \brief Aktualni hodnota citace taktu volajiciho procesoru.
+ */
+uint64_t readCycleCounter();
+
+/*!
+ * Mapa ceny pixelu vyrezu filmu. Kazdy pixel zapisuje jen vlakno jeho
+ * dlazdice, zapis proto nepotrebuje zamek.
+ */
+class CostHeatmap
+{
+public:
+    /*!
+     * \brief Konstruktor, vsechny pixely maji nulovou cenu.
+     * \param window vyrez filmu
+     */
+    explicit CostHeatmap(const CropWindow& window);
+
+    /*!
+     * \brief Pricte cenu pixelu.
+     * \param x poloha ve vodorovnem smeru (souradnice filmu)
+     * \param y poloha ve svislem smeru (souradnice filmu)
+     */
+    void add(size_t x, size_t y, const PixelCost& cost);
+
+    /*!
+     * \brief Cena pixelu.
+     */
+    const PixelCost& at(size_t x, size_t y) const;
+
+    /*!
+     * \brief Ulozi takty jako obrazek v nepravych barvach (logaritmicka skala,
+     * cerna az bila pres modrou, cervenou a zlutou) a vsechny tri hodnoty jako
+     * tri kanaly PFM (testy, stinove paprsky, takty).
+     * \param ppmPath cesta k obrazku PPM
+     * \param pfmPath cesta k surovym datum PFM
+     * \return true pri uspechu
+     */
+    bool write(const std::string& ppmPath, const std::string& pfmPath) const;
+
+    /*!
+     * \brief Vypise prumernou cenu pixelu a nejdrazsi pixel.
+     */
+    void printSummary(std::ostream& out) const;
+
+private:
+    CropWindow window;
+    std::vector<PixelCost> pixels; ///< po radcich vyrezu
+};
+
+#endif // HEATMAP_H
@@ -0,0 +1,30 @@
+#include "imageio.h"
+
+#include <fstream>
+
+bool writePFM(const std::string& path, size_t width, size_t height, int channels, const float* data)
+{
+    std::ofstream ofs(path, std::ios::binary | std::ios::out);
+    if (!ofs)
+        return false;
+
+    //zaporne meritko znaci little endian
+    ofs << (channels == 3 ? "PF" : "Pf") << "\n" << width << " " << height << "\n-1.0\n";
+
+    const size_t rowSize = width * channels;
+    for (size_t y = height; y-- > 0;)
+        ofs.write(reinterpret_cast<const char*>(data + y * rowSize), rowSize * sizeof(float));
+
+    return ofs.good();
+}
+
+std::string derivedPath(const std::string& output, const std::string& suffix)
+{
+    const size_t slash = output.find_last_of("/\\");
+    const size_t dot = output.find_last_of('.');
+
+    if (dot == std::string::npos || (slash != std::string::npos && dot < slash))
+        return output + "." + suffix;
+
+    return output.substr(0, dot) + "." + suffix;
+}
@@ -0,0 +1,26 @@
+#ifndef IMAGEIO_H
+#define IMAGEIO_H
+
+#include <string>
+
+/*!
+ * \brief Ulozi pole hodnot do obrazku PFM (Portable Float Map).
+ * Radky se zapisuji odspodu, jak format vyzaduje.
+ * \param path cesta k souboru
+ * \param width sirka obrazku
+ * \param height vyska obrazku
+ * \param channels pocet kanalu (1 nebo 3)
+ * \param data hodnoty po radcich shora, channels hodnot na pixel
+ * \return true pri uspechu
+ */
+bool writePFM(const std::string& path, size_t width, size_t height, int channels, const float* data);
+
+/*!
+ * \brief Odvodi jmeno souboru pomocneho vystupu z hlavniho vystupu.
+ * Napr. "out/render.ppm" a "depth.pfm" da "out/render.depth.pfm".
+ * \param output cesta k hlavnimu vystupu
+ * \param suffix pripona pomocneho vystupu
+ */
+std::string derivedPath(const std::string& output, const std::string& suffix);
+
+#endif // IMAGEIO_H
@@ -0,0 +1,227 @@
+#include "imagewriter.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <sstream>
+
+#include "film.h"
+#include "trace.h"
+
+ImageWriter::ImageWriter(TraceRecorder* recorder)
+    : recorder(recorder), film(0), bands(0), bandHeight(0), openHeaderSize(0), openBandSize(0),
+      unread(0), busy(0), running(true)
+{
+    thread = std::thread(&ImageWriter::run, this);
+}
+
+ImageWriter::~ImageWriter()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        running = false;
+    }
+
+    wake.notify_all();
+    thread.join();
+}
+
+void ImageWriter::begin(const std::string& path, const Film& film, const TileGrid& grid,
+                        const ToneMapper& toneMapper)
+{
+    this->path = path;
+    this->film = &film;
+    this->grid.reset(new TileGrid(grid));
+    this->toneMapper.reset(new ToneMapper(toneMapper));
+
+    const CropWindow& window = grid.window();
+    bandHeight = grid.tileSize();
+    bands = (window.height() + bandHeight - 1) / bandHeight;
+
+    std::ostringstream ppm;
+    ppm << "P6\n" << window.width() << " " << window.height() << "\n255\n";
+    header = ppm.str();
+
+    //pas obsahuje cely radek dlazdic, mrizka ma ve vsech radcich stejny pocet sloupcu
+    const size_t columns = bands > 0 ? grid.count() / bands : 0;
+    remaining.reset(new std::atomic<size_t>[bands]);
+    submitted.reset(new std::atomic<bool>[bands]);
+    for (size_t b = 0; b < bands; ++b) {
+        remaining[b].store(columns, std::memory_order_relaxed);
+        submitted[b].store(false, std::memory_order_relaxed);
+    }
+
+    push(Task::OPEN);
+}
+
+void ImageWriter::tileDone(size_t index)
+{
+    const size_t band = (grid->tile(index).y0 - grid->window().y0) / bandHeight;
+
+    //posledni dlazdice pasu ziska (acq_rel) zapisy filmu vsech ostatnich vlaken
+    if (remaining[band].fetch_sub(1, std::memory_order_acq_rel) == 1)
+        submitBand(band);
+}
+
+void ImageWriter::finish()
+{
+    for (size_t b = 0; b < bands; ++b)
+        submitBand(b);
+
+    push(Task::CLOSE);
+
+    std::unique_lock<std::mutex> lock(mutex);
+    progress.wait(lock, [this]() { return unread == 0; });
+}
+
+void ImageWriter::cancel()
+{
+    push(Task::DISCARD);
+
+    std::unique_lock<std::mutex> lock(mutex);
+    progress.wait(lock, [this]() { return unread == 0; });
+}
+
+bool ImageWriter::wait()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    progress.wait(lock, [this]() { return busy == 0; });
+
+    const bool ok = failure.empty();
+    failure.clear();
+    return ok;
+}
+
+std::string ImageWriter::error() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return lastFailure;
+}
+
+void ImageWriter::push(Task::Type type, size_t band)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        Task task = { type, band };
+        tasks.push_back(task);
+        ++busy;
+        if (type == Task::OPEN || type == Task::BAND)
+            ++unread;
+    }
+
+    wake.notify_one();
+}
+
+void ImageWriter::submitBand(size_t band)
+{
+    if (!submitted[band].exchange(true))
+        push(Task::BAND, band);
+}
+
+void ImageWriter::encode(size_t band, std::vector<unsigned char>& data) const
+{
+    const CropWindow& window = grid->window();
+    const size_t y0 = window.y0 + band * bandHeight;
+    const size_t y1 = std::min(y0 + bandHeight, window.y1);
+    const size_t rowSize = window.width() * 3;
+
+    data.resize((y1 - y0) * rowSize);
+    for (size_t y = y0; y < y1; ++y)
+        toneMapper->map(film->row(window.x0, y), &data[(y - y0) * rowSize], rowSize);
+}
+
+void ImageWriter::fail(const std::string& message)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (failure.empty())
+        failure = lastFailure = message;
+}
+
+void ImageWriter::release()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        --unread;
+    }
+    progress.notify_all();
+}
+
+void ImageWriter::run()
+{
+    if (recorder)
+        recorder->nameThread("writer");
+
+    std::vector<unsigned char> data;
+
+    for (;;) {
+        Task task;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [this]() { return !tasks.empty() || !running; });
+            if (tasks.empty())
+                return;
+
+            task = tasks.front();
+            tasks.pop_front();
+        }
+
+        const std::string part = openPath + ".part";
+
+        switch (task.type) {
+        case Task::OPEN: {
+            TraceScope scope(recorder, "open", "io");
+            openPath = path;
+            openHeaderSize = header.size();
+            openBandSize = bandHeight * grid->window().width() * 3;
+
+            file.open(openPath + ".part", std::ios::binary | std::ios::out | std::ios::trunc);
+            file.write(header.data(), header.size());
+            release();
+
+            if (!file)
+                fail("nelze vytvorit " + openPath + ".part");
+            break;
+        }
+        case Task::BAND: {
+            {
+                TraceScope scope(recorder, "encode", "io", "band", static_cast<int64_t>(task.band));
+                encode(task.band, data);
+            }
+
+            //film uz neni potreba, volajici finish() muze pokracovat
+            release();
+
+            TraceScope scope(recorder, "write", "io", "band", static_cast<int64_t>(task.band));
+            if (file.is_open()) {
+                file.seekp(static_cast<std::streamoff>(openHeaderSize + task.band * openBandSize));
+                file.write(reinterpret_cast<const char*>(data.data()), data.size());
+            }
+            break;
+        }
+        case Task::CLOSE: {
+            TraceScope scope(recorder, "close", "io");
+            if (!file.is_open())
+                break;
+
+            file.close();
+            if (!file)
+                fail("zapis do " + part + " selhal");
+            else if (std::rename(part.c_str(), openPath.c_str()) != 0)
+                fail("nelze prejmenovat " + part + " na " + openPath);
+            break;
+        }
+        case Task::DISCARD:
+            //pasy zahozeneho obrazku uz mohou byt zapsane, soubor se smaze cely
+            if (file.is_open()) {
+                file.close();
+                std::remove(part.c_str());
+            }
+            break;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            --busy;
+        }
+        progress.notify_all();
+    }
+}
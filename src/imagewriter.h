@@ -0,0 +1,148 @@
+#ifndef IMAGEWRITER_H
+#define IMAGEWRITER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "core.h"
+
+#include "tile.h"
+#include "tonemap.h"
+
+class TraceRecorder;
+
+/*!
+ * Asynchronni ukladani obrazku PPM z vlastniho vlakna.\n
+ * Film se kopiruje po pasech (radcich dlazdic): jakmile renderovaci vlakna
+ * dokonci vsechny dlazdice pasu, zapisovac ho prevede tonovou krivkou
+ * a zapise na jeho misto v souboru, zatimco render pokracuje. Po posledni
+ * dlazdici zbyva jen zpracovat posledni pas.
+ *
+ * Film se cte jen do konce finish(), samotny zapis na disk pak bezi dal
+ * soubezne s renderem dalsiho snimku. Obrazek se zapisuje do docasneho
+ * souboru (cesta + ".part"), ktery se po dokonceni prejmenuje, takze
+ * prerusenym renderem se puvodni vystup neprepise.
+ */
+class ImageWriter
+{
+public:
+    /*!
+     * \brief Konstruktor, spusti vlakno zapisovace.
+     * \param recorder casova osa pro kodovani a zapis (0 = nezaznamenavat)
+     */
+    explicit ImageWriter(TraceRecorder* recorder = 0);
+
+    /*!
+     * \brief Dokonci vsechny zapisy a ukonci vlakno.
+     */
+    ~ImageWriter();
+
+    /*!
+     * \brief Zacne novy obrazek. Predchozi obrazek musi byt ukoncen
+     * metodou finish() nebo cancel(), jeho zapis ale jeste muze bezet.
+     * \param path cesta k vystupnimu obrazku
+     * \param film film, ze ktereho se cte
+     * \param grid dlazdice ukladaneho vyrezu
+     * \param toneMapper prevod linearnich hodnot na 8bitove
+     */
+    void begin(const std::string& path, const Film& film, const TileGrid& grid,
+               const ToneMapper& toneMapper);
+
+    /*!
+     * \brief Dlazdice je hotova a uz se nezmeni. Je-li hotovy cely jeji pas,
+     * preda se zapisovaci. Lze volat soubezne z vice vlaken.
+     * \param index index dlazdice v mrizce
+     */
+    void tileDone(size_t index);
+
+    /*!
+     * \brief Preda zapisovaci vsechny dosud neodeslane pasy a pocka, az je
+     * z filmu precte. Potom lze film znovu pouzit, zapis na disk bezi dal.
+     */
+    void finish();
+
+    /*!
+     * \brief Zahodi rozpracovany obrazek, puvodni soubor zustane beze zmeny.
+     */
+    void cancel();
+
+    /*!
+     * \brief Pocka na dokonceni vsech zapisu.
+     * \return false pokud nektery zapis od posledniho volani selhal (viz error())
+     */
+    bool wait();
+
+    /*!
+     * \brief Popis posledni chyby zapisu.
+     */
+    std::string error() const;
+
+private:
+    ImageWriter(const ImageWriter&);
+    ImageWriter& operator =(const ImageWriter&);
+
+    /*!
+     * Uloha pro vlakno zapisovace.
+     */
+    struct Task {
+        enum Type {
+            OPEN, ///< vytvorit soubor a zapsat hlavicku
+            BAND, ///< zakodovat a zapsat pas
+            CLOSE, ///< dokoncit soubor a prejmenovat ho
+            DISCARD ///< zavrit a smazat docasny soubor
+        } type;
+        size_t band; ///< index pasu (BAND)
+    };
+
+    void push(Task::Type type, size_t band = 0);
+    void submitBand(size_t band);
+    void run();
+
+    /*!
+     * \brief Uloha dokoncila cteni filmu a parametru obrazku.
+     */
+    void release();
+
+    void encode(size_t band, std::vector<unsigned char>& data) const;
+    void fail(const std::string& message);
+
+private:
+    TraceRecorder* recorder;
+
+    //aktualni obrazek, meni se jen kdyz zapisovac z filmu nic necte
+    std::string path;
+    const Film* film;
+    std::unique_ptr<TileGrid> grid;
+    std::unique_ptr<ToneMapper> toneMapper;
+    size_t bands; ///< pocet pasu
+    size_t bandHeight; ///< vyska pasu v pixelech
+    std::string header; ///< hlavicka PPM
+    std::unique_ptr<std::atomic<size_t>[]> remaining; ///< nehotove dlazdice kazdeho pasu
+    std::unique_ptr<std::atomic<bool>[]> submitted; ///< pas byl predan zapisovaci
+
+    //prave zapisovany soubor, pouziva jen vlakno zapisovace
+    std::ofstream file;
+    std::string openPath; ///< cesta k vystupu
+    size_t openHeaderSize; ///< delka hlavicky v bajtech
+    size_t openBandSize; ///< bajtu na pas (posledni pas muze byt kratsi)
+
+    std::thread thread;
+    mutable std::mutex mutex;
+    std::condition_variable wake; ///< nova uloha nebo konec
+    std::condition_variable progress; ///< zmena poctu nezpracovanych uloh
+    std::deque<Task> tasks;
+    size_t unread; ///< ulohy, ktere jeste ctou film nebo parametry aktualniho obrazku
+    size_t busy; ///< nedokoncene ulohy vcetne prave zpracovavane
+    bool running;
+    std::string failure; ///< prvni chyba od posledniho wait()
+    std::string lastFailure; ///< posledni ohlasena chyba
+};
+
+#endif // IMAGEWRITER_H
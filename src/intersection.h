@@ -1,6 +1,7 @@
 #ifndef INTERSECTION_H
 #define INTERSECTION_H
 
+#include <cstdint>
 #include <memory>
 #include <limits>
 
@@ -9,6 +10,27 @@
 #include "geometry.h"
 #include "material.h"
 
+/**
+ * Výsledek levné fáze hledání průsečíku: jen parametr t a zasažené těleso.
+ * Atributy povrchu se z něj dopočítají jednou, až pro výsledný zásah
+ * (viz Primitive::surfaceInteraction).
+ */
+struct SurfaceHit {
+    /**
+     * Konstruktor.
+     * @param tMax horní mez parametru t
+     */
+    explicit SurfaceHit(float tMax = std::numeric_limits<float>::max())
+        : t(tMax), primitive(0), instance(0), element(0)
+    {
+    }
+
+    float t; ///< parametr t nejbližšího průsečíku (na vstupu horní mez)
+    const Primitive* primitive; ///< zasažené geometrické těleso
+    const Instance* instance; ///< instance, přes kterou bylo těleso zasaženo (0 bez transformace)
+    uint32_t element; ///< index zasažené koule v množině (SphereSet)
+};
+
 /**
  * Struktura uchovává atributy, které představují souhrn
  * informací o průsečíku paprsku s objektem ve scéně.
@@ -16,13 +38,15 @@
  */
 struct Intersection {
     Intersection()
-        : hitObject(false), material(0), depth(0), t(std::numeric_limits<float>::max())
+        : hitObject(false), material(0), objectId(0), depth(0), t(std::numeric_limits<float>::max()),
+          u(0.f), v(0.f), uvScale(0.f), footprint(0.f)
     {
     }
 
     Intersection(const Intersection& sr)
         : hitObject(sr.hitObject), hitPoint(sr.hitPoint), normal(sr.normal),
-          ray(sr.ray), material(sr.material), depth(sr.depth), t(sr.t)
+          ray(sr.ray), material(sr.material), objectId(sr.objectId), depth(sr.depth), t(sr.t),
+          u(sr.u), v(sr.v), uvScale(sr.uvScale), footprint(sr.footprint)
     {
     }
 
@@ -31,8 +55,12 @@ struct Intersection {
     Normal normal; ///< Normála v místě dopadu
     Ray ray; ///< Paprsek, pro který se provádí výpočet
     std::shared_ptr<Material> material; ///< Reference na materiál objektu
+    uint32_t objectId; ///< Identifikátor zasaženého objektu
     int depth; ///< Hloubka rekurze
     float t; ///< hodnota parametru t v místě dopadu
+    float u, v; ///< texturovací souřadnice v místě dopadu
+    float uvScale; ///< změna texturovacích souřadnic na jednotku délky povrchu
+    float footprint; ///< šířka stopy paprsku v texturovacích souřadnicích
 };
 
 #endif // INTERSECTION_H
@@ -20,6 +20,11 @@ Vector PointLight::getDirection(const Intersection& inter) const
     return dir.normalize();
 }
 
+float PointLight::getDistance(const Intersection& inter) const
+{
+    return distance(inter.hitPoint, loc);
+}
+
 RGBColor PointLight::l(const Intersection& inter) const
 {
     return ls * c;
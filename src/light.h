@@ -26,6 +26,13 @@ public:
      */
     virtual Vector getDirection(const Intersection& inter) const = 0;
 
+    /**
+     * Vzdálenost světla od místa průsečíku, tj. délka stínového paprsku.
+     * @param inter informace o průsečíku
+     * @return vzdálenost (pro světlo v nekonečnu nekonečno)
+     */
+    virtual float getDistance(const Intersection& inter) const = 0;
+
     /**
      * Provede výpočet světelného příspěvku světla pro průsečík.
      * @param sr informace o průsečíku
@@ -42,6 +49,7 @@ public:
     virtual ~PointLight();
 
     virtual Vector getDirection(const Intersection& inter) const;
+    virtual float getDistance(const Intersection& inter) const;
 
     virtual RGBColor l(const Intersection& inter) const;
 
@@ -1,23 +1,58 @@
 #include <iostream>
 #include <fstream>
+#include <sstream>
+#include <map>
 #include <memory>
 #include <vector>
 #include <string>
-#include <ctime>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
 #include <algorithm>
+#include <atomic>
+#include <csignal>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
 
 
 //Main includes
 //#include "core.h"
 
+#include "budget.h"
 #include "camera.h"
+#include "checkpoint.h"
 #include "color.h"
+#include "denoise.h"
 #include "film.h"
 #include "geometry.h"
+#include "geometryfile.h"
+#include "heatmap.h"
+#include "imagewriter.h"
+#include "imageio.h"
 #include "intersection.h"
 #include "light.h"
 #include "material.h"
+#include "numa.h"
+#include "options.h"
+#include "perfcounters.h"
+#include "preview.h"
 #include "primitive.h"
+#include "raybatch.h"
+#include "regression.h"
+#include "rng.h"
+#include "scene.h"
+#include "scenecache.h"
+#include "server.h"
+#include "simd.h"
+#include "texture.h"
+#include "texturecache.h"
+#include "tile.h"
+#include "tonemap.h"
+#include "trace.h"
+#include "transform.h"
+#include "views.h"
 
 using namespace std;
 
@@ -28,143 +63,1362 @@ typedef shared_ptr<Film> FilmPtr;
 typedef shared_ptr<Camera> CameraPtr;
 
 //deklarace globalnich promennych
-vector<LightPtr> lights; ///< buffer svetel
-vector<PrimitivePtr> objects; ///< buffer objektu
-
-RGBColor backgroud; ///< pozadi obrazku
+shared_ptr<Scene> scene; ///< svetla a objekty sceny
 
 FilmPtr film; ///< film v kamere - vhodne mit ho zde pro pristup k datum obrazku
 CameraPtr camera; ///< kamera ve scene
 
-string filename = "output.ppm"; ///< cesta k souboru, nastavena vychozi hodnota
+Options options; ///< nastaveni z prikazove radky
+shared_ptr<GeometryFile> geometry; ///< namapovany soubor geometrie (pokud je zadan)
+shared_ptr<TextureCache> textureCache; ///< dlazdice textur sdilene vsemi scenami
+PerfProfile profile; ///< hardwarove citace po fazich (jen pri --perf)
+
+NumaTopology topology; ///< NUMA uzly, mezi ktere se rozmistuji vlakna
+vector<shared_ptr<Scene> > replicas; ///< kopie sceny v pameti kazdeho uzlu (prazdne = jen scene)
+
+TraceRecorder timeline; ///< casova osa vlaken (jen pri --trace)
+unique_ptr<CostHeatmap> heatmap; ///< cena pixelu aktualniho snimku (jen pri --heatmap)
+unique_ptr<ImageWriter> writer; ///< ukladani obrazku z vlastniho vlakna
+atomic<uint64_t> frameRays(0); ///< paprsky sledovane v aktualnim snimku
+bool regressionFailed = false; ///< vystup nebo vykon neprosel kontrolou regresi
 
 /*!
- * \brief Najde nejblizsi prusecik paprsku s objekty ve scene.
- * \param [in]  ray paprsek
- * \param [out] inter objekt do ktereho se ukladaji data o pruseciku
- * \return
+ * \brief Zaznam casove osy, nebo 0 pokud neni zapnuty.
+ */
+TraceRecorder* tracing()
+{
+    return options.trace.empty() ? 0 : &timeline;
+}
+
+/*!
+ * \brief Pojmenuje radek volajiciho vlakna na casove ose.
+ * \param role druh vlakna
+ * \param index poradi vlakna
+ */
+void nameThread(const char* role, size_t index)
+{
+    if (TraceRecorder* trace = tracing())
+        trace->nameThread(string(role) + " " + to_string(index));
+}
+
+/*!
+ * \brief Vypocet barvy v primarnim pruseciku paprsku z kamery.
+ * Stinove paprsky se nesleduji hned, ale s prispevkem svetla se pridaji do davky;
+ * prispevky nezakrytych paprsku se ke vzorku prictou az po sledovani cele davky.
+ * \param scene sledovana scena
+ * \param camera kamera, ze ktere paprsek vysel
+ * \param inter prusecik primarniho paprsku (doplni se stopa paprsku)
+ * \param sample index vzorku, kteremu patri stinove paprsky
+ * \param batch davka stinovych paprsku
+ * \param [out] aov pomocne kanaly primarniho pruseciku (muze byt 0)
+ * \return barva pozadi, nebo cerna pokud paprsek zasahl objekt
  */
-bool intersect(const Ray& ray, Intersection& inter)
+RGBColor shadeHit(Scene& scene, const Camera& camera, Intersection& inter, uint32_t sample, RayBatch& batch,
+                  AOVSample* aov = 0)
 {
-    for (auto it = objects.begin(); it != objects.end(); ++it) {
-        auto object = *it;
-        object->intersect(ray, inter);
+    //pokud neprotne tak vypln barvou pozadi
+    if (!inter.hitObject)
+        return scene.getBackground();
+
+    const Ray& ray = inter.ray;
+
+    //stopa paprsku urcuje uroven detailu textur, sikmy dopad ji prodluzuje
+    const float cosine = fabs(dot(inter.normal, ray.d));
+    inter.footprint = camera.spread() * inter.t * inter.uvScale / max(cosine, 0.1f);
+
+    //pomocne kanaly vznikaji ze stejneho pruseciku jako vysledna barva
+    if (aov) {
+        aov->depth = inter.t;
+        aov->normal = inter.normal;
+        aov->albedo = inter.material->surfaceAlbedo(inter);
+        aov->objectId = inter.objectId;
+    }
+
+    //svetelne prispevky od jednotlivych svetel, svetla za povrchem nic neprinesou;
+    //stinovy paprsek konci ve svetle, paprsky ke stejnemu svetlu tvori skupinu
+    const vector<LightPtr>& lights = scene.getLights();
+    for (size_t i = 0; i < lights.size(); ++i) {
+        const LightPtr& light = lights[i];
+        const Vector shDir = light->getDirection(inter);
+
+        float ndotwi = dot(inter.normal, shDir); // "zeslabovaci faktor"
+        if (ndotwi > 0.f) {
+            batch.add(Ray(inter.hitPoint, shDir, 0.f, light->getDistance(inter)), sample,
+                      inter.material->evaluate(inter, shDir, ray.d) * light->l(inter) * ndotwi,
+                      static_cast<uint32_t>(i));
+        }
     }
 
-    return inter.hitObject;
+    return RGBColor();
 }
 
 /*!
- * \brief Zjednodusena verze funkce intersect(const Ray&, Intersection&) pro vypocet stinu.
- * \param ray paprsek
- * \return
+ * Pracovni buffery jednoho vlakna, znovu pouzivane pro kazdou dlazdici.
+ */
+struct TileContext {
+    TileContext()
+        : scene(0), film(::film.get()), camera(::camera.get()), spp(options.spp), rays(0)
+    {}
+
+    /*!
+     * \brief Zacne merit hardwarove citace vlakna (pri --perf).
+     */
+    void startProfile()
+    {
+        if (!options.perf)
+            return;
+
+        perf.reset(new PerfCounters());
+        profile.setAvailability(*perf);
+        last = perf->read();
+    }
+
+    /*!
+     * \brief Pricte citace od posledniho predelu k dane fazi.
+     */
+    void mark(PerfStage stage)
+    {
+        if (!perf)
+            return;
+
+        const PerfValues now = perf->read();
+        stages[stage] += now - last;
+        last = now;
+    }
+
+    /*!
+     * \brief Preda pocet paprsku a namerene hodnoty vlakna do spolecneho souhrnu.
+     */
+    void finishProfile()
+    {
+        frameRays += rays;
+        if (!perf)
+            return;
+
+        for (int s = 0; s < PERF_STAGE_COUNT; ++s)
+            profile.add(static_cast<PerfStage>(s), stages[s]);
+        profile.addRays(rays);
+    }
+
+    Scene* scene; ///< scena, kterou vlakno sleduje (kopie v pameti jeho uzlu)
+    Film* film; ///< film renderovaneho pohledu
+    const Camera* camera; ///< kamera renderovaneho pohledu
+    unsigned int spp; ///< pocet vzorku na pixel renderovaneho snimku
+    RayBatch batch; ///< stinove paprsky dlazdice
+    vector<Intersection> hits; ///< primarni pruseciky kazdeho vzorku dlazdice
+    vector<RGBColor> colors; ///< barva kazdeho vzorku dlazdice
+    vector<AOVSample> aovs; ///< pomocne kanaly kazdeho vzorku dlazdice
+
+    unique_ptr<PerfCounters> perf; ///< citace vlakna (jen pri --perf)
+    PerfValues last; ///< hodnoty citacu pri poslednim predelu faze
+    PerfValues stages[PERF_STAGE_COUNT]; ///< soucty po fazich
+    uint64_t rays; ///< pocet sledovanych paprsku
+};
+
+/*!
+ * \brief Poloha vzorku na filmu.
+ * Nahodna cisla se odvozuji jen z polohy pixelu a indexu vzorku.
+ * \param film film, na kterem vzorek lezi
+ * \param x poloha pixelu ve vodorovnem smeru
+ * \param y poloha pixelu ve svislem smeru
+ * \param sample index vzorku v pixelu
+ * \param jitter rozmistit vzorek nahodne (jinak miri do stredu pixelu)
  */
-bool intersectP(const Ray& ray)
+CameraSample cameraSample(const Film& film, size_t x, size_t y, unsigned int sample, bool jitter)
 {
-    for (auto it = objects.begin(); it != objects.end(); ++it) {
-        auto object = *it;
-        if (object->intersectP(ray))
-            return true;
+    CameraSample s;
+    if (!jitter) {
+        s.x = static_cast<float>(x);
+        s.y = static_cast<float>(y);
+    } else {
+        SampleRNG rng(static_cast<uint64_t>(y) * film.width() + x, sample, options.seed);
+        s.x = x + rng.uniform(0) - 0.5f;
+        s.y = y + rng.uniform(1) - 0.5f;
     }
 
-    return false;
+    return s;
+}
+
+/*!
+ * \brief Sleduje vzorky [first, first + spp) jednotlivych pixelu dlazdice a meri jejich cenu.
+ * Diagnosticka varianta traceTile() pro --heatmap: stinove paprsky kazdeho pixelu
+ * se sleduji hned po jeho vzorcich, jednotlive a v poradi pridani, aby se testy
+ * s primitivy a takty daly pripsat pixelu. Barvy vychazi stejne jako v traceTile().
+ * \param t dlazdice
+ * \param first index prvniho vzorku
+ * \param spp pocet vzorku na pixel
+ * \param jitter rozmistit vzorky nahodne (jinak miri do stredu pixelu)
+ * \param ctx buffery vlakna, vysledek je v ctx.colors a ctx.aovs po pixelech
+ */
+void traceTileCost(const Tile& t, unsigned int first, unsigned int spp, bool jitter, TileContext& ctx)
+{
+    const size_t sampleCount = t.pixelCount() * spp;
+    const bool aovs = ctx.film->hasAOVs();
+
+    ctx.hits.assign(sampleCount, Intersection());
+    ctx.colors.assign(sampleCount, RGBColor());
+    if (aovs)
+        ctx.aovs.assign(sampleCount, AOVSample());
+
+    uint32_t index = 0;
+    for (size_t y = t.y0; y < t.y1; ++y) {
+        for (size_t x = t.x0; x < t.x1; ++x) {
+            const uint64_t start = readCycleCounter();
+            const uint64_t tests = primitiveTests;
+
+            ctx.batch.clear();
+            for (unsigned int i = 0; i < spp; ++i, ++index) {
+                ctx.scene->intersect(ctx.camera->generateRay(cameraSample(*ctx.film, x, y, first + i, jitter)),
+                                    ctx.hits[index]);
+                ctx.colors[index] = shadeHit(*ctx.scene, *ctx.camera, ctx.hits[index], index, ctx.batch,
+                                             aovs ? &ctx.aovs[index] : 0);
+            }
+
+            ctx.batch.trace(*ctx.scene, false, 1);
+            for (size_t i = 0; i < ctx.batch.size(); ++i) {
+                if (!ctx.batch.occluded(i))
+                    ctx.colors[ctx.batch.sample(i)] += ctx.batch.contribution(i);
+            }
+
+            PixelCost cost;
+            cost.tests = primitiveTests - tests;
+            cost.shadowRays = ctx.batch.size();
+            cost.cycles = readCycleCounter() - start;
+            heatmap->add(x, y, cost);
+
+            ctx.rays += spp + ctx.batch.size();
+        }
+    }
+    ctx.mark(PERF_STAGE_SHADING);
+}
+
+/*!
+ * \brief Sleduje vzorky [first, first + spp) vsech pixelu dlazdice.
+ * Nejdrive se najdou pruseciky primarnich paprsku vsech vzorku, potom se
+ * vzorky obarvi a nakonec se najednou sleduji vsechny stinove paprsky dlazdice
+ * (serazene, viz RayBatch). Oddelene pruchody lze merit po fazich. Nahodna cisla se odvozuji
+ * jen z polohy pixelu a indexu vzorku, takze vysledek nezavisi na tom, ktere
+ * vlakno dlazdici pocita, ani na tom, po kolika vzorcich se dlazdice sleduje.
+ * Pri --heatmap se misto toho pouzije traceTileCost().
+ * \param t dlazdice
+ * \param first index prvniho vzorku
+ * \param spp pocet vzorku na pixel
+ * \param jitter rozmistit vzorky nahodne (jinak miri do stredu pixelu)
+ * \param ctx buffery vlakna, vysledek je v ctx.colors a ctx.aovs po pixelech
+ */
+void traceTile(const Tile& t, unsigned int first, unsigned int spp, bool jitter, TileContext& ctx)
+{
+    if (heatmap) {
+        traceTileCost(t, first, spp, jitter, ctx);
+        return;
+    }
+
+    const size_t sampleCount = t.pixelCount() * spp;
+    const bool aovs = ctx.film->hasAOVs();
+
+    ctx.batch.clear();
+    ctx.hits.assign(sampleCount, Intersection());
+    ctx.colors.assign(sampleCount, RGBColor());
+    if (aovs)
+        ctx.aovs.assign(sampleCount, AOVSample());
+
+    uint32_t index = 0;
+    for (size_t y = t.y0; y < t.y1; ++y) {
+        for (size_t x = t.x0; x < t.x1; ++x) {
+            for (unsigned int i = 0; i < spp; ++i, ++index)
+                ctx.scene->intersect(ctx.camera->generateRay(cameraSample(*ctx.film, x, y, first + i, jitter)),
+                                    ctx.hits[index]);
+        }
+    }
+    ctx.mark(PERF_STAGE_INTERSECTION);
+
+    for (index = 0; index < sampleCount; ++index)
+        ctx.colors[index] = shadeHit(*ctx.scene, *ctx.camera, ctx.hits[index], index, ctx.batch,
+                                     aovs ? &ctx.aovs[index] : 0);
+    ctx.mark(PERF_STAGE_SHADING);
+
+    //implementace stinu, vysledky se vraci vzorkum v poradi pridani
+    ctx.batch.trace(*ctx.scene, options.raySort, options.shadowPacket);
+    ctx.mark(PERF_STAGE_INTERSECTION);
+    ctx.rays += sampleCount + ctx.batch.size();
+
+    for (size_t i = 0; i < ctx.batch.size(); ++i) {
+        if (!ctx.batch.occluded(i))
+            ctx.colors[ctx.batch.sample(i)] += ctx.batch.contribution(i);
+    }
+}
+
+/*!
+ * \brief Vypocet barev vsech pixelu dlazdice, vzorky se prumeruji do pixelu.
+ * \param t dlazdice
+ * \param ctx buffery vlakna
+ */
+void renderTile(const Tile& t, TileContext& ctx)
+{
+    const unsigned int spp = ctx.spp;
+    const bool aovs = ctx.film->hasAOVs();
+
+    //jediny vzorek miri do stredu pixelu, vice vzorku je nahodne rozmisteno
+    traceTile(t, 0, spp, spp > 1, ctx);
+
+    uint32_t index = 0;
+    for (size_t y = t.y0; y < t.y1; ++y) {
+        for (size_t x = t.x0; x < t.x1; ++x, index += spp) {
+            if (spp == 1) {
+                ctx.film->setPixelColor(ctx.colors[index], x, y);
+                if (aovs)
+                    ctx.film->setAOV(ctx.aovs[index], x, y);
+                continue;
+            }
+
+            RGBColor color;
+            AOVSample sum;
+            unsigned int hits = 0;
+            for (unsigned int i = 0; i < spp; ++i) {
+                color += ctx.colors[index + i];
+
+                //prumeruji se jen vzorky, ktere zasahly objekt; id urcuje prvni z nich
+                const AOVSample* aov = aovs ? &ctx.aovs[index + i] : 0;
+                if (aov && aov->objectId != 0) {
+                    sum.depth += aov->depth;
+                    sum.normal += aov->normal;
+                    sum.albedo += aov->albedo;
+                    if (hits++ == 0)
+                        sum.objectId = aov->objectId;
+                }
+            }
+
+            ctx.film->setPixelColor(color / static_cast<float>(spp), x, y);
+
+            if (aovs) {
+                if (hits > 0) {
+                    sum.depth /= hits;
+                    sum.normal.normalize();
+                    sum.albedo /= hits;
+                }
+                ctx.film->setAOV(sum, x, y);
+            }
+        }
+    }
+    ctx.mark(PERF_STAGE_SHADING);
+}
+
+atomic<bool> interrupted(false); ///< render byl prerusen signalem (lock-free, lze nastavit z obsluhy signalu)
+
+/*!
+ * \brief Obsluha SIGINT a SIGTERM. Vlakna dokonci rozpracovane dlazdice
+ * a renderLoop ulozi kontrolni bod.
+ */
+void onInterrupt(int)
+{
+    interrupted = true;
+}
+
+/*!
+ * \brief Vyrez pres cely film.
+ */
+CropWindow fullWindow(const Film& film)
+{
+    CropWindow window;
+    window.x0 = 0;
+    window.y0 = 0;
+    window.x1 = film.width();
+    window.y1 = film.height();
+    return window;
+}
+
+/*!
+ * \brief Vyrez filmu, ktery se ma renderovat, podle nastaveni.
+ * \param [out] window vyrez oriznuty na rozmery filmu
+ * \return false pokud po oriznuti nezbyl zadny pixel
+ */
+bool cropWindow(CropWindow& window)
+{
+    window = fullWindow(*film);
+
+    if (options.cropX1 > 0) {
+        window.x0 = min(options.cropX0, film->width());
+        window.y0 = min(options.cropY0, film->height());
+        window.x1 = min(options.cropX1, film->width());
+        window.y1 = min(options.cropY1, film->height());
+    }
+
+    if (window.x1 <= window.x0 || window.y1 <= window.y0) {
+        cerr << "Chyba: vyrez " << options.cropX0 << " " << options.cropY0 << " " << options.cropX1
+             << " " << options.cropY1 << " lezi mimo film " << film->width() << " x "
+             << film->height() << endl;
+        return false;
+    }
+
+    return true;
+}
+
+/*!
+ * \brief Presune pasy filmu do pameti uzlu, jejichz vlakna je budou renderovat.
+ * Film alokuje hlavni vlakno, bez presunu by vsechny jeho stranky lezely v jeho uzlu.
+ * \param grid dlazdice k vyrenderovani
+ * \param queues fronty dlazdic jednotlivych uzlu
+ * \return pocet stranek filmu, ktere lezi v uzlu sve fronty
+ */
+size_t placeFilm(const TileGrid& grid, const TileQueues& queues)
+{
+    size_t pages = 0;
+    for (size_t q = 0; q < queues.queueCount(); ++q) {
+        if (queues.begin(q) == queues.end(q))
+            continue;
+
+        const size_t y0 = grid.tile(queues.begin(q)).y0;
+        const size_t y1 = grid.tile(queues.end(q) - 1).y1;
+        const size_t pixels = (y1 - y0) * film->width();
+        const int node = topology.node(q).id;
+
+        pages += migratePages(film->row(0, y0), pixels * sizeof(RGBColor), node);
+        if (film->hasAOVs())
+            pages += migratePages(&film->getAOV(0, y0), pixels * sizeof(AOVSample), node);
+    }
+
+    return pages;
 }
 
 /*!
  * \brief Metoda hlavni renderovaci smycky.
+ * Vyrez filmu se rozdeli na dlazdice, ktere si vlakna postupne berou z fronty
+ * sveho NUMA uzlu (na stroji s jednim uzlem je fronta jedina). Hlavni vlakno
+ * mezitim periodicky uklada kontrolni bod.
+ * \param grid dlazdice k vyrenderovani
+ * \param spp pocet vzorku na pixel
+ * \param checkpointPath soubor kontrolniho bodu (prazdny = vypnuto)
+ * \param stream zapisovac, kteremu se predavaji hotove dlazdice (0 = ulozit az po renderu)
+ * \return false pokud byl render prerusen
+ */
+bool renderLoop(const TileGrid& grid, unsigned int spp, const string& checkpointPath, ImageWriter* stream)
+{
+    TileFlags done(grid.count());
+    unique_ptr<Checkpoint> checkpoint;
+
+    if (!checkpointPath.empty()) {
+        checkpoint.reset(new Checkpoint(checkpointPath, grid, spp, options.seed, options.scene));
+        bool stale;
+        size_t restored = checkpoint->load(*film, done, stale);
+        if (restored > 0)
+            cout << "Resumed " << restored << "/" << grid.count() << " tiles from checkpoint" << endl;
+        else if (stale)
+            cout << "Checkpoint " << checkpointPath << " belongs to a different render, starting over" << endl;
+    }
+
+    if (stream) {
+        for (size_t i = 0; i < grid.count(); ++i) {
+            if (done[i].load(memory_order_relaxed))
+                stream->tileDone(i);
+        }
+    }
+
+    const size_t nodes = topology.nodeCount();
+    const vector<ThreadPlacement> placement = topology.place(options.affinity, options.threads,
+                                                             options.cpuList);
+    TileQueues queues(grid.count(), nodes);
+
+    //emulovane uzly nemaji vlastni pamet, stranky neni kam presouvat
+    size_t localPages = 0;
+    if (nodes > 1 && !topology.emulated() && options.affinity != AFFINITY_NONE)
+        localPages = placeFilm(grid, queues);
+
+    atomic<size_t> activeWorkers(options.threads);
+    mutex finishedMutex;
+    condition_variable finished;
+    vector<size_t> nodeThreads(nodes, 0), nodeTiles(nodes, 0), nodeStolen(nodes, 0);
+
+    auto worker = [&](size_t w) {
+        const ThreadPlacement& p = placement[w];
+        if (p.cpu >= 0)
+            bindThreadToCpu(p.cpu);
+
+        nameThread("worker", w);
+
+        TileContext ctx;
+        ctx.scene = replicas.empty() ? scene.get() : replicas[p.node].get();
+        ctx.spp = spp;
+        ctx.startProfile();
+
+        size_t tiles = 0, stolen = 0, i;
+        bool steal;
+        while (!interrupted && queues.next(p.node, i, steal)) {
+            if (done[i].load(memory_order_relaxed))
+                continue;
+
+            {
+                TraceScope scope(tracing(), "tile", "render", "tile", static_cast<int64_t>(i));
+                renderTile(grid.tile(i), ctx);
+            }
+
+            done[i].store(true, memory_order_release);
+            if (stream)
+                stream->tileDone(i);
+            ++tiles;
+            if (steal)
+                ++stolen;
+        }
+
+        ctx.finishProfile();
+
+        lock_guard<mutex> lock(finishedMutex);
+        ++nodeThreads[p.node];
+        nodeTiles[p.node] += tiles;
+        nodeStolen[p.node] += stolen;
+        if (--activeWorkers == 0)
+            finished.notify_all();
+    };
+
+    unique_ptr<TerminalPreview> preview;
+    if (options.preview) {
+        preview.reset(new TerminalPreview(*film, grid, done, ToneMapper(options.toneMap),
+                                          options.previewFps, options.previewWidth));
+        preview->start();
+    }
+
+    vector<thread> workers;
+    for (size_t i = 0; i < options.threads; ++i)
+        workers.push_back(thread(worker, i));
+
+    if (checkpoint) {
+        signal(SIGINT, onInterrupt);
+        signal(SIGTERM, onInterrupt);
+
+        const chrono::duration<double> interval(options.checkpointInterval);
+        unique_lock<mutex> lock(finishedMutex);
+        while (!finished.wait_for(lock, interval, [&]() { return activeWorkers == 0; })) {
+            lock.unlock();
+            {
+                TraceScope scope(tracing(), "checkpoint", "io");
+                checkpoint->save(*film, done);
+            }
+            lock.lock();
+        }
+    }
+
+    for (size_t i = 0; i < workers.size(); ++i)
+        workers[i].join();
+
+    if (preview)
+        preview->stop();
+
+    if (nodes > 1 || options.affinity != AFFINITY_NONE) {
+        for (size_t n = 0; n < nodes; ++n) {
+            cout << "NUMA node " << topology.node(n).id << ": " << nodeThreads[n] << " threads, "
+                 << nodeTiles[n] << " tiles (" << nodeStolen[n] << " stolen)" << endl;
+        }
+        if (localPages > 0)
+            cout << "Film pages on local nodes: " << localPages << endl;
+    }
+
+    if (interrupted) {
+        if (checkpoint) {
+            checkpoint->save(*film, done);
+            cout << "Interrupted, checkpoint saved into: " << checkpointPath << endl;
+        }
+        return false;
+    }
+
+    return true;
+}
+
+/*!
+ * \brief Render s casovym limitem.
+ * Vzorky se pridavaji po kolech. Prvni kola daji kazde dlazdici BUDGET_MIN_SAMPLES
+ * vzorku, dalsi kola rozdeluji polovinu zbyvajiciho casu podle odhadu chyby
+ * a namerene ceny dlazdic (viz SampleBudget). Vlakno pred kazdym pruchodem
+ * dlazdici overi, ze ho stihne pred limitem, takze render skonci vcas i pri
+ * spatnem odhadu. Pomocne kanaly se berou z prvniho vzorku.
+ * \param grid dlazdice k vyrenderovani
+ * \param spp nejvyssi pocet vzorku na pixel (1 = bez omezeni)
+ * \return false pokud byl render prerusen
  */
-void renderLoop()
-{
-    //pro vsechny pixely
-    for (size_t r = 0; r < film->height(); ++r) {
-        for (size_t c = 0; c < film->width(); ++c) {
-            //provede transformaci paprsku
-            CameraSample s;
-            s.x = static_cast<float>(r);
-            s.y = static_cast<float>(c);
-
-            Ray ray = camera->generateRay(s);
-
-            Intersection inter;
-            intersect(ray, inter);
-
-            //pokud protne objekt
-            if (inter.hitObject) {
-                //svetelne prispevky od jednotlivych svetel
-                RGBColor color;
-                for (auto it = lights.begin(); it != lights.end(); ++it) {
-                    auto light = *it;
-                    const Vector shDir = light->getDirection(inter);
-                    Ray shadowRay(inter.hitPoint, shDir);
-
-                    //implementace stinu
-                    if (!intersectP(shadowRay)) {
-                        //vypocet svetelneho prispevku pro jednotliva svetla
-                        float ndotwi = dot(inter.normal, shDir); // "zeslabovaci faktor"
-                        if (ndotwi > 0.f)
-                            color += inter.material->f(shDir, ray.d, inter.normal)
-                                     * light->l(inter) * ndotwi;
+bool renderDeadline(const TileGrid& grid, unsigned int spp)
+{
+    typedef chrono::steady_clock Clock;
+    const Clock::time_point deadline = Clock::now()
+                                       + chrono::duration_cast<Clock::duration>(
+                                           chrono::duration<double>(options.deadline));
+
+    const CropWindow& window = grid.window();
+    const bool aovs = film->hasAOVs();
+    vector<PixelMoments> moments(window.pixelCount());
+    SampleBudget budget(grid.count(), spp > 1 ? spp : BUDGET_MAX_SAMPLES);
+    size_t rounds = 0;
+
+    for (;;) {
+        const double remaining = chrono::duration<double>(deadline - Clock::now()).count();
+        if (remaining <= 0.0 || interrupted)
+            break;
+
+        vector<SampleJob> jobs;
+        {
+            TraceScope scope(tracing(), "plan", "render", "round", static_cast<int64_t>(rounds));
+            jobs = budget.plan(0.5 * remaining * options.threads);
+        }
+        if (jobs.empty())
+            break;
+        ++rounds;
+
+        atomic<size_t> nextJob(0);
+        auto worker = [&](size_t w) {
+            nameThread("worker", w);
+
+            TileContext ctx;
+            ctx.scene = scene.get();
+            ctx.startProfile();
+
+            for (size_t j = nextJob++; j < jobs.size(); j = nextJob++) {
+                const SampleJob& job = jobs[j];
+                const Tile t = grid.tile(job.tile);
+
+                for (unsigned int k = 0; k < job.samples && !interrupted; ++k) {
+                    const Clock::time_point start = Clock::now();
+                    const chrono::duration<double> cost(budget.passCost(job.tile));
+                    if (start + chrono::duration_cast<Clock::duration>(cost) >= deadline)
+                        break;
+
+                    TraceScope scope(tracing(), "pass", "render", "tile", static_cast<int64_t>(job.tile));
+                    const unsigned int sample = budget.samples(job.tile);
+                    traceTile(t, sample, 1, true, ctx);
+
+                    size_t index = 0;
+                    for (size_t y = t.y0; y < t.y1; ++y) {
+                        for (size_t x = t.x0; x < t.x1; ++x, ++index) {
+                            moments[(y - window.y0) * window.width() + x - window.x0].add(ctx.colors[index]);
+                            if (aovs && sample == 0)
+                                film->setAOV(ctx.aovs[index], x, y);
+                        }
                     }
+
+                    ctx.mark(PERF_STAGE_SHADING);
+                    budget.record(job.tile, 1, chrono::duration<double>(Clock::now() - start).count());
                 }
 
-                film->setPixelColor(color, c, r);
-            } else { //pokud neprotne tak vypln barvou pozadi
-                film->setPixelColor(backgroud, c, r);
+                const unsigned int n = budget.samples(job.tile);
+                double error = 0.0;
+                for (size_t y = t.y0; y < t.y1; ++y) {
+                    for (size_t x = t.x0; x < t.x1; ++x)
+                        error += moments[(y - window.y0) * window.width() + x - window.x0].error(n);
+                }
+                budget.setError(job.tile, error);
+            }
+
+            ctx.finishProfile();
+        };
+
+        vector<thread> workers;
+        for (size_t i = 0; i < options.threads; ++i)
+            workers.push_back(thread(worker, i));
+        for (size_t i = 0; i < workers.size(); ++i)
+            workers[i].join();
+    }
+
+    //vysledny obraz a souhrn: dosazeny pocet vzorku a zbyvajici chyba
+    unsigned int minSamples = ~0u, maxSamples = 0;
+    double samples = 0.0, error = 0.0, estimated = 0.0;
+    size_t empty = 0;
+    for (size_t i = 0; i < grid.count(); ++i) {
+        const Tile t = grid.tile(i);
+        const unsigned int n = budget.samples(i);
+        minSamples = min(minSamples, n);
+        maxSamples = max(maxSamples, n);
+        samples += static_cast<double>(n) * t.pixelCount();
+        error += budget.error(i);
+        if (n >= BUDGET_MIN_SAMPLES)
+            estimated += t.pixelCount();
+        if (n == 0) {
+            ++empty;
+            continue;
+        }
+
+        for (size_t y = t.y0; y < t.y1; ++y) {
+            for (size_t x = t.x0; x < t.x1; ++x) {
+                const PixelMoments& m = moments[(y - window.y0) * window.width() + x - window.x0];
+                film->setPixelColor(m.sum / static_cast<float>(n), x, y);
             }
         }
     }
+
+    const double pixels = static_cast<double>(max<size_t>(window.pixelCount(), 1));
+    cout << "Deadline: " << options.deadline << " s, rounds: " << rounds
+         << ", samples per pixel: " << samples / pixels << " (min " << minSamples
+         << ", max " << maxSamples << ")" << endl;
+    if (estimated > 0.0) {
+        cout << "Estimated relative error: " << sqrt(error / estimated) << " (over "
+             << 100.0 * estimated / pixels << "% of pixels)" << endl;
+    }
+    if (empty > 0)
+        cout << "Tiles without samples: " << empty << "/" << grid.count() << endl;
+
+    return !interrupted;
 }
 
 /*!
- * \brief Ukladani dat z filmu do obrazku typu PPM.
- * \param film objekt filmu, ktery chceme ulozit
- * \param path cesta (absolutni, relativni)
+ * \brief Ulozi pomocne kanaly vyrezu filmu vedle hlavniho vystupu
+ * (napr. output.depth.pfm, output.normal.pfm, output.albedo.pfm, output.id.pfm).
+ * \param film film s alokovanymi pomocnymi kanaly
+ * \param output cesta k hlavnimu vystupu
+ * \param window ukladany vyrez filmu
  */
-void saveImageToPPM(const shared_ptr<Film>& film, const string& path)
+void saveAOVs(const shared_ptr<Film>& film, const string& output, const CropWindow& window)
 {
-    ofstream ofs(path, ios::binary | ios::out);
+    const size_t count = window.pixelCount();
+    vector<float> depth(count), normal(count * 3), albedo(count * 3), id(count);
 
-    ofs << "P6\n" << film->width() << " " << film->height() << "\n255\n";
+    size_t i = 0;
+    for (size_t y = window.y0; y < window.y1; ++y) {
+        for (size_t x = window.x0; x < window.x1; ++x, ++i) {
+            const AOVSample& aov = film->getAOV(x, y);
+            depth[i] = aov.depth;
+            normal[3 * i] = aov.normal.x;
+            normal[3 * i + 1] = aov.normal.y;
+            normal[3 * i + 2] = aov.normal.z;
+            albedo[3 * i] = aov.albedo.r;
+            albedo[3 * i + 1] = aov.albedo.g;
+            albedo[3 * i + 2] = aov.albedo.b;
+            id[i] = static_cast<float>(aov.objectId);
+        }
+    }
+
+    writePFM(derivedPath(output, "depth.pfm"), window.width(), window.height(), 1, depth.data());
+    writePFM(derivedPath(output, "normal.pfm"), window.width(), window.height(), 3, normal.data());
+    writePFM(derivedPath(output, "albedo.pfm"), window.width(), window.height(), 3, albedo.data());
+    writePFM(derivedPath(output, "id.pfm"), window.width(), window.height(), 1, id.data());
+}
 
-    for (size_t j = 0; j < film->height(); ++j) {
-        for (size_t i = 0; i < film->width(); ++i) {
-            RGBColor c = film->getPixelColor(j, i).clamp();
-            unsigned char r = (unsigned char)(c.r * 255.f);
-            unsigned char g = (unsigned char)(c.g * 255.f);
-            unsigned char b = (unsigned char)(c.b * 255.f);
-            ofs << r << g << b;
+/*!
+ * \brief Namapuje soubor geometrie a prida jeho koule do sceny.
+ * Koule zustavaji v namapovane pameti, vytvari se pouze objekty materialu.
+ * \param path cesta k souboru vytvorenemu nastrojem geomconv
+ * \param target scena, do ktere se koule pridaji
+ * \param [out] file namapovany soubor
+ * \return true pri uspechu
+ */
+bool loadGeometry(const string& path, Scene& target, shared_ptr<GeometryFile>& file)
+{
+    file = make_shared<GeometryFile>();
+    if (!file->open(path)) {
+        cerr << "Chyba: " << file->errorString() << endl;
+        return false;
+    }
+
+    size_t materialCount;
+    const MaterialRecord* records = file->materials(materialCount);
+
+    //koule s neexistujicim materialem by pri stinovani nemela material
+    size_t sphereCount;
+    const SphereRecord* spheres = file->spheres(sphereCount);
+    for (size_t i = 0; i < sphereCount; ++i) {
+        if (spheres[i].material >= materialCount) {
+            cerr << "Chyba: " << path << ": koule " << i << " odkazuje na neexistujici material "
+                 << spheres[i].material << endl;
+            return false;
         }
     }
 
-    ofs.close();
+    vector<shared_ptr<Material> > materials;
+    for (size_t i = 0; i < materialCount; ++i) {
+        const MaterialRecord& m = records[i];
+        RGBColor color(m.color[0], m.color[1], m.color[2]);
+        materials.push_back(make_shared<Matte>(color, m.kd));
+    }
+
+    //textury se otevrou az pri prvnim pouziti, stejny soubor sdili vsechny materialy
+    size_t textureCount;
+    const TextureRecord* textures = file->textures(textureCount);
+    const string directory = path.substr(0, path.find_last_of('/') + 1);
+    map<string, shared_ptr<Texture> > opened;
+    for (size_t i = 0; i < textureCount; ++i) {
+        const TextureRecord& t = textures[i];
+        if (t.material >= materialCount)
+            continue;
+
+        string texturePath(t.path, strnlen(t.path, sizeof(t.path)));
+        if (!texturePath.empty() && texturePath[0] != '/')
+            texturePath = directory + texturePath;
+
+        shared_ptr<Texture>& texture = opened[texturePath];
+        if (!texture)
+            texture = make_shared<Texture>(texturePath, textureCache);
+        materials[t.material] = make_shared<TexturedMatte>(texture, records[t.material].kd);
+    }
+
+    target.addObject(make_shared<SphereSet>(file, materials, options.threads, options.accel,
+                                           options.bvhCache));
+    return true;
+}
+
+/*!
+ * \brief Sestavi scenu: svetla, objekty a obe urovne akceleracni struktury.
+ * \param path soubor geometrie (prazdny = vychozi scena s jednou koulí)
+ * \param [out] file namapovany soubor geometrie (pokud je zadan)
+ * \return scena, nebo 0 pokud se nepodarilo nacist geometrii
+ */
+shared_ptr<Scene> buildScene(const string& path, shared_ptr<GeometryFile>& file)
+{
+    shared_ptr<Scene> result = make_shared<Scene>();
+    result->setBackground(GREY);
+
+    LightPtr pl2(new PointLight(RED, 2.f, Point(10.f, 10.f, -10.f)));
+
+    result->addLight(pl2);
+
+    file.reset();
+    if (!path.empty()) {
+        if (!loadGeometry(path, *result, file))
+            return shared_ptr<Scene>();
+    } else {
+        PrimitivePtr sphere(new Sphere(
+                                Point(0.f, 0.f, 0.f),
+                                2.f,
+                                make_shared<Matte>(RED, 0.8f)
+                            ));
+        result->addObject(sphere);
+    }
+
+    //identifikatory pro pomocny kanal id, 0 je vyhrazena pro pozadi
+    uint32_t objectId = 1;
+    const vector<shared_ptr<Instance> >& instances = result->getInstances();
+    for (auto it = instances.begin(); it != instances.end(); ++it) {
+        (*it)->setObjectId(objectId);
+        objectId += static_cast<uint32_t>((*it)->objectCount());
+    }
+
+    result->buildTopLevel();
+
+    return result;
+}
+
+/*!
+ * \brief Vytvori film a kameru.
+ * \param width sirka filmu v pixelech
+ * \param height vyska filmu v pixelech
+ * \param eye poloha kamery
+ * \param target cil pohledu
+ * \param up natoceni kamery
+ * \param fov vodorovny zorny uhel ve stupnich, 0 = stejny jako u vychoziho filmu 800 x 800
+ * \param [out] film vytvoreny film
+ * \param [out] camera vytvorena kamera
+ */
+void setupCamera(size_t width, size_t height, const Point& eye, const Point& target,
+                 const Vector& up, float fov, FilmPtr& film, CameraPtr& camera)
+{
+    const float distance = 50.f;
+    const float pixelSize = fov > 0.f
+                            ? 2.f * distance * tan(fov * static_cast<float>(M_PI) / 360.f) / width
+                            : 40.f / width;
+
+    film = make_shared<Film>(width, height, pixelSize);
+    camera = make_shared<PerspectiveCamera>(eye, target, up, film, distance);
+
+    if (options.aov || options.denoise)
+        film->enableAOVs();
 }
 
 /*!
  * \brief Tato metoda slouzi k inicializaci globalnich promennych, ktere predstavuji scenu.
+ * \return false pokud se nepodarilo nacist geometrii
  */
-void build()
+bool build()
 {
-    backgroud = GREY;
+    replicas.clear();
+
+    if (options.numaReplicate && topology.nodeCount() > 1) {
+        //kazda kopie se stavi na procesorech sveho uzlu, pamet hierarchii tak
+        //pri prvnim zapisu skonci v lokalni pameti uzlu
+        replicas.resize(topology.nodeCount());
+        vector<shared_ptr<GeometryFile> > files(replicas.size());
+        vector<thread> builders;
+        for (size_t n = 0; n < replicas.size(); ++n) {
+            builders.push_back(thread([n, &files]() {
+                bindThreadToNode(topology.node(n));
+                nameThread("builder", n);
+                TraceScope scope(tracing(), "replica", "build", "node", static_cast<int64_t>(n));
+                replicas[n] = buildScene(options.scene, files[n]);
+            }));
+        }
+        for (size_t n = 0; n < builders.size(); ++n)
+            builders[n].join();
 
-    film = make_shared<Film>(800, 800, 0.05f);
-    camera = make_shared<PerspectiveCamera>(
-                 Point(5.f, 5.f, 5.f),
-                 Point(),
-                 Vector(0.f, 1.f, 0.f),
-                 film,
-                 50.f
-             );
+        for (size_t n = 0; n < replicas.size(); ++n) {
+            if (!replicas[n])
+                return false;
+        }
 
-    PrimitivePtr sphere(new Sphere(
-                            Point(0.f, 0.f, 0.f),
-                            2.f,
-                            make_shared<Matte>(RED, 0.8f)
-                        ));
-    objects.push_back(sphere);
+        scene = replicas[0];
+        geometry = files[0];
+    } else {
+        scene = buildScene(options.scene, geometry);
+        if (!scene)
+            return false;
+    }
 
-    LightPtr pl2(new PointLight(RED, 2.f, Point(10.f, 10.f, -10.f)));
+    setupCamera(800, 800, Point(5.f, 5.f, 5.f), Point(), Vector(0.f, 1.f, 0.f), 0.f, film, camera);
+
+    return true;
+}
+
+/*!
+ * \brief Kontrola regresi ulozeneho snimku (--compare, --perf-baseline).
+ * Chybejici soubor zakladni hodnoty se vytvori z aktualniho vykonu.
+ * \param output ulozeny snimek
+ * \param reference referencni obrazek (prazdny = neporovnavat)
+ * \param raysPerSecond vykon renderu snimku
+ * \return false pokud snimek nebo vykon kontrolou neprosel
+ */
+bool checkRegression(const string& output, const string& reference, double raysPerSecond)
+{
+    bool passed = true;
+
+    if (!reference.empty()) {
+        ImageDifference diff;
+        string error;
+        if (!compareImages(output, reference, diff, error)) {
+            cout << "Compare: FAILED, " << error << endl;
+            passed = false;
+        } else {
+            const bool ok = diff.rmse <= options.tolerance;
+            cout << "Compare: " << (ok ? "passed" : "FAILED") << ", RMSE " << diff.rmse
+                 << " (tolerance " << options.tolerance << "), max error " << diff.maxError
+                 << ", visibly different pixels " << 100.0 * diff.differing << "%" << endl;
+            passed = passed && ok;
+        }
+    }
+
+    if (!options.perfBaseline.empty()) {
+        double baseline;
+        if (!loadPerfBaseline(options.perfBaseline, baseline)) {
+            if (savePerfBaseline(options.perfBaseline, raysPerSecond))
+                cout << "Performance baseline recorded: " << raysPerSecond << " rays/s" << endl;
+            else
+                cerr << "Zapis zakladni hodnoty vykonu do " << options.perfBaseline << " selhal" << endl;
+        } else {
+            const double ratio = raysPerSecond / baseline;
+            const bool ok = ratio >= 1.0 - options.perfThreshold;
+            cout << "Performance: " << (ok ? "passed" : "FAILED") << ", " << raysPerSecond
+                 << " rays/s, " << 100.0 * ratio << "% of baseline " << baseline
+                 << " (threshold " << 100.0 * (1.0 - options.perfThreshold) << "%)" << endl;
+            passed = passed && ok;
+        }
+    }
+
+    return passed;
+}
+
+/*!
+ * \brief Vyrenderuje a ulozi jeden snimek.
+ * \param grid dlazdice k vyrenderovani
+ * \param spp pocet vzorku na pixel
+ * \param output cesta k vystupnimu obrazku
+ * \param checkpointPath soubor kontrolniho bodu (prazdny = vypnuto)
+ * \param reference referencni obrazek pro kontrolu regresi (prazdny = neporovnavat)
+ * \return false pokud byl render prerusen
+ */
+bool renderFrame(const TileGrid& grid, unsigned int spp, const string& output,
+                 const string& checkpointPath, const string& reference)
+{
+    frameRays = 0;
+
+    if (options.heatmap)
+        heatmap.reset(new CostHeatmap(grid.window()));
+
+    //hotove pasy se ukladaji uz behem renderu, pokud je nasledne zpracovani nezmeni
+    const bool stream = options.asyncSave && !options.denoise && options.deadline <= 0.0;
+    writer->begin(output, *film, grid, ToneMapper(options.toneMap));
+
+    //vlakna bezi soubezne, proto se meri realny cas misto casu procesoru
+    chrono::steady_clock::time_point renderStart = chrono::steady_clock::now();
+    if (!(options.deadline > 0.0 ? renderDeadline(grid, spp)
+                                 : renderLoop(grid, spp, checkpointPath, stream ? writer.get() : 0))) {
+        writer->cancel();
+        return false;
+    }
+    chrono::duration<double> renderTime = chrono::steady_clock::now() - renderStart;
+    cout << "Render time: " << renderTime.count() << endl;
+
+    const double raysPerSecond = frameRays / max(renderTime.count(), 1e-9);
+    cout << "Rays: " << frameRays << " (" << raysPerSecond << " rays/s)" << endl;
+
+    if (geometry) {
+        cout << "Geometry file: " << geometry->fileSize() << " B, resident: "
+             << geometry->residentBytes() << " B" << endl;
+    }
+
+    const size_t lookups = textureCache->hits() + textureCache->misses();
+    if (lookups > 0) {
+        cout << "Texture cache: hit rate " << 100.0 * textureCache->hits() / lookups << "%, "
+             << textureCache->misses() << " tiles loaded, " << textureCache->bytesLoaded()
+             << " B read, " << textureCache->evictions() << " evicted, resident "
+             << textureCache->memoryUsage() << "/" << textureCache->limit() << " B" << endl;
+    }
+
+    if (options.denoise) {
+        TraceScope scope(tracing(), "denoise", "post");
+        chrono::steady_clock::time_point denoiseStart = chrono::steady_clock::now();
+        denoise(*film, grid.window(), options.denoiseParams, options.threads);
+        chrono::duration<double> denoiseTime = chrono::steady_clock::now() - denoiseStart;
+        cout << "Denoise time: " << denoiseTime.count() << endl;
+    }
+
+    if (options.aov) {
+        TraceScope scope(tracing(), "save aov", "io");
+        saveAOVs(film, output, grid.window());
+    }
+
+    //na zapis na disk se ceka jen pri --sync-save a pred porovnanim s referenci
+    bool saved = true;
+    chrono::steady_clock::time_point saveStart = chrono::steady_clock::now();
+    {
+        PerfScope scope(options.perf ? &profile : 0, PERF_STAGE_SAVE);
+        TraceScope trace(tracing(), "save", "io");
+        writer->finish();
+        if (!options.asyncSave || !reference.empty())
+            saved = writer->wait();
+    }
+    chrono::duration<double> saveTime = chrono::steady_clock::now() - saveStart;
+
+    if (!saved)
+        cerr << "Zapis obrazku selhal: " << writer->error() << endl;
+    cout << "Save into: " << output << endl;
+    cout << "Save time: " << saveTime.count() << endl;
+
+    if (heatmap) {
+        heatmap->printSummary(cout);
+        const string costPath = derivedPath(output, "cost.ppm");
+        if (heatmap->write(costPath, derivedPath(output, "cost.pfm")))
+            cout << "Pixel cost saved into: " << costPath << endl;
+        else
+            cerr << "Zapis mapy ceny pixelu do " << costPath << " selhal" << endl;
+        heatmap.reset();
+    }
+
+    if (options.perf)
+        profile.print(cout);
+
+    if (!checkpointPath.empty())
+        Checkpoint(checkpointPath, grid, spp, options.seed, options.scene).remove();
+
+    if (!checkRegression(output, reference, raysPerSecond))
+        regressionFailed = true;
+
+    return true;
+}
+
+/*!
+ * \brief Presune instance do polohy pro dany snimek animace.
+ * Objekty se pohupuji nahoru a dolu, kazdy s jinou fazi. Spodni urovne
+ * zustavaji beze zmeny, prestavi se jen horni uroven sceny.
+ * \param frame index snimku
+ * \return doba prestavby horni urovne v sekundach
+ */
+double animateScene(unsigned int frame)
+{
+    const vector<shared_ptr<Scene> > scenes = replicas.empty() ? vector<shared_ptr<Scene> >(1, scene)
+                                                               : replicas;
+    chrono::duration<double> rebuildTime(0.0);
+
+    for (size_t s = 0; s < scenes.size(); ++s) {
+        const vector<shared_ptr<Instance> >& instances = scenes[s]->getInstances();
+        for (size_t i = 0; i < instances.size(); ++i) {
+            const float phase = static_cast<float>(frame) / options.frames
+                                + static_cast<float>(i) / instances.size();
+            const float height = 0.5f * sin(2.f * static_cast<float>(M_PI) * phase);
+            instances[i]->setTransform(Transform::translate(Vector(0.f, height, 0.f)));
+        }
+
+        TraceScope scope(tracing(), "top-level rebuild", "build", "node", static_cast<int64_t>(s));
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        scenes[s]->buildTopLevel();
+        rebuildTime += chrono::steady_clock::now() - start;
+    }
+
+    return rebuildTime.count();
+}
+
+/*!
+ * \brief Provede jednu ulohu serveru. Scena se vezme z pameti, nebo se sestavi.
+ * \param arguments parametry ulohy (viz server.h)
+ * \param cache pamet sestavenych scen
+ * \return radek odpovedi
+ */
+string renderJob(const string& arguments, SceneCache& cache)
+{
+    RenderJob job;
+    string error;
+    if (!parseJob(arguments, job, error))
+        return "error " + error;
+
+    TraceScope scope(tracing(), "job", "server");
+
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+    bool hit;
+    const CachedScene* entry = cache.acquire(job.scene, hit);
+    if (!entry)
+        return "error nelze nacist scenu " + job.scene;
+
+    scene = entry->scene;
+    geometry = entry->geometry;
+    setupCamera(job.width, job.height, job.eye, job.target, job.up, job.fov, film, camera);
+
+    chrono::steady_clock::time_point renderStart = chrono::steady_clock::now();
+
+    //uloha ma vlastni rozliseni, vyrez z prikazove radky serveru se na ni nevztahuje
+    const TileGrid grid(fullWindow(*film), options.tileSize);
+    const bool finished = renderFrame(grid, job.spp > 0 ? job.spp : options.spp, job.output, string(),
+                                      string());
+
+    //klient muze obrazek cist hned po odpovedi
+    const bool saved = finished && writer->wait();
+
+    chrono::steady_clock::time_point end = chrono::steady_clock::now();
+    if (!finished)
+        return "error render prerusen";
+    if (!saved)
+        return "error " + writer->error();
+
+    ostringstream reply;
+    reply << "ok output=" << job.output
+          << " cache=" << (hit ? "hit" : "miss")
+          << " setup=" << chrono::duration<double>(renderStart - start).count()
+          << " render=" << chrono::duration<double>(end - renderStart).count()
+          << " total=" << chrono::duration<double>(end - start).count();
+    return reply.str();
+}
+
+/*!
+ * \brief Rezim serveru: ulohy ze standardniho vstupu nebo z Unix socketu.
+ * Sceny a jejich akceleracni struktury zustavaji mezi ulohami v pameti.
+ * \return navratovy kod programu
+ */
+int runServer()
+{
+    SceneCache cache([](const string& path, CachedScene& entry) {
+        entry.scene = buildScene(path, entry.geometry);
+        if (!entry.scene)
+            return false;
+
+        entry.memory = entry.scene->memoryUsage();
+        return true;
+    }, options.cacheLimit);
+
+    CommandHandler handler = [&cache](const string& command, const string& arguments) -> string {
+        if (command == "render")
+            return renderJob(arguments, cache);
+
+        if (command == "stats") {
+            ostringstream reply;
+            reply << "ok scenes=" << cache.sceneCount() << " memory=" << cache.memoryUsage()
+                  << " limit=" << cache.limit() << " hits=" << cache.hits()
+                  << " misses=" << cache.misses() << " reloads=" << cache.reloads();
+            return reply.str();
+        }
+
+        return "error neznamy prikaz " + command;
+    };
+
+    if (!options.socket.empty())
+        return serveSocket(options.socket, handler) ? 0 : 1;
+
+    //standardni vystup patri odpovedim, prubezne vypisy jdou na chybovy vystup
+    ostream replies(cout.rdbuf());
+    streambuf* log = cout.rdbuf(cerr.rdbuf());
+    serveStream(cin, replies, handler);
+    cout.rdbuf(log);
+
+    return 0;
+}
+
+/*!
+ * Pohled davky: vlastni film a kamera nad sdilenou scenou.
+ */
+struct View {
+    FilmPtr film; ///< film pohledu
+    CameraPtr camera; ///< kamera pohledu
+    unique_ptr<TileGrid> grid; ///< dlazdice celeho filmu
+    string output; ///< vystupni obrazek
+};
+
+/*!
+ * \brief Vyrenderuje vsechny pohledy davky najednou.
+ * Dlazdice pohledu se v jedne fronte stridaji (prvni dlazdice kazdeho pohledu,
+ * pak druhe, ...), vlakna tak zustavaji vytizena az do konce davky, i kdyz
+ * maji pohledy ruzne rozliseni nebo ruzne narocne dlazdice.
+ * \param views pohledy davky
+ * \return false pokud byl render prerusen
+ */
+bool renderViews(vector<View>& views)
+{
+    //poradi dlazdic jako dvojice (pohled, dlazdice)
+    vector<pair<size_t, size_t> > order;
+    for (size_t i = 0;; ++i) {
+        bool any = false;
+        for (size_t v = 0; v < views.size(); ++v) {
+            if (i < views[v].grid->count()) {
+                order.push_back(make_pair(v, i));
+                any = true;
+            }
+        }
+        if (!any)
+            break;
+    }
+
+    const vector<ThreadPlacement> placement = topology.place(options.affinity, options.threads,
+                                                             options.cpuList);
+    TileQueues queues(order.size(), topology.nodeCount());
+
+    auto worker = [&](size_t w) {
+        const ThreadPlacement& p = placement[w];
+        if (p.cpu >= 0)
+            bindThreadToCpu(p.cpu);
+
+        nameThread("worker", w);
+
+        TileContext ctx;
+        ctx.scene = replicas.empty() ? scene.get() : replicas[p.node].get();
+        ctx.startProfile();
+
+        size_t i;
+        bool steal;
+        while (!interrupted && queues.next(p.node, i, steal)) {
+            View& view = views[order[i].first];
+            ctx.film = view.film.get();
+            ctx.camera = view.camera.get();
+
+            TraceScope scope(tracing(), "tile", "render", "view", static_cast<int64_t>(order[i].first));
+            renderTile(view.grid->tile(order[i].second), ctx);
+        }
+
+        ctx.finishProfile();
+    };
+
+    vector<thread> workers;
+    for (size_t i = 0; i < options.threads; ++i)
+        workers.push_back(thread(worker, i));
+    for (size_t i = 0; i < workers.size(); ++i)
+        workers[i].join();
+
+    return !interrupted;
+}
+
+/*!
+ * \brief Davka pohledu nad jednou scenou (--views, --stereo, --cubemap, --camera-array).
+ * Scena a jeji hierarchie se sestavi jednou, pohledy se renderuji soubezne
+ * a ukladaji se postupne.
+ * \return navratovy kod programu
+ */
+int runViews()
+{
+    RenderJob base;
+    base.output = options.output;
+
+    vector<RenderJob> jobs;
+    if (!options.views.empty()) {
+        string error;
+        if (!loadViews(options.views, jobs, error)) {
+            cerr << "Chybny soubor pohledu: " << error << endl;
+            return 1;
+        }
+    } else if (options.stereo > 0.f) {
+        jobs = stereoViews(base, options.stereo);
+    } else if (options.cubemap) {
+        jobs = cubemapViews(base);
+    } else {
+        jobs = cameraArrayViews(base, options.arrayColumns, options.arrayRows, options.arraySpacing);
+    }
+
+    vector<View> views(jobs.size());
+    size_t pixels = 0;
+    for (size_t v = 0; v < jobs.size(); ++v) {
+        const RenderJob& job = jobs[v];
+        setupCamera(job.width, job.height, job.eye, job.target, job.up, job.fov,
+                    views[v].film, views[v].camera);
+
+        const CropWindow window = fullWindow(*views[v].film);
+        views[v].grid.reset(new TileGrid(window, options.tileSize));
+        views[v].output = job.output;
+        pixels += window.pixelCount();
+    }
+
+    cout << "Views: " << views.size() << ", " << pixels << " pixels" << endl;
 
-    lights.push_back(pl2);
+    frameRays = 0;
+    chrono::steady_clock::time_point renderStart = chrono::steady_clock::now();
+    {
+        TraceScope scope(tracing(), "views", "render");
+        if (!renderViews(views))
+            return 2;
+    }
+    chrono::duration<double> renderTime = chrono::steady_clock::now() - renderStart;
+    cout << "Render time: " << renderTime.count() << endl;
+
+    const double raysPerSecond = frameRays / max(renderTime.count(), 1e-9);
+    cout << "Rays: " << frameRays << " (" << raysPerSecond << " rays/s)" << endl;
+
+    //film je po finish() volny, zapis pohledu na disk se tak prekryva se zpracovanim dalsiho
+    chrono::steady_clock::time_point saveStart = chrono::steady_clock::now();
+    for (size_t v = 0; v < views.size(); ++v) {
+        const View& view = views[v];
+        const CropWindow& window = view.grid->window();
+
+        if (options.denoise) {
+            TraceScope scope(tracing(), "denoise", "post", "view", static_cast<int64_t>(v));
+            denoise(*view.film, window, options.denoiseParams, options.threads);
+        }
+
+        if (options.aov) {
+            TraceScope scope(tracing(), "save aov", "io", "view", static_cast<int64_t>(v));
+            saveAOVs(view.film, view.output, window);
+        }
+
+        TraceScope scope(tracing(), "save", "io", "view", static_cast<int64_t>(v));
+        writer->begin(view.output, *view.film, *view.grid, ToneMapper(options.toneMap));
+        writer->finish();
+        cout << "Save into: " << view.output << endl;
+    }
+    const bool saved = options.asyncSave || writer->wait();
+    chrono::duration<double> saveTime = chrono::steady_clock::now() - saveStart;
+    cout << "Save time: " << saveTime.count() << endl;
+
+    if (!saved) {
+        cerr << "Zapis obrazku selhal: " << writer->error() << endl;
+        return 1;
+    }
+
+    if (options.perf)
+        profile.print(cout);
+
+    return checkRegression(string(), string(), raysPerSecond) ? 0 : 3;
+}
+
+/*!
+ * \brief Dokonci zapis obrazku, zapise casovou osu (pri --trace) a ukonci program.
+ * \param status navratovy kod programu
+ * \return status, pri chybe zapisu obrazku 1
+ */
+int finish(int status)
+{
+    //rozpracovane zapisy obrazku se dokonci pred koncem programu
+    if (writer && !writer->wait()) {
+        cerr << "Zapis obrazku selhal: " << writer->error() << endl;
+        if (status == 0)
+            status = 1;
+    }
+    writer.reset();
+
+    if (TraceRecorder* trace = tracing()) {
+        if (trace->write(options.trace)) {
+            cout << "Trace: " << trace->eventCount() << " events";
+            if (trace->droppedCount() > 0)
+                cout << " (" << trace->droppedCount() << " oldest dropped)";
+            cout << ", written into: " << options.trace << endl;
+        } else {
+            cerr << "Zapis casove osy do " << options.trace << " selhal" << endl;
+        }
+    }
+
+    return status;
 }
 
 /*!
@@ -175,27 +1429,109 @@ void build()
  */
 int main(int argc, char* argv[])
 {
-    if (argc == 2)
-        filename = argv[1];
+    if (!parseOptions(argc, argv, options)) {
+        printUsage(argv[0]);
+        return 1;
+    }
 
-    clock_t start, end;
+    const SimdIsa isa = options.isa == SIMD_ISA_COUNT ? detectSimdIsa() : options.isa;
+    if (!selectSimdIsa(isa)) {
+        cerr << "Procesor nepodporuje variantu SIMD jader " << simdIsaName(isa) << endl;
+        return 1;
+    }
+
+    textureCache = make_shared<TextureCache>(options.textureCache);
+    topology = options.numaNodes > 0 ? NumaTopology::emulate(options.numaNodes) : NumaTopology::detect();
+
+    if (TraceRecorder* trace = tracing())
+        trace->nameThread("main");
 
-    start = clock();
-    build();
-    end = clock();
-    double buildTime = (double)(end - start) / CLOCKS_PER_SEC;
+    writer.reset(new ImageWriter(tracing()));
+
+    if (options.server)
+        return finish(runServer());
+
+    //stavba hierarchii bezi na vice vlaknech, meri se realny cas
+    chrono::steady_clock::time_point buildStart = chrono::steady_clock::now();
+    {
+        PerfScope scope(options.perf ? &profile : 0, PERF_STAGE_BUILD);
+        TraceScope trace(tracing(), "build", "build");
+        if (!build())
+            return finish(1);
+    }
+    chrono::duration<double> buildTime = chrono::steady_clock::now() - buildStart;
     cout << endl;
-    cout << "Build time: " << buildTime << endl;
+    cout << "Build time: " << buildTime.count() << endl;
+    cout << "SIMD kernels: " << simdIsaName(activeSimdIsa())
+         << (options.isa == SIMD_ISA_COUNT ? " (detected)" : " (forced)") << endl;
 
-    start = clock();
-    renderLoop();
-    end = clock();
-    double renderTime = (double)(end - start) / CLOCKS_PER_SEC;
-    cout << "Render time: " << renderTime << endl;
+    if (topology.nodeCount() > 1) {
+        cout << "NUMA: " << topology.nodeCount() << " nodes" << (topology.emulated() ? " (emulated)" : "")
+             << ", scene replicas: " << max<size_t>(replicas.size(), 1) << endl;
+    }
+
+    const vector<shared_ptr<Instance> >& instances = scene->getInstances();
+    for (auto it = instances.begin(); it != instances.end(); ++it) {
+        shared_ptr<SphereSet> set = dynamic_pointer_cast<SphereSet>((*it)->getObject());
+        if (set) {
+            cout << (set->hierarchy() == HIERARCHY_QBVH ? "QBVH: " : "BVH: ")
+                 << set->size() << " primitives, " << set->nodeCount()
+                 << " nodes, SAH cost: " << set->sahCost() << endl;
+            cout << "Hierarchy memory: " << set->hierarchyMemory() << " B ("
+                 << static_cast<double>(set->hierarchyMemory()) / max<size_t>(set->size(), 1)
+                 << " B/primitive)" << endl;
 
-    saveImageToPPM(film, filename);
+            const BVHCacheStats& cache = set->cacheStats();
+            if (cache.hit) {
+                cout << "BVH cache: hit " << cache.path << ", load time: " << cache.loadTime
+                     << " s (hash " << cache.hashTime << " s)" << endl;
+            } else if (cache.enabled) {
+                cout << "BVH cache: miss, build time: " << cache.buildTime << " s (hash "
+                     << cache.hashTime << " s), " << (cache.saved ? "saved " : "could not save ")
+                     << cache.path << endl;
+            }
+        }
+    }
 
-    cout << "Save into: " << filename << endl;
+    if (options.multiView())
+        return finish(runViews());
 
-    return 0;
+    CropWindow window;
+    if (!cropWindow(window))
+        return finish(1);
+    const TileGrid grid(window, options.tileSize);
+
+    if (options.frames == 0) {
+        const bool finished = renderFrame(grid, options.spp, options.output, options.checkpoint,
+                                          options.reference);
+        return finish(!finished ? 2 : regressionFailed ? 3 : 0);
+    }
+
+    for (unsigned int frame = 0; frame < options.frames; ++frame) {
+        char suffix[32];
+        snprintf(suffix, sizeof(suffix), "%04u.ppm", frame);
+        const string output = derivedPath(options.output, suffix);
+
+        string checkpointPath;
+        if (!options.checkpoint.empty()) {
+            snprintf(suffix, sizeof(suffix), "%04u.ckpt", frame);
+            checkpointPath = derivedPath(options.checkpoint, suffix);
+        }
+
+        //kazdy snimek ma vlastni referenci, napr. ref.0003.ppm
+        string reference;
+        if (!options.reference.empty()) {
+            snprintf(suffix, sizeof(suffix), "%04u.ppm", frame);
+            reference = derivedPath(options.reference, suffix);
+        }
+
+        TraceScope scope(tracing(), "frame", "render", "frame", frame);
+        cout << endl << "Frame " << frame + 1 << "/" << options.frames << endl;
+        cout << "Top-level rebuild time: " << animateScene(frame) << endl;
+
+        if (!renderFrame(grid, options.spp, output, checkpointPath, reference))
+            return finish(2);
+    }
+
+    return finish(regressionFailed ? 3 : 0);
 }
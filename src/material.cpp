@@ -1,8 +1,21 @@
 #include "material.h"
 
+#include "intersection.h"
+#include "texture.h"
+
 Material::~Material()
 {}
 
+RGBColor Material::evaluate(const Intersection& inter, const Vector& wi, const Vector& wo) const
+{
+    return f(wi, wo, inter.normal);
+}
+
+RGBColor Material::surfaceAlbedo(const Intersection& inter) const
+{
+    return albedo();
+}
+
 Matte::Matte(const RGBColor& base, float kd)
     : base(base), kd(kd)
 {}
@@ -14,8 +27,42 @@ Matte::Matte(const Matte& m)
 Matte::~Matte()
 {}
 
-RGBColor Matte::f(const Vector& wi, Vector& wo, const Normal& n) const
+RGBColor Matte::f(const Vector& wi, const Vector& wo, const Normal& n) const
 {
     RGBColor ret = (kd * base) / M_PI;
     return ret;
 }
+
+RGBColor Matte::albedo() const
+{
+    return kd * base;
+}
+
+
+//TexturedMatte
+TexturedMatte::TexturedMatte(const std::shared_ptr<Texture>& texture, float kd)
+    : texture(texture), kd(kd)
+{}
+
+TexturedMatte::~TexturedMatte()
+{}
+
+RGBColor TexturedMatte::f(const Vector& wi, const Vector& wo, const Normal& n) const
+{
+    return (kd * texture->average()) / M_PI;
+}
+
+RGBColor TexturedMatte::albedo() const
+{
+    return kd * texture->average();
+}
+
+RGBColor TexturedMatte::evaluate(const Intersection& inter, const Vector& wi, const Vector& wo) const
+{
+    return (kd * texture->lookup(inter.u, inter.v, inter.footprint)) / M_PI;
+}
+
+RGBColor TexturedMatte::surfaceAlbedo(const Intersection& inter) const
+{
+    return kd * texture->lookup(inter.u, inter.v, inter.footprint);
+}
@@ -1,10 +1,15 @@
 #ifndef MATERIAL_H
 #define MATERIAL_H
 
+#include <memory>
+
 #include "core.h"
 
 #include "color.h"
 
+struct Intersection;
+class Texture;
+
 /**
  * Rozhraní, které definuje metody, které musejí implementovat konkrétní materiály.
  * Třída Material dědí z třídy ReferenceCounted, takže může být předávána pomocí
@@ -22,7 +27,28 @@ public:
      * Vypocita a vrati barvu materialu (neni zavisla na materialu).
      * @return barva materialu.
      */
-    virtual RGBColor f(const Vector& wi, Vector& wo, const Normal& n) const = 0;
+    virtual RGBColor f(const Vector& wi, const Vector& wo, const Normal& n) const = 0;
+
+    /**
+     * Odrazivost materiálu nezávislá na směrech, používá se pro pomocný kanál albedo.
+     * @return albedo materiálu
+     */
+    virtual RGBColor albedo() const = 0;
+
+    /**
+     * Barva materiálu v konkrétním místě dopadu. Materiály, jejichž barva
+     * závisí na poloze (textury), ji přepisují; výchozí implementace volá f().
+     * @param inter průsečík včetně texturovacích souřadnic a stopy paprsku
+     * @return barva materiálu
+     */
+    virtual RGBColor evaluate(const Intersection& inter, const Vector& wi, const Vector& wo) const;
+
+    /**
+     * Albedo v konkrétním místě dopadu, výchozí implementace volá albedo().
+     * @param inter průsečík
+     * @return albedo materiálu
+     */
+    virtual RGBColor surfaceAlbedo(const Intersection& inter) const;
 };
 
 class Matte : public Material
@@ -32,11 +58,36 @@ public:
     Matte(const Matte& m);
     virtual ~Matte();
 
-    virtual RGBColor f(const Vector& wi, Vector& wo, const Normal& n) const;
+    virtual RGBColor f(const Vector& wi, const Vector& wo, const Normal& n) const;
+    virtual RGBColor albedo() const;
 
 private:
     RGBColor base;
     float kd;
 };
 
+/**
+ * Difúzní materiál, jehož barvu určuje textura. Úroveň detailu textury se
+ * volí podle stopy paprsku v místě dopadu.
+ */
+class TexturedMatte : public Material
+{
+public:
+    TexturedMatte(const std::shared_ptr<Texture>& texture, float kd);
+    virtual ~TexturedMatte();
+
+    /**
+     * Bez polohy se použije průměrná barva textury.
+     */
+    virtual RGBColor f(const Vector& wi, const Vector& wo, const Normal& n) const;
+    virtual RGBColor albedo() const;
+
+    virtual RGBColor evaluate(const Intersection& inter, const Vector& wi, const Vector& wo) const;
+    virtual RGBColor surfaceAlbedo(const Intersection& inter) const;
+
+private:
+    std::shared_ptr<Texture> texture;
+    float kd;
+};
+
 #endif // MATERIAL_H
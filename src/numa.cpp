@@ -0,0 +1,246 @@
+#include "numa.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+
+#include <dirent.h>
+#include <linux/mempolicy.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace {
+
+//procesory, na kterych smi proces bezet
+std::vector<int> allowedCpus()
+{
+    std::vector<int> cpus;
+
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+        for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+            if (CPU_ISSET(cpu, &set))
+                cpus.push_back(cpu);
+        }
+    }
+
+    if (cpus.empty())
+        cpus.push_back(0);
+
+    return cpus;
+}
+
+bool bindThread(const std::vector<int>& cpus)
+{
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (size_t i = 0; i < cpus.size(); ++i) {
+        if (cpus[i] >= 0 && cpus[i] < CPU_SETSIZE)
+            CPU_SET(cpus[i], &set);
+    }
+
+    //pid 0 = volajici vlakno
+    return CPU_COUNT(&set) > 0 && sched_setaffinity(0, sizeof(set), &set) == 0;
+}
+
+}
+
+NumaTopology::NumaTopology()
+    : isEmulated(false)
+{
+    NumaNode node;
+    node.id = 0;
+    node.cpus = allowedCpus();
+    nodes.push_back(node);
+}
+
+NumaTopology NumaTopology::detect()
+{
+    NumaTopology topology;
+    const std::vector<int> allowed = allowedCpus();
+
+    DIR* dir = opendir("/sys/devices/system/node");
+    if (!dir)
+        return topology;
+
+    std::vector<NumaNode> found;
+    while (dirent* entry = readdir(dir)) {
+        const std::string name = entry->d_name;
+        if (name.compare(0, 4, "node") != 0 || name.size() == 4
+                || name.find_first_not_of("0123456789", 4) != std::string::npos)
+            continue;
+
+        std::ifstream ifs("/sys/devices/system/node/" + name + "/cpulist");
+        std::string text;
+        std::vector<int> cpus;
+        if (!std::getline(ifs, text) || !parseCpuList(text, cpus))
+            continue;
+
+        NumaNode node;
+        node.id = atoi(name.c_str() + 4);
+        for (size_t i = 0; i < cpus.size(); ++i) {
+            if (std::binary_search(allowed.begin(), allowed.end(), cpus[i]))
+                node.cpus.push_back(cpus[i]);
+        }
+
+        if (!node.cpus.empty())
+            found.push_back(node);
+    }
+    closedir(dir);
+
+    if (!found.empty()) {
+        std::sort(found.begin(), found.end(), [](const NumaNode& a, const NumaNode& b) {
+            return a.id < b.id;
+        });
+        topology.nodes = found;
+    }
+
+    return topology;
+}
+
+NumaTopology NumaTopology::emulate(size_t nodes)
+{
+    NumaTopology topology;
+    const std::vector<int> cpus = allowedCpus();
+    nodes = std::max<size_t>(nodes, 1);
+
+    topology.nodes.assign(nodes, NumaNode());
+    topology.isEmulated = true;
+
+    for (size_t n = 0; n < nodes; ++n) {
+        NumaNode& node = topology.nodes[n];
+        node.id = static_cast<int>(n);
+
+        const size_t begin = cpus.size() * n / nodes;
+        const size_t end = cpus.size() * (n + 1) / nodes;
+        if (begin < end)
+            node.cpus.assign(cpus.begin() + begin, cpus.begin() + end);
+        else
+            node.cpus.push_back(cpus[n % cpus.size()]);
+    }
+
+    return topology;
+}
+
+size_t NumaTopology::nodeCount() const
+{
+    return nodes.size();
+}
+
+const NumaNode& NumaTopology::node(size_t index) const
+{
+    return nodes[index];
+}
+
+bool NumaTopology::emulated() const
+{
+    return isEmulated;
+}
+
+size_t NumaTopology::nodeOfCpu(int cpu) const
+{
+    for (size_t n = 0; n < nodes.size(); ++n) {
+        if (std::find(nodes[n].cpus.begin(), nodes[n].cpus.end(), cpu) != nodes[n].cpus.end())
+            return n;
+    }
+
+    return 0;
+}
+
+std::vector<ThreadPlacement> NumaTopology::place(AffinityPolicy policy, size_t threads,
+                                                 const std::vector<int>& cpuList) const
+{
+    std::vector<ThreadPlacement> placement(threads);
+
+    std::vector<int> compact;
+    for (size_t n = 0; n < nodes.size(); ++n)
+        compact.insert(compact.end(), nodes[n].cpus.begin(), nodes[n].cpus.end());
+
+    for (size_t i = 0; i < threads; ++i) {
+        ThreadPlacement& p = placement[i];
+
+        switch (policy) {
+        case AFFINITY_COMPACT:
+            p.cpu = compact[i % compact.size()];
+            p.node = nodeOfCpu(p.cpu);
+            break;
+        case AFFINITY_SCATTER: {
+            p.node = i % nodes.size();
+            const std::vector<int>& cpus = nodes[p.node].cpus;
+            p.cpu = cpus[(i / nodes.size()) % cpus.size()];
+            break;
+        }
+        case AFFINITY_LIST:
+            p.cpu = cpuList.empty() ? -1 : cpuList[i % cpuList.size()];
+            p.node = nodeOfCpu(p.cpu);
+            break;
+        default:
+            //bez pripnuti se vlakna aspon rovnomerne rozdeli mezi fronty uzlu
+            p.cpu = -1;
+            p.node = i * nodes.size() / std::max<size_t>(threads, 1);
+            break;
+        }
+    }
+
+    return placement;
+}
+
+bool parseCpuList(const std::string& text, std::vector<int>& cpus)
+{
+    cpus.clear();
+
+    std::istringstream in(text);
+    std::string item;
+    while (std::getline(in, item, ',')) {
+        if (item.empty() || item == "\n")
+            continue;
+
+        char* end;
+        const long first = strtol(item.c_str(), &end, 10);
+        long last = first;
+        if (*end == '-')
+            last = strtol(end + 1, &end, 10);
+        if ((*end != '\0' && *end != '\n') || first < 0 || last < first)
+            return false;
+
+        for (long cpu = first; cpu <= last; ++cpu)
+            cpus.push_back(static_cast<int>(cpu));
+    }
+
+    return !cpus.empty();
+}
+
+bool bindThreadToCpu(int cpu)
+{
+    return bindThread(std::vector<int>(1, cpu));
+}
+
+bool bindThreadToNode(const NumaNode& node)
+{
+    return bindThread(node.cpus);
+}
+
+size_t migratePages(const void* begin, size_t bytes, int node)
+{
+    const size_t page = sysconf(_SC_PAGESIZE);
+    const uintptr_t first = reinterpret_cast<uintptr_t>(begin) / page * page;
+    const uintptr_t last = reinterpret_cast<uintptr_t>(begin) + bytes;
+    if (bytes == 0)
+        return 0;
+
+    std::vector<void*> pages;
+    for (uintptr_t p = first; p < last; p += page)
+        pages.push_back(reinterpret_cast<void*>(p));
+
+    std::vector<int> targets(pages.size(), node);
+    std::vector<int> status(pages.size(), -1);
+    if (syscall(SYS_move_pages, 0, pages.size(), pages.data(), targets.data(),
+                status.data(), MPOL_MF_MOVE) < 0)
+        return 0;
+
+    return static_cast<size_t>(std::count(status.begin(), status.end(), node));
+}
@@ -0,0 +1,133 @@
+#ifndef NUMA_H
+#define NUMA_H
+
+/*!
+ * \file
+ * Topologie NUMA uzlu a rozmisteni renderovacich vlaken.\n
+ * Topologie se cte ze sysfs (/sys/devices/system/node), na strojich s jedinym
+ * uzlem ji lze emulovat rozdelenim dostupnych procesoru do skupin. Vlakna se
+ * pripinaji pomoci sched_setaffinity, stranky se presouvaji systemovym volanim
+ * move_pages, takze neni potreba knihovna libnuma.
+ */
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+/*!
+ * Zpusob rozmisteni vlaken na procesory.
+ */
+enum AffinityPolicy {
+    AFFINITY_NONE, ///< vlakna nejsou pripnuta, planuje je operacni system
+    AFFINITY_COMPACT, ///< nejdrive se zaplni vsechny procesory prvniho uzlu, pak dalsiho
+    AFFINITY_SCATTER, ///< vlakna se stridave rozdeluji mezi uzly
+    AFFINITY_LIST ///< vlakna se pripinaji na zadany seznam procesoru
+};
+
+/*!
+ * Jeden NUMA uzel.
+ */
+struct NumaNode {
+    int id; ///< cislo uzlu v systemu (u emulovane topologie poradi skupiny)
+    std::vector<int> cpus; ///< procesory uzlu
+};
+
+/*!
+ * Umisteni jednoho vlakna.
+ */
+struct ThreadPlacement {
+    int cpu; ///< procesor (-1 = nepripnuto)
+    size_t node; ///< index uzlu v topologii
+};
+
+/*!
+ * Topologie NUMA uzlu dostupnych procesu.
+ */
+class NumaTopology
+{
+public:
+    /*!
+     * \brief Jediny uzel se vsemi procesory, ktere smi proces pouzivat.
+     */
+    NumaTopology();
+
+    /*!
+     * \brief Nacte skutecnou topologii. Uzly bez procesoru (jen pamet) se vynechaji.
+     * Pokud sysfs neni k dispozici, vrati jediny uzel.
+     */
+    static NumaTopology detect();
+
+    /*!
+     * \brief Emulovana topologie: dostupne procesory se rozdeli do zadaneho poctu
+     * souvislych skupin. Pri nedostatku procesoru se procesory opakuji.
+     * \param nodes pocet uzlu
+     */
+    static NumaTopology emulate(size_t nodes);
+
+    /*!
+     * \brief Pocet uzlu.
+     */
+    size_t nodeCount() const;
+
+    /*!
+     * \brief Uzel s danym indexem.
+     */
+    const NumaNode& node(size_t index) const;
+
+    /*!
+     * \brief Je topologie emulovana (uzly neodpovidaji skutecne pameti)?
+     */
+    bool emulated() const;
+
+    /*!
+     * \brief Index uzlu, kteremu patri procesor (0 pokud ho zadny uzel nezna).
+     */
+    size_t nodeOfCpu(int cpu) const;
+
+    /*!
+     * \brief Rozmisti vlakna podle zvolene strategie.
+     * \param policy strategie
+     * \param threads pocet vlaken
+     * \param cpuList seznam procesoru pro AFFINITY_LIST
+     * \return umisteni kazdeho vlakna
+     */
+    std::vector<ThreadPlacement> place(AffinityPolicy policy, size_t threads,
+                                       const std::vector<int>& cpuList) const;
+
+private:
+    std::vector<NumaNode> nodes;
+    bool isEmulated;
+};
+
+/*!
+ * \brief Nacte seznam procesoru ve formatu sysfs, napr. "0-3,8,10-11".
+ * \param text seznam
+ * \param [out] cpus procesory
+ * \return false pri chybe ve formatu
+ */
+bool parseCpuList(const std::string& text, std::vector<int>& cpus);
+
+/*!
+ * \brief Pripne volajici vlakno na jeden procesor.
+ * \return false pokud to system nedovolil
+ */
+bool bindThreadToCpu(int cpu);
+
+/*!
+ * \brief Pripne volajici vlakno na vsechny procesory uzlu. Vlakna, ktera
+ * pak vytvori, dedi stejnou masku, takze jejich alokace pri prvnim zapisu
+ * skonci v pameti uzlu.
+ * \return false pokud to system nedovolil
+ */
+bool bindThreadToNode(const NumaNode& node);
+
+/*!
+ * \brief Presune stranky oblasti pameti do daneho uzlu.
+ * \param begin zacatek oblasti
+ * \param bytes velikost oblasti
+ * \param node cislo uzlu v systemu
+ * \return pocet stranek, ktere po volani lezi v uzlu (0 pokud system presun nepodporuje)
+ */
+size_t migratePages(const void* begin, size_t bytes, int node);
+
+#endif // NUMA_H
@@ -0,0 +1,290 @@
+#include "options.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <thread>
+
+Options::Options()
+    : output("output.ppm"), cropX0(0), cropY0(0), cropX1(0), cropY1(0),
+      tileSize(32), threads(std::thread::hardware_concurrency()), checkpointInterval(30.0),
+      spp(1), seed(0), aov(false), denoise(false),
+      preview(false), previewFps(4.0), previewWidth(0), frames(0),
+      accel(HIERARCHY_BVH), raySort(true),
+      shadowPacket(16), server(false), cacheLimit(size_t(1024) << 20),
+      affinity(AFFINITY_NONE), numaNodes(0), numaReplicate(false),
+      deadline(0.0), textureCache(size_t(256) << 20),
+      perf(false), heatmap(false), tolerance(0.005), perfThreshold(0.2),
+      isa(SIMD_ISA_COUNT), asyncSave(true), stereo(0.f), cubemap(false),
+      arrayColumns(0), arrayRows(0), arraySpacing(0.f)
+{
+    if (threads == 0)
+        threads = 1;
+}
+
+bool Options::multiView() const
+{
+    return !views.empty() || stereo > 0.f || cubemap || arrayColumns > 0;
+}
+
+bool parseOptions(int argc, char* argv[], Options& options)
+{
+    for (int i = 1; i < argc; ++i) {
+        const char* arg = argv[i];
+        const bool hasValue = i + 1 < argc;
+
+        if (strcmp(arg, "--scene") == 0 && hasValue) {
+            options.scene = argv[++i];
+        } else if (strcmp(arg, "--crop") == 0 && i + 4 < argc) {
+            options.cropX0 = strtoul(argv[++i], 0, 10);
+            options.cropY0 = strtoul(argv[++i], 0, 10);
+            options.cropX1 = strtoul(argv[++i], 0, 10);
+            options.cropY1 = strtoul(argv[++i], 0, 10);
+            if (options.cropX1 <= options.cropX0 || options.cropY1 <= options.cropY0) {
+                std::cerr << "Neplatny vyrez" << std::endl;
+                return false;
+            }
+        } else if (strcmp(arg, "--tile") == 0 && hasValue) {
+            options.tileSize = strtoul(argv[++i], 0, 10);
+            if (options.tileSize == 0)
+                return false;
+        } else if (strcmp(arg, "--threads") == 0 && hasValue) {
+            options.threads = strtoul(argv[++i], 0, 10);
+            if (options.threads == 0)
+                return false;
+        } else if (strcmp(arg, "--checkpoint") == 0 && hasValue) {
+            options.checkpoint = argv[++i];
+        } else if (strcmp(arg, "--checkpoint-interval") == 0 && hasValue) {
+            options.checkpointInterval = atof(argv[++i]);
+            if (options.checkpointInterval <= 0.0)
+                return false;
+        } else if (strcmp(arg, "--spp") == 0 && hasValue) {
+            options.spp = strtoul(argv[++i], 0, 10);
+            if (options.spp == 0)
+                return false;
+        } else if (strcmp(arg, "--seed") == 0 && hasValue) {
+            options.seed = strtoul(argv[++i], 0, 10);
+        } else if (strcmp(arg, "--aov") == 0) {
+            options.aov = true;
+        } else if (strcmp(arg, "--denoise") == 0) {
+            options.denoise = true;
+        } else if (strcmp(arg, "--denoise-radius") == 0 && hasValue) {
+            options.denoise = true;
+            options.denoiseParams.radius = atoi(argv[++i]);
+            if (options.denoiseParams.radius <= 0)
+                return false;
+        } else if (strcmp(arg, "--preview") == 0) {
+            options.preview = true;
+        } else if (strcmp(arg, "--preview-fps") == 0 && hasValue) {
+            options.preview = true;
+            options.previewFps = atof(argv[++i]);
+            if (options.previewFps <= 0.0)
+                return false;
+        } else if (strcmp(arg, "--preview-width") == 0 && hasValue) {
+            options.preview = true;
+            options.previewWidth = strtoul(argv[++i], 0, 10);
+        } else if (strcmp(arg, "--exposure") == 0 && hasValue) {
+            options.toneMap.exposure = static_cast<float>(atof(argv[++i]));
+        } else if (strcmp(arg, "--tonemap") == 0 && hasValue) {
+            const char* curve = argv[++i];
+            if (strcmp(curve, "clamp") == 0) {
+                options.toneMap.curve = TONE_CLAMP;
+            } else if (strcmp(curve, "reinhard") == 0) {
+                options.toneMap.curve = TONE_REINHARD;
+            } else if (strcmp(curve, "aces") == 0) {
+                options.toneMap.curve = TONE_ACES;
+            } else {
+                std::cerr << "Neznama tonova krivka: " << curve << std::endl;
+                return false;
+            }
+        } else if (strcmp(arg, "--linear") == 0) {
+            options.toneMap.srgb = false;
+        } else if (strcmp(arg, "--frames") == 0 && hasValue) {
+            options.frames = strtoul(argv[++i], 0, 10);
+            if (options.frames == 0)
+                return false;
+        } else if (strcmp(arg, "--accel") == 0 && hasValue) {
+            const char* accel = argv[++i];
+            if (strcmp(accel, "bvh") == 0) {
+                options.accel = HIERARCHY_BVH;
+            } else if (strcmp(accel, "qbvh") == 0) {
+                options.accel = HIERARCHY_QBVH;
+            } else {
+                std::cerr << "Neznama akceleracni struktura: " << accel << std::endl;
+                return false;
+            }
+        } else if (strcmp(arg, "--no-ray-sort") == 0) {
+            options.raySort = false;
+        } else if (strcmp(arg, "--shadow-packet") == 0 && hasValue) {
+            options.shadowPacket = strtoul(argv[++i], 0, 10);
+            if (options.shadowPacket == 0 || options.shadowPacket > SHADOW_PACKET_SIZE) {
+                std::cerr << "Velikost svazku musi byt 1 az " << SHADOW_PACKET_SIZE << std::endl;
+                return false;
+            }
+        } else if (strcmp(arg, "--server") == 0) {
+            options.server = true;
+        } else if (strcmp(arg, "--socket") == 0 && hasValue) {
+            options.server = true;
+            options.socket = argv[++i];
+        } else if (strcmp(arg, "--cache-limit") == 0 && hasValue) {
+            options.cacheLimit = static_cast<size_t>(atof(argv[++i]) * (1 << 20));
+        } else if (strcmp(arg, "--bvh-cache") == 0 && hasValue) {
+            options.bvhCache = argv[++i];
+        } else if (strcmp(arg, "--affinity") == 0 && hasValue) {
+            const char* affinity = argv[++i];
+            if (strcmp(affinity, "none") == 0) {
+                options.affinity = AFFINITY_NONE;
+            } else if (strcmp(affinity, "compact") == 0) {
+                options.affinity = AFFINITY_COMPACT;
+            } else if (strcmp(affinity, "scatter") == 0) {
+                options.affinity = AFFINITY_SCATTER;
+            } else if (parseCpuList(affinity, options.cpuList)) {
+                options.affinity = AFFINITY_LIST;
+            } else {
+                std::cerr << "Neznamy zpusob rozmisteni vlaken: " << affinity << std::endl;
+                return false;
+            }
+        } else if (strcmp(arg, "--numa-emulate") == 0 && hasValue) {
+            options.numaNodes = strtoul(argv[++i], 0, 10);
+            if (options.numaNodes == 0)
+                return false;
+        } else if (strcmp(arg, "--numa-replicate") == 0) {
+            options.numaReplicate = true;
+        } else if (strcmp(arg, "--deadline") == 0 && hasValue) {
+            options.deadline = atof(argv[++i]);
+            if (options.deadline <= 0.0)
+                return false;
+        } else if (strcmp(arg, "--texture-cache") == 0 && hasValue) {
+            options.textureCache = static_cast<size_t>(atof(argv[++i]) * (1 << 20));
+        } else if (strcmp(arg, "--perf") == 0) {
+            options.perf = true;
+        } else if (strcmp(arg, "--heatmap") == 0) {
+            options.heatmap = true;
+        } else if (strcmp(arg, "--compare") == 0 && hasValue) {
+            options.reference = argv[++i];
+        } else if (strcmp(arg, "--tolerance") == 0 && hasValue) {
+            options.tolerance = atof(argv[++i]);
+            if (options.tolerance < 0.0)
+                return false;
+        } else if (strcmp(arg, "--perf-baseline") == 0 && hasValue) {
+            options.perfBaseline = argv[++i];
+        } else if (strcmp(arg, "--perf-threshold") == 0 && hasValue) {
+            options.perfThreshold = atof(argv[++i]);
+            if (options.perfThreshold < 0.0 || options.perfThreshold >= 1.0)
+                return false;
+        } else if (strcmp(arg, "--isa") == 0 && hasValue) {
+            if (!parseSimdIsa(argv[++i], options.isa)) {
+                std::cerr << "Neznama varianta SIMD jader: " << argv[i] << std::endl;
+                return false;
+            }
+        } else if (strcmp(arg, "--trace") == 0 && hasValue) {
+            options.trace = argv[++i];
+        } else if (strcmp(arg, "--sync-save") == 0) {
+            options.asyncSave = false;
+        } else if (strcmp(arg, "--views") == 0 && hasValue) {
+            options.views = argv[++i];
+        } else if (strcmp(arg, "--stereo") == 0 && hasValue) {
+            options.stereo = static_cast<float>(atof(argv[++i]));
+            if (options.stereo <= 0.f) {
+                std::cerr << "Rozestup stereo paru musi byt kladny" << std::endl;
+                return false;
+            }
+        } else if (strcmp(arg, "--cubemap") == 0) {
+            options.cubemap = true;
+        } else if (strcmp(arg, "--camera-array") == 0 && i + 3 < argc) {
+            options.arrayColumns = strtoul(argv[++i], 0, 10);
+            options.arrayRows = strtoul(argv[++i], 0, 10);
+            options.arraySpacing = static_cast<float>(atof(argv[++i]));
+            if (options.arrayColumns == 0 || options.arrayRows == 0) {
+                std::cerr << "Pole kamer musi mit alespon jeden radek a sloupec" << std::endl;
+                return false;
+            }
+        } else if (strcmp(arg, "--help") == 0) {
+            return false;
+        } else if (arg[0] != '-') {
+            options.output = arg;
+        } else {
+            std::cerr << "Neznamy argument: " << arg << std::endl;
+            return false;
+        }
+    }
+
+    const int rigs = !options.views.empty() + (options.stereo > 0.f) + options.cubemap
+                     + (options.arrayColumns > 0);
+    if (rigs > 1) {
+        std::cerr << "Lze zadat jen jednu davku pohledu" << std::endl;
+        return false;
+    }
+    if (options.multiView() && (options.frames > 0 || options.deadline > 0.0 || !options.checkpoint.empty()
+                      || options.preview || options.heatmap || !options.reference.empty()
+                      || options.server || options.cropX1 > 0)) {
+        std::cerr << "Davku pohledu nelze kombinovat s --frames, --deadline, --checkpoint, --preview, "
+                  << "--heatmap, --compare, --crop ani s rezimem serveru" << std::endl;
+        return false;
+    }
+    //render s casovym limitem nema kontrolni body a nerozmistuje vlakna ani sceny po uzlech
+    if (options.deadline > 0.0 && (!options.checkpoint.empty() || options.affinity != AFFINITY_NONE
+                                   || options.numaReplicate)) {
+        std::cerr << "--deadline nelze kombinovat s --checkpoint, --affinity ani --numa-replicate"
+                  << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+void printUsage(const char* program)
+{
+    std::cout << "Pouziti: " << program << " [volby] [vystup.ppm]\n"
+              << "  --scene <soubor.geom>  geometrie sceny (viz geomconv)\n"
+              << "  --crop <x0> <y0> <x1> <y1>  renderovat jen vyrez [x0, x1) x [y0, y1)\n"
+              << "  --tile <n>             velikost dlazdice (vychozi 32)\n"
+              << "  --threads <n>          pocet renderovacich vlaken\n"
+              << "  --checkpoint <soubor>  ukladat a obnovovat rozpracovany render\n"
+              << "  --checkpoint-interval <s>  perioda ukladani (vychozi 30 s)\n"
+              << "  --spp <n>              pocet vzorku na pixel (vychozi 1)\n"
+              << "  --seed <n>             seminko nahodnych cisel\n"
+              << "  --aov                  ulozit hloubku, normaly, albedo a id objektu (PFM)\n"
+              << "  --denoise              odstranit sum filtrem rizenym pomocnymi kanaly\n"
+              << "  --denoise-radius <n>   polomer filtru (vychozi 5)\n"
+              << "  --preview              zivy nahled v terminalu (ANSI truecolor)\n"
+              << "  --preview-fps <n>      frekvence prekreslovani nahledu (vychozi 4)\n"
+              << "  --preview-width <n>    sirka nahledu ve znacich\n"
+              << "  --exposure <ev>        expozice v clonovych cislech (vychozi 0)\n"
+              << "  --tonemap <krivka>     clamp | reinhard | aces (vychozi clamp)\n"
+              << "  --linear               ukladat linearni hodnoty misto sRGB\n"
+              << "  --frames <n>           animace n snimku s pohybujicimi se objekty\n"
+              << "  --accel <typ>          bvh | qbvh (kompaktni ctyrcestna, vychozi bvh)\n"
+              << "  --no-ray-sort          sledovat stinove paprsky v poradi pixelu (pro srovnani)\n"
+              << "  --shadow-packet <n>    paprsku ve svazku ke svetlu, 1 az 64 (1 = bez svazku, vychozi 16)\n"
+              << "  --server               cist ulohy ze standardniho vstupu (viz server.h)\n"
+              << "  --socket <cesta>       cist ulohy z Unix socketu\n"
+              << "  --cache-limit <MB>     pamet pro sceny drzene serverem (vychozi 1024)\n"
+              << "  --bvh-cache <adresar>  ukladat postavene hierarchie a pri stejne geometrii je jen namapovat\n"
+              << "  --affinity <zpusob>    none | compact | scatter | seznam procesoru, napr. 0,2,4-7\n"
+              << "  --numa-emulate <n>     rozdelit procesory do n emulovanych NUMA uzlu\n"
+              << "  --numa-replicate       postavit kopii sceny v pameti kazdeho NUMA uzlu\n"
+              << "  --deadline <s>         renderovat s casovym limitem, vzorky se rozdeli podle chyby\n"
+              << "                         dlazdic (--spp pak urcuje nejvyssi pocet vzorku)\n"
+              << "  --texture-cache <MB>   pamet pro dlazdice textur (vychozi 256)\n"
+              << "  --perf                 merit takty, instrukce a vypadky po fazich (perf_event_open)\n"
+              << "  --heatmap              ulozit cenu pixelu: testy s primitivy, stinove paprsky a takty\n"
+              << "                         (<vystup>.cost.ppm v nepravych barvach, surova data <vystup>.cost.pfm)\n"
+              << "  --compare <ref.ppm>    porovnat vystup s referencnim obrazkem, pri vetsi chybe\n"
+              << "                         skoncit s navratovym kodem 3\n"
+              << "  --tolerance <rmse>     nejvetsi povolena RMSE proti referenci, 0 az 1 (vychozi 0.005)\n"
+              << "  --perf-baseline <soubor>  zakladni hodnota paprsku za sekundu; chybi-li soubor,\n"
+              << "                         zapise se, jinak pokles vykonu skonci navratovym kodem 3\n"
+              << "  --perf-threshold <podil>  povoleny pokles vykonu (vychozi 0.2 = 20 %)\n"
+              << "  --isa <varianta>       vynutit variantu SIMD jader: scalar | sse2 | avx2 | avx512\n"
+              << "                         (vychozi nejsirsi, kterou procesor podporuje)\n"
+              << "  --trace <soubor.json>  zaznamenat casovou osu dlazdic, stavby a ukladani vlaken\n"
+              << "                         (Chrome trace, about://tracing nebo ui.perfetto.dev)\n"
+              << "  --sync-save            ukladat obrazek az po dokonceni renderu (pro srovnani)\n"
+              << "  --views <soubor>       davka pohledu nad jednou scenou, na radku jeden pohled\n"
+              << "                         ve tvaru ulohy serveru (output=... eye=... target=...)\n"
+              << "  --stereo <rozestup>    stereo par (<vystup>.left.ppm, <vystup>.right.ppm)\n"
+              << "  --cubemap              krychlova mapa z mista kamery (<vystup>.px.ppm ... nz.ppm)\n"
+              << "  --camera-array <sloupce> <radky> <rozestup>\n"
+              << "                         pole kamer pro svetelne pole (<vystup>.RR_SS.ppm)\n";
+}
@@ -0,0 +1,88 @@
+#ifndef OPTIONS_H
+#define OPTIONS_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "denoise.h"
+#include "numa.h"
+#include "simd.h"
+#include "packet.h"
+#include "qbvh.h"
+#include "tonemap.h"
+
+/*!
+ * Nastaveni behu rendereru ziskane z prikazove radky.
+ */
+struct Options {
+    Options();
+
+    std::string output; ///< cesta k vystupnimu obrazku
+    std::string scene; ///< soubor geometrie (prazdny = vychozi scena)
+    size_t cropX0, cropY0, cropX1, cropY1; ///< vyrez filmu (cropX1 == 0 = cely film)
+    size_t tileSize; ///< delka hrany dlazdice v pixelech
+    size_t threads; ///< pocet renderovacich vlaken
+    std::string checkpoint; ///< soubor kontrolniho bodu (prazdny = vypnuto)
+    double checkpointInterval; ///< perioda ukladani kontrolniho bodu v sekundach
+    unsigned int spp; ///< pocet vzorku na pixel
+    unsigned int seed; ///< seminko generatoru nahodnych cisel
+    bool aov; ///< ukladat pomocne kanaly (hloubka, normala, albedo, id)
+    bool denoise; ///< odstranit sum filtrem rizenym pomocnymi kanaly
+    DenoiseParams denoiseParams; ///< parametry filtru
+    bool preview; ///< zivy nahled v terminalu
+    double previewFps; ///< maximalni frekvence prekreslovani nahledu
+    size_t previewWidth; ///< sirka nahledu ve znacich (0 = podle terminalu)
+    ToneMapParams toneMap; ///< expozice, tonova krivka a kodovani vystupu
+    unsigned int frames; ///< pocet snimku animace (0 = jeden staticky obrazek)
+    HierarchyType accel; ///< akceleracni struktura nad geometrii sceny
+    bool raySort; ///< radit stinove paprsky pred sledovanim
+    size_t shadowPacket; ///< velikost svazku stinovych paprsku (1 = bez svazku)
+    bool server; ///< rezim serveru, ulohy se ctou ze standardniho vstupu
+    std::string socket; ///< rezim serveru na Unix socketu (prazdny = vypnuto)
+    size_t cacheLimit; ///< limit pameti scen drzenych serverem v bajtech
+    std::string bvhCache; ///< adresar diskove cache hierarchii (prazdny = vypnuto)
+    AffinityPolicy affinity; ///< rozmisteni renderovacich vlaken na procesory
+    std::vector<int> cpuList; ///< procesory pro AFFINITY_LIST
+    size_t numaNodes; ///< pocet emulovanych NUMA uzlu (0 = skutecna topologie)
+    bool numaReplicate; ///< postavit kopii sceny v pameti kazdeho uzlu
+    double deadline; ///< casovy limit renderu snimku v sekundach (0 = pevny pocet vzorku)
+    size_t textureCache; ///< limit pameti dlazdic textur v bajtech
+    bool perf; ///< merit hardwarove citace po fazich renderu
+    bool heatmap; ///< merit cenu pixelu a ulozit ji jako mapu v nepravych barvach
+    std::string reference; ///< referencni obrazek pro kontrolu regresi (prazdny = vypnuto)
+    double tolerance; ///< nejvetsi povolena RMSE proti referenci
+    std::string perfBaseline; ///< soubor se zakladni hodnotou paprsku za sekundu (prazdny = vypnuto)
+    double perfThreshold; ///< povoleny pokles vykonu proti zakladni hodnote (podil)
+    SimdIsa isa; ///< vynucena varianta SIMD jader (SIMD_ISA_COUNT = podle procesoru)
+    std::string trace; ///< soubor casove osy ve formatu Chrome trace (prazdny = vypnuto)
+    bool asyncSave; ///< ukladat obrazek z vlakna zapisovace soubezne s renderem
+    std::string views; ///< soubor s pohledy davky (prazdny = vypnuto)
+    float stereo; ///< rozestup oci stereo paru (0 = vypnuto)
+    bool cubemap; ///< renderovat krychlovou mapu z mista kamery
+    size_t arrayColumns, arrayRows; ///< rozmery pole kamer (0 = vypnuto)
+    float arraySpacing; ///< vzdalenost sousednich kamer pole
+
+    /*!
+     * \brief Renderuje se davka vice pohledu (--views, --stereo, --cubemap, --camera-array)?
+     */
+    bool multiView() const;
+};
+
+/*!
+ * \brief Zpracuje argumenty prikazove radky.
+ * Samostatny argument bez pomlcek je brany jako cesta k vystupnimu souboru.
+ * \param argc pocet argumentu
+ * \param argv argumenty
+ * \param [out] options vysledne nastaveni
+ * \return false pokud argumenty nejsou platne
+ */
+bool parseOptions(int argc, char* argv[], Options& options);
+
+/*!
+ * \brief Vypise napovedu k prikazove radce.
+ * \param program nazev programu
+ */
+void printUsage(const char* program);
+
+#endif // OPTIONS_H
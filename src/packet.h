@@ -0,0 +1,122 @@
+#ifndef PACKET_H
+#define PACKET_H
+
+/*!
+ * \file
+ * Svazek stinovych paprsku sledovanych najednou.\n
+ * Paprsky ke stejnemu bodovemu svetlu se sbihaji do jednoho bodu, jejich
+ * usecky proto lezi v malem spolecnem kvadru. Uzly a primitiva mimo tento
+ * kvadr se zahodi pro cely svazek jedinym testem, zbytek se testuje jen pro
+ * paprsky, ktere jeste nejsou zakryte.
+ */
+
+#include <algorithm>
+#include <cstdint>
+
+#include "core.h"
+
+#include "geometry.h"
+#include "simd.h"
+
+const size_t SHADOW_PACKET_SIZE = 64; ///< nejvetsi pocet paprsku ve svazku (bity masky)
+
+/*!
+ * Svazek stinovych paprsku ulozeny po slozkach (SoA). Paprsek i je usecka
+ * o + t * d pro t v intervalu [0, maxt], stav paprsku je bit i masky.
+ */
+struct ShadowPacket {
+    ShadowPacket()
+        : count(0)
+    {}
+
+    /*!
+     * \brief Vyprazdni svazek.
+     */
+    void clear()
+    {
+        count = 0;
+        bounds = BBox();
+    }
+
+    /*!
+     * \brief Prida paprsek s konecnou delkou.
+     * \return index paprsku ve svazku
+     */
+    size_t add(const Ray& ray)
+    {
+        const size_t i = count++;
+        o[0][i] = ray.o.x;
+        o[1][i] = ray.o.y;
+        o[2][i] = ray.o.z;
+        d[0][i] = ray.d.x;
+        d[1][i] = ray.d.y;
+        d[2][i] = ray.d.z;
+        invDir[0][i] = 1.f / ray.d.x;
+        invDir[1][i] = 1.f / ray.d.y;
+        invDir[2][i] = 1.f / ray.d.z;
+        maxt[i] = ray.maxt;
+
+        bounds.expand(ray.o);
+        bounds.expand(ray(ray.maxt));
+        return i;
+    }
+
+    /*!
+     * \brief Dokonci stavbu: kvadr usecek se mirne zvetsi kvuli zaokrouhleni.
+     */
+    void finish()
+    {
+        const Vector margin = bounds.diagonal() * 1e-4f + Vector(EPSILON, EPSILON, EPSILON);
+        bounds.pMin = bounds.pMin - margin;
+        bounds.pMax = bounds.pMax + margin;
+    }
+
+    /*!
+     * \brief Maska vsech paprsku svazku.
+     */
+    uint64_t all() const
+    {
+        return count == 64 ? ~uint64_t(0) : (uint64_t(1) << count) - 1;
+    }
+
+    /*!
+     * \brief Paprsek i jako samostatny Ray.
+     */
+    Ray ray(size_t i) const
+    {
+        return Ray(Point(o[0][i], o[1][i], o[2][i]), Vector(d[0][i], d[1][i], d[2][i]), 0.f, maxt[i]);
+    }
+
+    /*!
+     * \brief Protina kvadr b spolecny kvadr svazku?
+     */
+    bool overlaps(const BBox& b) const
+    {
+        return b.pMin.x <= bounds.pMax.x && b.pMax.x >= bounds.pMin.x
+               && b.pMin.y <= bounds.pMax.y && b.pMax.y >= bounds.pMin.y
+               && b.pMin.z <= bounds.pMax.z && b.pMax.z >= bounds.pMin.z;
+    }
+
+    /*!
+     * \brief Test kvadru pro vsechny paprsky svazku (metoda slabu).
+     * Pocita vybrana SIMD varianta (viz simd.h).
+     * \param b kvadr
+     * \param active maska testovanych paprsku
+     * \return maska paprsku z active, ktere kvadr protnou
+     */
+    uint64_t intersectBox(const BBox& b, uint64_t active) const
+    {
+        const float pMin[3] = { b.pMin.x, b.pMin.y, b.pMin.z };
+        const float pMax[3] = { b.pMax.x, b.pMax.y, b.pMax.z };
+        return simdKernels().packetBox(*this, pMin, pMax, active);
+    }
+
+    size_t count; ///< pocet paprsku
+    float o[3][SHADOW_PACKET_SIZE]; ///< pocatky po osach
+    float d[3][SHADOW_PACKET_SIZE]; ///< smery po osach
+    float invDir[3][SHADOW_PACKET_SIZE]; ///< prevracene smery po osach
+    float maxt[SHADOW_PACKET_SIZE]; ///< delky usecek
+    BBox bounds; ///< kvadr obsahujici vsechny usecky
+};
+
+#endif // PACKET_H
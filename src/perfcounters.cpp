@@ -0,0 +1,228 @@
+#include "perfcounters.h"
+
+#include <cerrno>
+#include <cstring>
+#include <iomanip>
+
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace {
+
+const uint64_t EVENT_CONFIG[PERF_EVENT_COUNT] = {
+    PERF_COUNT_HW_CPU_CYCLES,
+    PERF_COUNT_HW_INSTRUCTIONS,
+    PERF_COUNT_HW_CACHE_MISSES,
+    PERF_COUNT_HW_BRANCH_MISSES
+};
+
+const char* EVENT_NAMES[PERF_EVENT_COUNT] = {
+    "cycles", "instructions", "cache-misses", "branch-misses"
+};
+
+const char* STAGE_NAMES[PERF_STAGE_COUNT] = {
+    "build", "intersection", "shading", "save"
+};
+
+}
+
+PerfValues::PerfValues()
+{
+    for (int i = 0; i < PERF_EVENT_COUNT; ++i)
+        count[i] = 0;
+}
+
+PerfValues PerfValues::operator -(const PerfValues& v) const
+{
+    PerfValues result;
+    for (int i = 0; i < PERF_EVENT_COUNT; ++i)
+        result.count[i] = count[i] - v.count[i];
+    return result;
+}
+
+PerfValues& PerfValues::operator +=(const PerfValues& v)
+{
+    for (int i = 0; i < PERF_EVENT_COUNT; ++i)
+        count[i] += v.count[i];
+    return *this;
+}
+
+
+//PerfCounters
+PerfCounters::PerfCounters(bool inherit)
+{
+    for (int i = 0; i < PERF_EVENT_COUNT; ++i) {
+        perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = EVENT_CONFIG[i];
+        attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        attr.inherit = inherit ? 1 : 0;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+
+        //pid 0, cpu -1: volajici vlakno na libovolnem procesoru
+        fds[i] = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+        if (fds[i] < 0 && error.empty())
+            error = std::string(EVENT_NAMES[i]) + ": " + strerror(errno);
+    }
+}
+
+PerfCounters::~PerfCounters()
+{
+    for (int i = 0; i < PERF_EVENT_COUNT; ++i) {
+        if (fds[i] >= 0)
+            close(fds[i]);
+    }
+}
+
+bool PerfCounters::available() const
+{
+    for (int i = 0; i < PERF_EVENT_COUNT; ++i) {
+        if (fds[i] >= 0)
+            return true;
+    }
+    return false;
+}
+
+bool PerfCounters::available(PerfEvent event) const
+{
+    return fds[event] >= 0;
+}
+
+PerfValues PerfCounters::read() const
+{
+    PerfValues values;
+    for (int i = 0; i < PERF_EVENT_COUNT; ++i) {
+        uint64_t data[3]; //hodnota, cas povoleni, cas behu
+        if (fds[i] < 0 || ::read(fds[i], data, sizeof(data)) != sizeof(data))
+            continue;
+
+        //citac sdileny s jinymi udalostmi bezel jen cast casu
+        if (data[2] > 0 && data[2] < data[1])
+            values.count[i] = static_cast<uint64_t>(static_cast<double>(data[0]) * data[1] / data[2]);
+        else
+            values.count[i] = data[0];
+    }
+
+    return values;
+}
+
+const std::string& PerfCounters::errorString() const
+{
+    return error;
+}
+
+
+//PerfProfile
+PerfProfile::PerfProfile()
+    : rays(0), measured(false)
+{
+    for (int i = 0; i < PERF_EVENT_COUNT; ++i)
+        availability[i] = false;
+}
+
+void PerfProfile::add(PerfStage stage, const PerfValues& values)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    stages[stage] += values;
+}
+
+void PerfProfile::addRays(uint64_t count)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    rays += count;
+}
+
+void PerfProfile::setAvailability(const PerfCounters& counters)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    measured = true;
+    for (int i = 0; i < PERF_EVENT_COUNT; ++i)
+        availability[i] = availability[i] || counters.available(static_cast<PerfEvent>(i));
+    if (error.empty())
+        error = counters.errorString();
+}
+
+void PerfProfile::print(std::ostream& out) const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    bool any = false;
+    for (int i = 0; i < PERF_EVENT_COUNT; ++i)
+        any = any || availability[i];
+
+    if (!any) {
+        if (measured)
+            out << "Hardware counters unavailable (" << error << ")" << std::endl;
+        return;
+    }
+
+    const std::ios::fmtflags flags = out.flags();
+    const std::streamsize precision = out.precision();
+
+    out << "Hardware counters (" << rays << " rays):" << std::endl;
+    out << std::setw(14) << "stage";
+    for (int i = 0; i < PERF_EVENT_COUNT; ++i)
+        out << std::setw(16) << EVENT_NAMES[i];
+    out << std::setw(8) << "IPC" << std::setw(16) << "cache-miss/ray" << std::setw(16)
+        << "branch-miss/ray" << std::endl;
+
+    for (int s = 0; s < PERF_STAGE_COUNT; ++s) {
+        const PerfValues& v = stages[s];
+        out << std::setw(14) << STAGE_NAMES[s];
+        for (int i = 0; i < PERF_EVENT_COUNT; ++i) {
+            if (availability[i])
+                out << std::setw(16) << v.count[i];
+            else
+                out << std::setw(16) << "n/a";
+        }
+
+        const bool ipc = availability[PERF_CYCLES] && availability[PERF_INSTRUCTIONS]
+                         && v.count[PERF_CYCLES] > 0;
+        out << std::setw(8) << std::fixed << std::setprecision(2);
+        if (ipc)
+            out << static_cast<double>(v.count[PERF_INSTRUCTIONS]) / v.count[PERF_CYCLES];
+        else
+            out << "n/a";
+
+        //na paprsek ma smysl jen u fazi, ktere paprsky sleduji
+        const bool perRay = rays > 0 && (s == PERF_STAGE_INTERSECTION || s == PERF_STAGE_SHADING);
+        const PerfEvent misses[2] = { PERF_CACHE_MISSES, PERF_BRANCH_MISSES };
+        for (int m = 0; m < 2; ++m) {
+            out << std::setw(16);
+            if (perRay && availability[misses[m]])
+                out << static_cast<double>(v.count[misses[m]]) / rays;
+            else
+                out << "-";
+        }
+        out << std::endl;
+    }
+
+    out.flags(flags);
+    out.precision(precision);
+}
+
+
+//PerfScope
+PerfScope::PerfScope(PerfProfile* profile, PerfStage stage)
+    : profile(profile), stage(stage), counters(0)
+{
+    if (!profile)
+        return;
+
+    counters = new PerfCounters(true);
+    profile->setAvailability(*counters);
+    start = counters->read();
+}
+
+PerfScope::~PerfScope()
+{
+    if (!profile)
+        return;
+
+    profile->add(stage, counters->read() - start);
+    delete counters;
+}
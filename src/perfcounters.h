@@ -0,0 +1,162 @@
+#ifndef PERFCOUNTERS_H
+#define PERFCOUNTERS_H
+
+/*!
+ * \file
+ * Hardwarove citace procesoru pres linuxove rozhrani perf_event_open.\n
+ * Kazdy citac se otevira samostatne, takze nedostupny citac (napr. ve
+ * virtualnim stroji) nevyradi ostatni. Pokud jadro citace nepovoli vubec,
+ * mereni se tise vypne a souhrn vypise jen duvod.
+ */
+
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <string>
+
+/*!
+ * Merene udalosti.
+ */
+enum PerfEvent {
+    PERF_CYCLES, ///< takty procesoru
+    PERF_INSTRUCTIONS, ///< dokoncene instrukce
+    PERF_CACHE_MISSES, ///< vypadky posledni urovne cache
+    PERF_BRANCH_MISSES, ///< chybne predikovane skoky
+    PERF_EVENT_COUNT
+};
+
+/*!
+ * Faze renderu, do kterych se mereni rozdeluje.
+ */
+enum PerfStage {
+    PERF_STAGE_BUILD, ///< nacteni sceny a stavba hierarchii
+    PERF_STAGE_INTERSECTION, ///< hledani pruseciku primarnich a stinovych paprsku
+    PERF_STAGE_SHADING, ///< vypocet barvy a skladani vzorku do pixelu
+    PERF_STAGE_SAVE, ///< ulozeni obrazku
+    PERF_STAGE_COUNT
+};
+
+/*!
+ * Hodnoty vsech citacu.
+ */
+struct PerfValues {
+    PerfValues();
+
+    PerfValues operator -(const PerfValues& v) const;
+    PerfValues& operator +=(const PerfValues& v);
+
+    uint64_t count[PERF_EVENT_COUNT];
+};
+
+/*!
+ * Citace jednoho vlakna. Citaji od vytvoreni objektu, mereni useku
+ * je rozdil dvou precteni.
+ */
+class PerfCounters
+{
+public:
+    /*!
+     * \brief Otevre citace pro volajici vlakno.
+     * \param inherit zapocitat i vlakna, ktera volajici vlakno vytvori pozdeji
+     * (jejich hodnoty se prictou, az skonci)
+     */
+    explicit PerfCounters(bool inherit = false);
+    ~PerfCounters();
+
+    /*!
+     * \brief Je k dispozici alespon jeden citac?
+     */
+    bool available() const;
+
+    /*!
+     * \brief Je k dispozici dany citac?
+     */
+    bool available(PerfEvent event) const;
+
+    /*!
+     * \brief Aktualni hodnoty, pri sdileni citacu s jinymi procesy se extrapoluji.
+     */
+    PerfValues read() const;
+
+    /*!
+     * \brief Duvod, proc nektery citac nelze otevrit.
+     */
+    const std::string& errorString() const;
+
+private:
+    PerfCounters(const PerfCounters&);
+    PerfCounters& operator =(const PerfCounters&);
+
+private:
+    int fds[PERF_EVENT_COUNT]; ///< -1 = citac neni k dispozici
+    std::string error;
+};
+
+/*!
+ * Souhrn citacu po fazich ze vsech vlaken.
+ */
+class PerfProfile
+{
+public:
+    PerfProfile();
+
+    /*!
+     * \brief Pricte hodnoty faze. Lze volat z vice vlaken.
+     */
+    void add(PerfStage stage, const PerfValues& values);
+
+    /*!
+     * \brief Pricte pocet sledovanych paprsku (primarnich i stinovych).
+     */
+    void addRays(uint64_t count);
+
+    /*!
+     * \brief Zaznamena, ktere citace byly k dispozici (staci jedno vlakno).
+     */
+    void setAvailability(const PerfCounters& counters);
+
+    /*!
+     * \brief Vypise tabulku: takty, instrukce, IPC, vypadky a vypadky na paprsek.
+     */
+    void print(std::ostream& out) const;
+
+private:
+    mutable std::mutex mutex;
+    PerfValues stages[PERF_STAGE_COUNT];
+    uint64_t rays;
+    bool availability[PERF_EVENT_COUNT];
+    bool measured; ///< nejake vlakno zkusilo citace otevrit
+    std::string error;
+};
+
+/*!
+ * Mereni jedne faze vlaknem, ktere objekt vytvori, vcetne vlaken, ktera
+ * behem faze spusti a ukonci. Bez profilu nic nemeri.
+ */
+class PerfScope
+{
+public:
+    /*!
+     * \brief Zacne merit.
+     * \param profile souhrn, do ktereho se faze pricte (0 = nemerit)
+     * \param stage faze
+     */
+    PerfScope(PerfProfile* profile, PerfStage stage);
+
+    /*!
+     * \brief Pricte namerene hodnoty do souhrnu.
+     */
+    ~PerfScope();
+
+private:
+    PerfScope(const PerfScope&);
+    PerfScope& operator =(const PerfScope&);
+
+private:
+    PerfProfile* profile;
+    PerfStage stage;
+    PerfCounters* counters;
+    PerfValues start;
+};
+
+#endif // PERFCOUNTERS_H
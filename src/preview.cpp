@@ -0,0 +1,135 @@
+#include "preview.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+#include "film.h"
+
+TerminalPreview::TerminalPreview(const Film& film, const TileGrid& grid, const TileFlags& done,
+                                 const ToneMapper& toneMapper, double fps, size_t columns)
+    : film(film), grid(grid), done(done), toneMapper(toneMapper), fps(fps), columns(columns), rows(0),
+      drawnLines(0), drawnTiles(0), running(false)
+{
+    if (this->columns == 0) {
+        struct winsize ws;
+        if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &ws) == 0 && ws.ws_col > 0)
+            this->columns = ws.ws_col;
+        else
+            this->columns = 80;
+    }
+
+    const CropWindow& window = grid.window();
+    this->columns = std::max<size_t>(1, std::min(this->columns, window.width()));
+
+    //zachovani pomeru stran, znak ma dva pixely nahledu nad sebou
+    rows = std::max<size_t>(2, window.height() * this->columns / window.width());
+    rows += rows % 2;
+}
+
+TerminalPreview::~TerminalPreview()
+{
+    stop();
+}
+
+void TerminalPreview::start()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (running)
+        return;
+
+    running = true;
+    thread = std::thread(&TerminalPreview::run, this);
+}
+
+void TerminalPreview::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!running)
+            return;
+        running = false;
+    }
+
+    wake.notify_all();
+    thread.join();
+
+    //konecny stav se vykresli vzdy
+    drawnTiles = static_cast<size_t>(-1);
+    draw();
+}
+
+void TerminalPreview::run()
+{
+    const std::chrono::duration<double> period(1.0 / fps);
+
+    std::unique_lock<std::mutex> lock(mutex);
+    while (running) {
+        lock.unlock();
+        draw();
+        lock.lock();
+
+        wake.wait_for(lock, period, [this]() { return !running; });
+    }
+}
+
+void TerminalPreview::sample(size_t column, size_t row, unsigned char rgb[3]) const
+{
+    const CropWindow& window = grid.window();
+    const size_t x = window.x0 + (2 * column + 1) * window.width() / (2 * columns);
+    const size_t y = window.y0 + (2 * row + 1) * window.height() / (2 * rows);
+
+    if (!done[grid.index(x, y)].load(std::memory_order_acquire)) {
+        rgb[0] = rgb[1] = rgb[2] = 0;
+        return;
+    }
+
+    toneMapper.map(film.row(x, y), rgb, 3);
+}
+
+void TerminalPreview::draw()
+{
+    size_t finished = 0;
+    for (size_t i = 0; i < done.size(); ++i) {
+        if (done[i].load(std::memory_order_relaxed))
+            ++finished;
+    }
+
+    //bez zmeny se neprekresluje
+    if (finished == drawnTiles)
+        return;
+    drawnTiles = finished;
+
+    buffer.clear();
+
+    //navrat kurzoru na zacatek predchoziho nahledu
+    char escape[64];
+    if (drawnLines > 0) {
+        snprintf(escape, sizeof(escape), "\x1b[%zuA\r", drawnLines);
+        buffer += escape;
+    }
+
+    unsigned char top[3], bottom[3];
+    for (size_t row = 0; row < rows; row += 2) {
+        for (size_t column = 0; column < columns; ++column) {
+            sample(column, row, top);
+            sample(column, row + 1, bottom);
+            snprintf(escape, sizeof(escape), "\x1b[38;2;%d;%d;%dm\x1b[48;2;%d;%d;%dm",
+                     top[0], top[1], top[2], bottom[0], bottom[1], bottom[2]);
+            buffer += escape;
+            buffer += "\xe2\x96\x80"; // U+2580 horni pulblok
+        }
+        buffer += "\x1b[0m\n";
+    }
+
+    snprintf(escape, sizeof(escape), "Tiles: %zu/%zu\x1b[K\n", finished, done.size());
+    buffer += escape;
+    drawnLines = rows / 2 + 1;
+
+    fwrite(buffer.data(), 1, buffer.size(), stdout);
+    fflush(stdout);
+}
@@ -0,0 +1,78 @@
+#ifndef PREVIEW_H
+#define PREVIEW_H
+
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "core.h"
+
+#include "tile.h"
+#include "tonemap.h"
+
+/*!
+ * Zivy nahled renderu v terminalu. Zmenseny obraz filmu se kresli znaky
+ * pulbloku (horni pixel jako barva popredi, dolni jako barva pozadi)
+ * v 24bitovych barvach ANSI. Kresli se z vlastniho vlakna s omezenou
+ * frekvenci, renderovaci vlakna na vystup do terminalu nikdy necekaji.
+ * Cte se pouze z dokoncenych dlazdic, rozpracovane zustavaji tmave.
+ */
+class TerminalPreview
+{
+public:
+    /*!
+     * \brief Konstruktor.
+     * \param film renderovany film
+     * \param grid dlazdice renderovaneho vyrezu
+     * \param done priznaky dokoncenych dlazdic
+     * \param toneMapper prevod na barvy terminalu, stejny jako pro vystupni obrazek
+     * \param fps maximalni pocet prekresleni za sekundu
+     * \param columns sirka nahledu ve znacich (0 = podle terminalu)
+     */
+    TerminalPreview(const Film& film, const TileGrid& grid, const TileFlags& done,
+                    const ToneMapper& toneMapper, double fps, size_t columns = 0);
+    ~TerminalPreview();
+
+    /*!
+     * \brief Spusti kreslici vlakno.
+     */
+    void start();
+
+    /*!
+     * \brief Zastavi kreslici vlakno a vykresli konecny stav.
+     */
+    void stop();
+
+private:
+    TerminalPreview(const TerminalPreview&);
+    TerminalPreview& operator =(const TerminalPreview&);
+
+    void run();
+    void draw();
+
+    /*!
+     * \brief Hodnota kanalu 0-255 pro pixel nahledu (0 pro nedokoncene dlazdice).
+     */
+    void sample(size_t column, size_t row, unsigned char rgb[3]) const;
+
+private:
+    const Film& film;
+    const TileGrid& grid;
+    const TileFlags& done;
+    ToneMapper toneMapper;
+    double fps;
+    size_t columns; ///< sirka nahledu ve znacich
+    size_t rows; ///< vyska nahledu v pixelech (2 na radek znaku)
+    size_t drawnLines; ///< pocet radku posledniho vykresleni
+    size_t drawnTiles; ///< pocet dokoncenych dlazdic pri poslednim vykresleni
+
+    std::thread thread;
+    std::mutex mutex;
+    std::condition_variable wake;
+    bool running;
+    std::string buffer;
+};
+
+#endif // PREVIEW_H
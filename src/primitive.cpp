@@ -1,10 +1,28 @@
 #include "primitive.h"
 
 #include <algorithm>
+#include <chrono>
+#include <cmath>
 
 #include "geometry.h"
 #include "intersection.h"
 
+namespace {
+
+/**
+ * Sférické texturovací souřadnice z normály koule.
+ */
+void sphereCoords(const Normal& n, float radius, Intersection& inter)
+{
+    inter.u = 0.5f + std::atan2(n.z, n.x) / (2.f * static_cast<float>(M_PI));
+    inter.v = std::acos(std::min(std::max(n.y, -1.f), 1.f)) / static_cast<float>(M_PI);
+    inter.uvScale = 1.f / (static_cast<float>(M_PI) * radius);
+}
+
+}
+
+thread_local uint64_t primitiveTests = 0;
+
 std::shared_ptr<Material> Primitive::getMaterial(void)
 {
     return material;
@@ -15,6 +33,53 @@ void Primitive::setMaterial(const std::shared_ptr<Material>& material)
     this->material = material;
 }
 
+void Primitive::setObjectId(uint32_t id)
+{
+    objectId = id;
+}
+
+size_t Primitive::objectCount() const
+{
+    return 1;
+}
+
+size_t Primitive::memoryUsage() const
+{
+    return sizeof(*this);
+}
+
+bool Primitive::intersect(const Ray& ray, Intersection& inter)
+{
+    //pruchodovy paprsek se sestavi jednou a sdili ho cela hierarchie
+    const TraversalRay traversal(ray);
+    SurfaceHit hit(std::min(inter.t, traversal.tMax));
+    if (!intersectNearest(traversal, hit))
+        return false;
+
+    surfaceInteraction(ray, hit, inter);
+    return true;
+}
+
+void Primitive::surfaceInteraction(const Ray& ray, const SurfaceHit& hit, Intersection& inter) const
+{
+    if (hit.instance)
+        hit.instance->surfaceInteraction(ray, hit, inter);
+    else
+        hit.primitive->surfaceInteraction(ray, hit, inter);
+}
+
+uint64_t Primitive::intersectPacketP(const ShadowPacket& packet, uint64_t active)
+{
+    uint64_t occluded = 0;
+    for (size_t i = 0; i < packet.count; ++i) {
+        const uint64_t bit = uint64_t(1) << i;
+        if ((active & bit) && intersectP(TraversalRay(packet.ray(i))))
+            occluded |= bit;
+    }
+
+    return occluded;
+}
+
 Primitive::~Primitive()
 {}
 
@@ -32,8 +97,10 @@ Sphere::Sphere(const Sphere& sphere)
 Sphere::~Sphere()
 {}
 
-bool Sphere::intersectP(const Ray& ray)
+bool Sphere::intersectP(const TraversalRay& ray)
 {
+    ++primitiveTests;
+
     Vector temp = ray.o - center;
     float a = dot(ray.d, ray.d);
     float b = 2 * dot(temp, ray.d);
@@ -43,7 +110,7 @@ bool Sphere::intersectP(const Ray& ray)
 
     if (solveQuadratic(a, b, c, &t1, &t2)) {
         float t = std::min(t1, t2);
-        if (t > EPSILON) {
+        if (t > ray.tMin && t < ray.tMax) {
             return true;
         }
     }
@@ -51,8 +118,24 @@ bool Sphere::intersectP(const Ray& ray)
     return false;
 }
 
-bool Sphere::intersect(const Ray& ray, Intersection& inter)
+uint64_t Sphere::intersectPacketP(const ShadowPacket& packet, uint64_t active)
+{
+    if (!packet.overlaps(worldBound()))
+        return 0;
+
+    return Primitive::intersectPacketP(packet, active);
+}
+
+BBox Sphere::worldBound() const
+{
+    const Vector r(radius, radius, radius);
+    return BBox(center - r, center + r);
+}
+
+bool Sphere::intersectNearest(const TraversalRay& ray, SurfaceHit& hit)
 {
+    ++primitiveTests;
+
     Vector temp = ray.o - center;
     float a = dot(ray.d, ray.d);
     float b = 2 * dot(temp, ray.d);
@@ -63,14 +146,10 @@ bool Sphere::intersect(const Ray& ray, Intersection& inter)
     if (solveQuadratic(a, b, c, &t1, &t2)) {
         float t = std::min(t1, t2);
 
-        if (t > EPSILON && t < inter.t) {
-            ray.rayEpsilon = 1e-3f * t;
-            inter.normal = (temp + ray.d * t) / radius;
-            inter.ray = ray;
-            inter.t = t;
-            inter.hitPoint = ray(t);
-            inter.hitObject = true;
-            inter.material = getMaterial();
+        if (t > ray.tMin && t < hit.t) {
+            hit.t = t;
+            hit.primitive = this;
+            hit.instance = 0;
 
             return true;
         }
@@ -78,3 +157,302 @@ bool Sphere::intersect(const Ray& ray, Intersection& inter)
 
     return false;
 }
+
+void Sphere::surfaceInteraction(const Ray& ray, const SurfaceHit& hit, Intersection& inter) const
+{
+    const float t = hit.t;
+    Vector temp = ray.o - center;
+
+    inter.normal = (temp + ray.d * t) / radius;
+    sphereCoords(inter.normal, radius, inter);
+    inter.ray = ray;
+    inter.t = t;
+    inter.hitPoint = ray(t);
+    inter.hitObject = true;
+    inter.material = material;
+    inter.objectId = objectId;
+}
+
+
+//SphereSet
+SphereSet::SphereSet(const std::shared_ptr<GeometryFile>& file,
+                     const std::vector<std::shared_ptr<Material> >& materials,
+                     size_t buildThreads, HierarchyType hierarchy, const std::string& cacheDir)
+    : Primitive(std::shared_ptr<Material>()), file(file), materials(materials),
+      spheres(0), count(0), hierarchyType(hierarchy)
+{
+    typedef std::chrono::steady_clock Clock;
+    const size_t maxLeafSize = 4;
+
+    spheres = file->spheres(count);
+
+    uint64_t hash = 0;
+    if (!cacheDir.empty()) {
+        Clock::time_point start = Clock::now();
+        hash = sphereGeometryHash(spheres, count, maxLeafSize);
+        cache.enabled = true;
+        cache.path = bvhCachePath(cacheDir, hash);
+        cache.hashTime = std::chrono::duration<double>(Clock::now() - start).count();
+
+        start = Clock::now();
+        cache.hit = loadBVHCache(cache.path, hash, count, maxLeafSize, bvh);
+        cache.loadTime = std::chrono::duration<double>(Clock::now() - start).count();
+    }
+
+    if (!cache.hit) {
+        Clock::time_point start = Clock::now();
+
+        std::vector<BBox> bounds(count);
+        for (size_t i = 0; i < count; ++i) {
+            const SphereRecord& s = spheres[i];
+            const Point c(s.center[0], s.center[1], s.center[2]);
+            const Vector r(s.radius, s.radius, s.radius);
+            bounds[i] = BBox(c - r, c + r);
+        }
+
+        bvh.build(bounds, maxLeafSize, buildThreads);
+        cache.buildTime = std::chrono::duration<double>(Clock::now() - start).count();
+
+        if (cache.enabled)
+            cache.saved = saveBVHCache(cache.path, hash, count, maxLeafSize, bvh);
+    }
+
+    //kompaktni hierarchie se prevede z binarni, ta se pak uvolni
+    if (hierarchyType == HIERARCHY_QBVH) {
+        if (qbvh.build(bvh))
+            bvh.clear();
+        else
+            hierarchyType = HIERARCHY_BVH;
+    }
+}
+
+HierarchyType SphereSet::hierarchy() const
+{
+    return hierarchyType;
+}
+
+size_t SphereSet::nodeCount() const
+{
+    return hierarchyType == HIERARCHY_QBVH ? qbvh.nodeCount() : bvh.nodeCount();
+}
+
+size_t SphereSet::hierarchyMemory() const
+{
+    return hierarchyType == HIERARCHY_QBVH ? qbvh.memoryUsage() : bvh.memoryUsage();
+}
+
+const BVHCacheStats& SphereSet::cacheStats() const
+{
+    return cache;
+}
+
+float SphereSet::sahCost() const
+{
+    return hierarchyType == HIERARCHY_QBVH ? qbvh.sahCost() : bvh.sahCost();
+}
+
+SphereSet::~SphereSet()
+{}
+
+size_t SphereSet::size() const
+{
+    return count;
+}
+
+size_t SphereSet::objectCount() const
+{
+    return count;
+}
+
+size_t SphereSet::memoryUsage() const
+{
+    return sizeof(*this) + hierarchyMemory() + file->fileSize();
+}
+
+BBox SphereSet::worldBound() const
+{
+    return hierarchyType == HIERARCHY_QBVH ? qbvh.bounds() : bvh.bounds();
+}
+
+bool SphereSet::intersectP(const TraversalRay& ray)
+{
+    float a = dot(ray.d, ray.d);
+
+    auto test = [&](uint32_t i) {
+        ++primitiveTests;
+        const SphereRecord& s = spheres[i];
+        Vector temp = ray.o - Point(s.center[0], s.center[1], s.center[2]);
+        float b = 2 * dot(temp, ray.d);
+        float c = dot(temp, temp) - s.radius * s.radius;
+
+        float t1, t2;
+        if (!solveQuadratic(a, b, c, &t1, &t2))
+            return false;
+
+        const float t = std::min(t1, t2);
+        return t > ray.tMin && t < ray.tMax;
+    };
+
+    if (hierarchyType == HIERARCHY_QBVH)
+        return qbvh.intersectP(ray, ray.tMax, test);
+
+    return bvh.intersectP(ray, ray.tMax, test);
+}
+
+uint64_t SphereSet::intersectPacketP(const ShadowPacket& packet, uint64_t active)
+{
+    if (hierarchyType != HIERARCHY_BVH)
+        return Primitive::intersectPacketP(packet, active);
+
+    return bvh.intersectP(packet, active, [&](uint32_t index, uint64_t mask) {
+        const SphereRecord& s = spheres[index];
+        const Point center(s.center[0], s.center[1], s.center[2]);
+        const Vector r(s.radius, s.radius, s.radius);
+        if (!packet.overlaps(BBox(center - r, center + r)))
+            return uint64_t(0);
+        primitiveTests += __builtin_popcountll(mask);
+
+        //stejny vypocet jako v intersectP(const TraversalRay&) pro vsechny aktivni paprsky najednou
+        return simdKernels().packetSphere(packet, s.center, s.radius, mask);
+    });
+}
+
+bool SphereSet::intersectNearest(const TraversalRay& ray, SurfaceHit& hit)
+{
+    float a = dot(ray.d, ray.d);
+    bool found = false;
+
+    auto test = [&](uint32_t i) {
+        ++primitiveTests;
+        const SphereRecord& s = spheres[i];
+        Vector temp = ray.o - Point(s.center[0], s.center[1], s.center[2]);
+        float b = 2 * dot(temp, ray.d);
+        float c = dot(temp, temp) - s.radius * s.radius;
+
+        float t1, t2;
+        if (solveQuadratic(a, b, c, &t1, &t2)) {
+            float t = std::min(t1, t2);
+            if (t > ray.tMin && t < hit.t) {
+                hit.t = t;
+                hit.element = i;
+                found = true;
+            }
+        }
+    };
+
+    if (hierarchyType == HIERARCHY_QBVH)
+        qbvh.intersect(ray, hit.t, test);
+    else
+        bvh.intersect(ray, hit.t, test);
+
+    if (!found)
+        return false;
+
+    hit.primitive = this;
+    hit.instance = 0;
+    return true;
+}
+
+void SphereSet::surfaceInteraction(const Ray& ray, const SurfaceHit& hit, Intersection& inter) const
+{
+    const SphereRecord& s = spheres[hit.element];
+    const float t = hit.t;
+    Vector temp = ray.o - Point(s.center[0], s.center[1], s.center[2]);
+
+    inter.normal = (temp + ray.d * t) / s.radius;
+    sphereCoords(inter.normal, s.radius, inter);
+    inter.ray = ray;
+    inter.t = t;
+    inter.hitPoint = ray(t);
+    inter.hitObject = true;
+    inter.material = s.material < materials.size() ? materials[s.material] : material;
+    inter.objectId = objectId + hit.element;
+}
+
+//Instance
+Instance::Instance(const std::shared_ptr<Primitive>& object, const Transform& objectToWorld)
+    : Primitive(std::shared_ptr<Material>()), object(object)
+{
+    setTransform(objectToWorld);
+}
+
+Instance::~Instance()
+{}
+
+void Instance::setTransform(const Transform& objectToWorld)
+{
+    this->objectToWorld = objectToWorld;
+    worldToObject = objectToWorld.inverse();
+    identity = objectToWorld.isIdentity();
+}
+
+const std::shared_ptr<Primitive>& Instance::getObject() const
+{
+    return object;
+}
+
+void Instance::setObjectId(uint32_t id)
+{
+    Primitive::setObjectId(id);
+    object->setObjectId(id);
+}
+
+size_t Instance::objectCount() const
+{
+    return object->objectCount();
+}
+
+size_t Instance::memoryUsage() const
+{
+    return sizeof(*this) + object->memoryUsage();
+}
+
+BBox Instance::worldBound() const
+{
+    return objectToWorld(object->worldBound());
+}
+
+bool Instance::intersectP(const TraversalRay& ray)
+{
+    if (identity)
+        return object->intersectP(ray);
+
+    return object->intersectP(worldToObject(ray));
+}
+
+uint64_t Instance::intersectPacketP(const ShadowPacket& packet, uint64_t active)
+{
+    //svazek se prevadi jen pro identitu, jinak se paprsky transformuji jednotlive
+    if (identity)
+        return object->intersectPacketP(packet, active);
+
+    return Primitive::intersectPacketP(packet, active);
+}
+
+bool Instance::intersectNearest(const TraversalRay& ray, SurfaceHit& hit)
+{
+    if (identity)
+        return object->intersectNearest(ray, hit);
+
+    //smer se nenormalizuje, parametr t je v obou prostorech stejny
+    if (!object->intersectNearest(worldToObject(ray), hit))
+        return false;
+
+    hit.instance = this;
+    return true;
+}
+
+void Instance::surfaceInteraction(const Ray& ray, const SurfaceHit& hit, Intersection& inter) const
+{
+    if (identity) {
+        hit.primitive->surfaceInteraction(ray, hit, inter);
+        return;
+    }
+
+    hit.primitive->surfaceInteraction(worldToObject(ray), hit, inter);
+
+    inter.ray = ray;
+    inter.hitPoint = ray(hit.t);
+    inter.normal = objectToWorld(inter.normal);
+    inter.normal.normalize();
+}
@@ -1,11 +1,26 @@
 #ifndef PRIMITIVE_H
 #define PRIMITIVE_H
 
+#include <cstdint>
 #include <memory>
+#include <string>
+#include <vector>
 
 #include "core.h"
 
+#include "bvh.h"
+#include "bvhcache.h"
 #include "geometry.h"
+#include "geometryfile.h"
+#include "packet.h"
+#include "qbvh.h"
+#include "transform.h"
+
+/**
+ * Počet testů průsečíku paprsku s primitivy (koulemi) provedených volajícím
+ * vláknem. Slouží k měření ceny pixelů, rozdíl dvou čtení je cena úseku.
+ */
+extern thread_local uint64_t primitiveTests;
 
 /**
  * Bázová třída pro objekty, které představují geomettrická tělesa.
@@ -19,7 +34,7 @@ public:
      * @param _mat materiál nového tělesa
      */
     Primitive(const std::shared_ptr<Material>& mat)
-        : material(mat)
+        : material(mat), objectId(0)
     {}
 
     /**
@@ -27,7 +42,7 @@ public:
      * @param prm kopírovaná instance
      */
     Primitive(const Primitive& p)
-        : material(p.material)
+        : material(p.material), objectId(p.objectId)
     {}
 
     /**
@@ -36,18 +51,54 @@ public:
     virtual ~Primitive();
 
     /**
-     * Výchozí implementace metody @a Primitive::Intersect(const Ray&, Intersection&).
-     * @see Primitive::Intersect(const Ray&, Intersection&)
-     * @return false
+     * Najde nejbližší průsečík a dopočítá jeho atributy. Skládá se z levného
+     * hledání intersectNearest() a jediného volání surfaceInteraction().
+     * @param ray paprsek
+     * @param inter výsledek; inter.t je na vstupu horní mez
+     * @return true pokud byl nalezen bližší průsečík
+     */
+    bool intersect(const Ray& ray, Intersection& inter);
+
+    /**
+     * Levná fáze hledání průsečíku: zjistí jen parametr t a zasažené těleso,
+     * atributy povrchu nepočítá.
+     * @param ray předpočítaný paprsek, během hledání se nemění
+     * @param hit nejbližší dosud nalezený zásah, přepíše se bližším
+     * @return true pokud byl nalezen bližší průsečík
      */
-    virtual bool intersect(const Ray& ray, Intersection& inter) = 0;
+    virtual bool intersectNearest(const TraversalRay& ray, SurfaceHit& hit) = 0;
 
     /**
-     * Výchozí implementace metody @a Primitive::IntersectP(const Ray&)
-     * @see Primitive::IntersectP(const Ray&)
-     * @return false
+     * Dopočítá atributy povrchu pro zásah nalezený metodou intersectNearest().
+     * Výchozí implementace (pro agregáty) předá výpočet zasažené instanci
+     * nebo tělesu.
+     * @param ray paprsek, se kterým byl zásah nalezen
+     * @param hit výsledný zásah
+     * @param inter vyplněné atributy průsečíku
      */
-    virtual bool intersectP(const Ray& ray) = 0;
+    virtual void surfaceInteraction(const Ray& ray, const SurfaceHit& hit, Intersection& inter) const;
+
+    /**
+     * Test zakrytí: protne paprsek těleso v intervalu (tMin, tMax)?
+     * @param ray předpočítaný paprsek
+     * @return true pokud paprsek těleso protne
+     */
+    virtual bool intersectP(const TraversalRay& ray) = 0;
+
+    /**
+     * Test zakrytí pro svazek stínových paprsků. Výchozí implementace
+     * testuje paprsky jednotlivě metodou intersectP(const TraversalRay&).
+     * @param packet svazek paprsků
+     * @param active maska testovaných paprsků
+     * @return maska zakrytých paprsků z active
+     */
+    virtual uint64_t intersectPacketP(const ShadowPacket& packet, uint64_t active);
+
+    /**
+     * Obalový kvádr tělesa ve světových souřadnicích.
+     * @return obalový kvádr
+     */
+    virtual BBox worldBound() const = 0;
 
     /**
      * Získá materiál tělesa.
@@ -61,8 +112,29 @@ public:
      */
     void setMaterial(const std::shared_ptr<Material>& material);
 
+    /**
+     * Nastaví identifikátor objektu pro pomocný kanál id.
+     * Těleso obsahující více objektů použije rozsah od tohoto čísla.
+     * @param id první identifikátor tělesa
+     */
+    virtual void setObjectId(uint32_t id);
+
+    /**
+     * Počet identifikátorů, které těleso spotřebuje.
+     * @return 1 pro samostatné těleso
+     */
+    virtual size_t objectCount() const;
+
+    /**
+     * Odhad paměti obsazené tělesem včetně akcelerační struktury
+     * a namapovaných dat (bez sdílených materiálů).
+     * @return velikost v bajtech
+     */
+    virtual size_t memoryUsage() const;
+
 protected:
     std::shared_ptr<Material> material; ///< Materiál tělesa.
+    uint32_t objectId; ///< Identifikátor tělesa.
 };
 
 class Sphere : public Primitive
@@ -73,12 +145,138 @@ public:
     Sphere(const Sphere& sphere);
     virtual ~Sphere();
 
-    virtual bool intersect(const Ray& ray, Intersection& inter);
-    virtual bool intersectP(const Ray& ray);
+    virtual bool intersectNearest(const TraversalRay& ray, SurfaceHit& hit);
+    virtual void surfaceInteraction(const Ray& ray, const SurfaceHit& hit, Intersection& inter) const;
+    virtual bool intersectP(const TraversalRay& ray);
+    virtual uint64_t intersectPacketP(const ShadowPacket& packet, uint64_t active);
+    virtual BBox worldBound() const;
 
 private:
     Point center;
     float radius;
 };
 
+/**
+ * Množina koulí uložená v souboru geometrie namapovaném do paměti.
+ * Záznamy se čtou přímo z namapovaných stránek, nic se nekopíruje.
+ * Nad koulemi se při vytvoření jednou postaví vlastní BVH (spodní úroveň).
+ */
+class SphereSet : public Primitive
+{
+public:
+    /**
+     * Konstruktor.
+     * @param file otevřený soubor geometrie
+     * @param materials materiály odpovídající sekci materiálů v souboru
+     * @param buildThreads počet vláken pro stavbu hierarchie
+     * @param hierarchy druh hierarchie nad koulemi
+     * @param cacheDir adresář diskové cache hierarchií (prázdný = bez cache)
+     */
+    SphereSet(const std::shared_ptr<GeometryFile>& file,
+              const std::vector<std::shared_ptr<Material> >& materials,
+              size_t buildThreads = 1, HierarchyType hierarchy = HIERARCHY_BVH,
+              const std::string& cacheDir = std::string());
+    virtual ~SphereSet();
+
+    virtual bool intersectNearest(const TraversalRay& ray, SurfaceHit& hit);
+    virtual void surfaceInteraction(const Ray& ray, const SurfaceHit& hit, Intersection& inter) const;
+    virtual bool intersectP(const TraversalRay& ray);
+    virtual uint64_t intersectPacketP(const ShadowPacket& packet, uint64_t active);
+    virtual BBox worldBound() const;
+    virtual size_t memoryUsage() const;
+
+    /**
+     * Druh hierarchie nad koulemi.
+     */
+    HierarchyType hierarchy() const;
+
+    /**
+     * Počet uzlů hierarchie.
+     */
+    size_t nodeCount() const;
+
+    /**
+     * Paměť obsazená hierarchií v bajtech.
+     */
+    size_t hierarchyMemory() const;
+
+    /**
+     * SAH cena hierarchie.
+     * @see BVH::sahCost
+     */
+    float sahCost() const;
+
+    /**
+     * Počet koulí v množině.
+     */
+    size_t size() const;
+
+    /**
+     * Výsledek použití diskové cache hierarchie.
+     */
+    const BVHCacheStats& cacheStats() const;
+
+    /**
+     * Každá koule má vlastní identifikátor.
+     */
+    virtual size_t objectCount() const;
+
+private:
+    std::shared_ptr<GeometryFile> file; ///< drží mapování při životě
+    std::vector<std::shared_ptr<Material> > materials;
+    const SphereRecord* spheres; ///< záznamy přímo v namapované paměti
+    size_t count;
+    HierarchyType hierarchyType;
+    BVHCacheStats cache; ///< výsledek použití cache
+    BVH bvh; ///< binární hierarchie nad koulemi (HIERARCHY_BVH)
+    QBVH qbvh; ///< kompaktní hierarchie nad koulemi (HIERARCHY_QBVH)
+};
+
+/**
+ * Instance objektu umístěná do scény transformací. Objekt (včetně své
+ * akcelerační struktury) může být sdílen více instancemi; přesun instance
+ * mění jen transformaci, spodní úroveň zůstává beze změny.
+ */
+class Instance : public Primitive
+{
+public:
+    /**
+     * Konstruktor.
+     * @param object instancovaný objekt
+     * @param objectToWorld transformace z prostoru objektu do scény
+     */
+    Instance(const std::shared_ptr<Primitive>& object, const Transform& objectToWorld);
+    virtual ~Instance();
+
+    virtual bool intersectNearest(const TraversalRay& ray, SurfaceHit& hit);
+    virtual void surfaceInteraction(const Ray& ray, const SurfaceHit& hit, Intersection& inter) const;
+    virtual bool intersectP(const TraversalRay& ray);
+    virtual uint64_t intersectPacketP(const ShadowPacket& packet, uint64_t active);
+    virtual BBox worldBound() const;
+
+    /**
+     * Identifikátory se předávají instancovanému objektu.
+     */
+    virtual void setObjectId(uint32_t id);
+    virtual size_t objectCount() const;
+    virtual size_t memoryUsage() const;
+
+    /**
+     * Nastaví novou polohu instance. Horní úroveň je potom nutné přestavět.
+     * @param objectToWorld transformace z prostoru objektu do scény
+     */
+    void setTransform(const Transform& objectToWorld);
+
+    /**
+     * Instancovaný objekt.
+     */
+    const std::shared_ptr<Primitive>& getObject() const;
+
+private:
+    std::shared_ptr<Primitive> object;
+    Transform objectToWorld;
+    Transform worldToObject;
+    bool identity; ///< transformace je identita, paprsky se nepřevádějí
+};
+
 #endif // PRIMITIVE_H
@@ -0,0 +1,260 @@
+#include "qbvh.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+namespace {
+
+const float TRAVERSAL_COST = 0.125f; ///< stejna jako pri stavbe binarni BVH
+
+/*!
+ * \brief Kvantizacni krok, po 255 krocich se vzdy dosahne az na hornu mez.
+ */
+float quantizationStep(float lo, float hi)
+{
+    if (!(hi > lo))
+        return 0.f;
+
+    float step = (hi - lo) / 255.f;
+    while (lo + 255.f * step < hi)
+        step = std::nextafter(step, std::numeric_limits<float>::infinity());
+
+    return step;
+}
+
+/*!
+ * \brief Konzervativni kvantizace jedne meze.
+ * \param up zaokrouhlovat nahoru (horni mez), jinak dolu
+ */
+uint8_t quantize(float value, float origin, float step, bool up)
+{
+    if (step == 0.f)
+        return 0;
+
+    const float q = (value - origin) / step;
+    int i = static_cast<int>(up ? std::ceil(q) : std::floor(q));
+    i = std::max(0, std::min(i, 255));
+
+    //zaokrouhleni pri deleni muze dekodovanou mez posunout dovnitr
+    while (!up && i > 0 && origin + i * step > value)
+        --i;
+    while (up && i < 255 && origin + i * step < value)
+        ++i;
+
+    return static_cast<uint8_t>(i);
+}
+
+}
+
+QBVH::QBVH()
+    : nodes(0), count(0), root(QBVH_EMPTY)
+{}
+
+QBVH::~QBVH()
+{
+    clear();
+}
+
+void QBVH::clear()
+{
+    free(nodes);
+    nodes = 0;
+    count = 0;
+    indices.clear();
+    root = QBVH_EMPTY;
+    rootBounds = BBox();
+}
+
+bool QBVH::build(const std::vector<BBox>& bounds, size_t threads)
+{
+    BVH bvh;
+    bvh.build(bounds, 4, threads);
+    return build(bvh);
+}
+
+bool QBVH::build(const BVH& bvh)
+{
+    clear();
+
+    const BVHNode* source = bvh.getNodes();
+    if (bvh.nodeCount() == 0)
+        return true;
+    if (bvh.indexCount() > QBVH_MAX_OFFSET)
+        return false;
+
+    indices.assign(bvh.getIndices(), bvh.getIndices() + bvh.indexCount());
+    rootBounds = source[0].bounds;
+
+    std::vector<SubtreeRange> ranges(bvh.nodeCount());
+    for (size_t i = bvh.nodeCount(); i-- > 0;) {
+        const BVHNode& node = source[i];
+        if (node.count > 0) {
+            ranges[i].first = node.offset;
+            ranges[i].count = node.count;
+        } else {
+            ranges[i].first = ranges[i + 1].first;
+            ranges[i].count = ranges[i + 1].count + ranges[node.offset].count;
+        }
+    }
+
+    std::vector<QBVHNode> out;
+    out.reserve(bvh.nodeCount() / 8 + 1);
+    root = emitNode(source, ranges, 0, out);
+
+    //uzly se presunou do pameti zarovnane na cache line
+    count = out.size();
+    if (count > 0) {
+        void* memory = 0;
+        if (posix_memalign(&memory, 64, count * sizeof(QBVHNode)) != 0) {
+            clear();
+            return false;
+        }
+        nodes = static_cast<QBVHNode*>(memory);
+        std::copy(out.begin(), out.end(), nodes);
+    }
+
+    return true;
+}
+
+uint32_t QBVH::emitNode(const BVHNode* source, const std::vector<SubtreeRange>& ranges,
+                        uint32_t index, std::vector<QBVHNode>& out)
+{
+    //male podstromy se stanou jednim listem, setri se tim vetsina uzlu
+    const BVHNode& node = source[index];
+    if (node.count > 0 || ranges[index].count <= QBVH_COLLAPSE_SIZE)
+        return emitLeaf(ranges[index].first, ranges[index].count, node.bounds, out);
+
+    //slouceni urovni: opakovane se otevre vnitrni potomek s nejvetsim povrchem
+    uint32_t children[QBVH_WIDTH] = { index + 1, node.offset };
+    size_t childCount = 2;
+    while (childCount < QBVH_WIDTH) {
+        int best = -1;
+        float bestArea = -1.f;
+        for (size_t i = 0; i < childCount; ++i) {
+            const BVHNode& c = source[children[i]];
+            if (c.count == 0 && ranges[children[i]].count > QBVH_COLLAPSE_SIZE
+                    && c.bounds.surfaceArea() > bestArea) {
+                best = static_cast<int>(i);
+                bestArea = c.bounds.surfaceArea();
+            }
+        }
+        if (best < 0)
+            break;
+
+        const uint32_t open = children[best];
+        children[best] = open + 1;
+        children[childCount++] = source[open].offset;
+    }
+
+    const uint32_t nodeIndex = static_cast<uint32_t>(out.size());
+    out.push_back(QBVHNode());
+
+    BBox childBounds[QBVH_WIDTH];
+    uint32_t childRefs[QBVH_WIDTH];
+    for (size_t i = 0; i < childCount; ++i) {
+        childBounds[i] = source[children[i]].bounds;
+        childRefs[i] = emitNode(source, ranges, children[i], out);
+    }
+
+    return emitWide(childBounds, childRefs, childCount, out, nodeIndex);
+}
+
+uint32_t QBVH::emitLeaf(uint32_t offset, uint32_t n, const BBox& bounds, std::vector<QBVHNode>& out)
+{
+    if (n <= QBVH_MAX_LEAF_SIZE)
+        return QBVH_LEAF | ((n - 1) << QBVH_LEAF_SHIFT) | offset;
+
+    //prilis velky list (mnoho prvku se stejnym stredem) se rozdeli na useky
+    const uint32_t nodeIndex = static_cast<uint32_t>(out.size());
+    out.push_back(QBVHNode());
+
+    BBox childBounds[QBVH_WIDTH];
+    uint32_t childRefs[QBVH_WIDTH];
+    const uint32_t chunk = (n + QBVH_WIDTH - 1) / QBVH_WIDTH;
+    size_t childCount = 0;
+    for (uint32_t first = 0; first < n; first += chunk, ++childCount) {
+        childBounds[childCount] = bounds;
+        childRefs[childCount] = emitLeaf(offset + first, std::min(chunk, n - first), bounds, out);
+    }
+
+    return emitWide(childBounds, childRefs, childCount, out, nodeIndex);
+}
+
+uint32_t QBVH::emitWide(const BBox* childBounds, const uint32_t* childRefs, size_t childCount,
+                        std::vector<QBVHNode>& out, uint32_t nodeIndex)
+{
+    BBox bounds;
+    for (size_t i = 0; i < childCount; ++i)
+        bounds.expand(childBounds[i]);
+
+    QBVHNode& node = out[nodeIndex];
+    for (int a = 0; a < 3; ++a) {
+        node.origin[a] = bounds.pMin[a];
+        node.scale[a] = quantizationStep(bounds.pMin[a], bounds.pMax[a]);
+    }
+
+    for (uint32_t i = 0; i < QBVH_WIDTH; ++i) {
+        node.child[i] = i < childCount ? childRefs[i] : QBVH_EMPTY;
+        for (int a = 0; a < 3; ++a) {
+            node.lo[a][i] = i < childCount ? quantize(childBounds[i].pMin[a], node.origin[a], node.scale[a], false) : 0;
+            node.hi[a][i] = i < childCount ? quantize(childBounds[i].pMax[a], node.origin[a], node.scale[a], true) : 0;
+        }
+    }
+
+    return nodeIndex;
+}
+
+BBox QBVH::childBounds(const QBVHNode& node, int child)
+{
+    Point pMin, pMax;
+    for (int a = 0; a < 3; ++a) {
+        pMin[a] = node.origin[a] + node.lo[a][child] * node.scale[a];
+        pMax[a] = node.origin[a] + node.hi[a][child] * node.scale[a];
+    }
+
+    return BBox(pMin, pMax);
+}
+
+BBox QBVH::bounds() const
+{
+    return rootBounds;
+}
+
+size_t QBVH::nodeCount() const
+{
+    return count;
+}
+
+size_t QBVH::memoryUsage() const
+{
+    return count * sizeof(QBVHNode) + indices.size() * sizeof(uint32_t);
+}
+
+float QBVH::sahCost() const
+{
+    if (root == QBVH_EMPTY)
+        return 0.f;
+
+    const float rootArea = rootBounds.surfaceArea();
+    if (rootArea <= 0.f)
+        return static_cast<float>(indices.size());
+
+    return static_cast<float>(costRecursive(root, rootBounds) / rootArea);
+}
+
+double QBVH::costRecursive(uint32_t ref, const BBox& box) const
+{
+    const float area = box.surfaceArea();
+    if (ref & QBVH_LEAF)
+        return area * (((ref & ~QBVH_LEAF) >> QBVH_LEAF_SHIFT) + 1);
+
+    const QBVHNode& node = nodes[ref];
+    double cost = area * TRAVERSAL_COST;
+    for (uint32_t i = 0; i < QBVH_WIDTH; ++i) {
+        if (node.child[i] != QBVH_EMPTY)
+            cost += costRecursive(node.child[i], childBounds(node, i));
+    }
+
+    return cost;
+}
@@ -0,0 +1,305 @@
+#ifndef QBVH_H
+#define QBVH_H
+
+/*!
+ * \file
+ * Kompaktni ctyrcestna BVH s kvantovanymi obalovymi kvadry.\n
+ * Strom vznika sloucenim urovni binarni BVH. Kazdy uzel uklada kvadry svych
+ * ctyr potomku jako 8bitova cisla relativne k vlastnimu kvadru a vejde se
+ * do jedne cache line (64 B). Kvantovani je konzervativni, dekodovany kvadr
+ * vzdy obsahuje puvodni. Vsechny ctyri kvadry se testuji najednou (SSE2).
+ */
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "core.h"
+
+#include "bvh.h"
+#include "geometry.h"
+
+/*!
+ * Druh akceleracni struktury nad mnozinou primitiv.
+ */
+enum HierarchyType {
+    HIERARCHY_BVH, ///< binarni BVH s 32B uzly
+    HIERARCHY_QBVH ///< ctyrcestna BVH s kvantovanymi kvadry
+};
+
+const uint32_t QBVH_WIDTH = 4; ///< pocet potomku uzlu
+const uint32_t QBVH_EMPTY = 0xffffffffu; ///< neobsazeny potomek
+const uint32_t QBVH_LEAF = 0x80000000u; ///< priznak listu v odkazu na potomka
+const uint32_t QBVH_LEAF_SHIFT = 27; ///< pozice poctu prvku listu (minus 1)
+const uint32_t QBVH_MAX_LEAF_SIZE = 16; ///< nejvetsi pocet prvku listu
+const uint32_t QBVH_COLLAPSE_SIZE = 4; ///< podstrom s nejvyse tolika prvky se slouci do listu
+const uint32_t QBVH_MAX_OFFSET = (1u << QBVH_LEAF_SHIFT) - 1; ///< nejvetsi index prvniho prvku listu
+
+/*!
+ * Nejvetsi hloubka listu. Kazdy uzel nahrazuje alespon jeden uzel binarni BVH
+ * a list s nejvyse 65535 prvky se rozdeli nejvyse do sesti urovni po QBVH_MAX_LEAF_SIZE.
+ */
+const size_t QBVH_MAX_DEPTH = BVH_MAX_DEPTH + 6;
+
+/*!
+ * Velikost zasobniku pruchodu, kazda uroven na nem nechava nejvyse tri sourozence.
+ */
+const size_t QBVH_STACK_SIZE = 3 * QBVH_MAX_DEPTH + 1;
+
+/*!
+ * Uzel ctyrcestne BVH (64 B). Kvadr potomku i v ose a je
+ * [origin[a] + lo[a][i] * scale[a], origin[a] + hi[a][i] * scale[a]].
+ * Odkaz na potomka je bud index uzlu, nebo list
+ * (QBVH_LEAF | (pocet - 1) << QBVH_LEAF_SHIFT | prvni index), nebo QBVH_EMPTY.
+ */
+struct QBVHNode {
+    float origin[3]; ///< roh kvadru uzlu
+    float scale[3]; ///< velikost kvantizacniho kroku v kazde ose
+    uint8_t lo[3][QBVH_WIDTH]; ///< dolni meze potomku [osa][potomek]
+    uint8_t hi[3][QBVH_WIDTH]; ///< horni meze potomku [osa][potomek]
+    uint32_t child[QBVH_WIDTH]; ///< odkazy na potomky
+};
+
+/*!
+ * Ctyrcestna BVH s kvantovanymi kvadry. Rozhrani pruchodu je stejne jako u BVH.
+ */
+class QBVH
+{
+public:
+    QBVH();
+    ~QBVH();
+
+    /*!
+     * \brief Postavi strom. Nejdrive se postavi binarni BVH, ktera se pak prevede.
+     * \param bounds obalove kvadry prvku
+     * \param threads pocet vlaken pro stavbu binarni BVH
+     * \return false pokud je prvku vice, nez dokaze format adresovat
+     */
+    bool build(const std::vector<BBox>& bounds, size_t threads = 1);
+
+    /*!
+     * \brief Prevede existujici binarni BVH.
+     */
+    bool build(const BVH& bvh);
+
+    /*!
+     * \brief Najde vsechny prvky, jejichz kvadr paprsek protne pred tMax.
+     * Potomci se navstevuji od nejblizsiho.
+     * \see BVH::intersect
+     */
+    template<class Visit>
+    void intersect(const TraversalRay& ray, const float& tMax, Visit visit) const;
+
+    /*!
+     * \brief Zjisti, zda paprsek zasahne nejaky prvek.
+     * \see BVH::intersectP
+     */
+    template<class Visit>
+    bool intersectP(const TraversalRay& ray, float tMax, Visit visit) const;
+
+    /*!
+     * \brief Obalovy kvadr vsech prvku.
+     */
+    BBox bounds() const;
+
+    /*!
+     * \brief Pocet uzlu.
+     */
+    size_t nodeCount() const;
+
+    /*!
+     * \brief Pamet obsazena uzly a indexy v bajtech.
+     */
+    size_t memoryUsage() const;
+
+    /*!
+     * \brief SAH cena stromu s dekodovanymi (zvetsenymi) kvadry.
+     * \see BVH::sahCost
+     */
+    float sahCost() const;
+
+private:
+    QBVH(const QBVH&);
+    QBVH& operator =(const QBVH&);
+
+    int intersectChildren(const QBVHNode& node, const TraversalRay& r, float tMax, float tNear[4]) const;
+
+    /*!
+     * Pocet prvku a prvni index podstromu binarni BVH. Indexy podstromu
+     * tvori souvisly usek, protoze uzly i listy jsou ulozeny do hloubky.
+     */
+    struct SubtreeRange {
+        uint32_t first;
+        uint32_t count;
+    };
+
+    uint32_t emitNode(const BVHNode* source, const std::vector<SubtreeRange>& ranges,
+                      uint32_t index, std::vector<QBVHNode>& out);
+    uint32_t emitLeaf(uint32_t offset, uint32_t count, const BBox& bounds, std::vector<QBVHNode>& out);
+    static uint32_t emitWide(const BBox* childBounds, const uint32_t* childRefs, size_t count,
+                             std::vector<QBVHNode>& out, uint32_t nodeIndex);
+    double costRecursive(uint32_t ref, const BBox& box) const;
+    static BBox childBounds(const QBVHNode& node, int child);
+
+    void clear();
+
+private:
+    QBVHNode* nodes; ///< uzly zarovnane na cache line
+    size_t count; ///< pocet uzlu
+    std::vector<uint32_t> indices; ///< indexy prvku serazene podle listu
+    uint32_t root; ///< odkaz na koren (uzel nebo list)
+    BBox rootBounds; ///< kvadr korene
+};
+
+inline int QBVH::intersectChildren(const QBVHNode& node, const TraversalRay& r, float tMax, float tNear[4]) const
+{
+#ifdef __SSE2__
+    const __m128i zero = _mm_setzero_si128();
+    __m128 t0 = _mm_setzero_ps();
+    __m128 t1 = _mm_set1_ps(tMax);
+
+    for (int a = 0; a < 3; ++a) {
+        int loBits, hiBits;
+        std::memcpy(&loBits, node.lo[a], 4);
+        std::memcpy(&hiBits, node.hi[a], 4);
+
+        //4 x uint8 -> 4 x float
+        const __m128 lo = _mm_cvtepi32_ps(_mm_unpacklo_epi16(
+                              _mm_unpacklo_epi8(_mm_cvtsi32_si128(loBits), zero), zero));
+        const __m128 hi = _mm_cvtepi32_ps(_mm_unpacklo_epi16(
+                              _mm_unpacklo_epi8(_mm_cvtsi32_si128(hiBits), zero), zero));
+
+        //meze se dekoduji stejne jako pri kvantizaci, aby zustaly konzervativni
+        const __m128 origin = _mm_set1_ps(node.origin[a]);
+        const __m128 scale = _mm_set1_ps(node.scale[a]);
+        const __m128 o = _mm_set1_ps(r.o[a]);
+        const __m128 inv = _mm_set1_ps(r.invDir[a]);
+
+        const __m128 tLo = _mm_mul_ps(_mm_sub_ps(_mm_add_ps(origin, _mm_mul_ps(lo, scale)), o), inv);
+        const __m128 tHi = _mm_mul_ps(_mm_sub_ps(_mm_add_ps(origin, _mm_mul_ps(hi, scale)), o), inv);
+
+        //NaN (0 * inf) se pri min/max zahodi ve prospech druheho operandu
+        t0 = _mm_max_ps(_mm_min_ps(tLo, tHi), t0);
+        t1 = _mm_min_ps(_mm_max_ps(tLo, tHi), t1);
+    }
+
+    _mm_storeu_ps(tNear, t0);
+    return _mm_movemask_ps(_mm_cmple_ps(t0, t1));
+#else
+    int mask = 0;
+    for (uint32_t i = 0; i < QBVH_WIDTH; ++i) {
+        float t0 = 0.f, t1 = tMax;
+        for (int a = 0; a < 3; ++a) {
+            float tLo = (node.origin[a] + node.lo[a][i] * node.scale[a] - r.o[a]) * r.invDir[a];
+            float tHi = (node.origin[a] + node.hi[a][i] * node.scale[a] - r.o[a]) * r.invDir[a];
+            if (tLo > tHi)
+                std::swap(tLo, tHi);
+
+            t0 = tLo > t0 ? tLo : t0;
+            t1 = tHi < t1 ? tHi : t1;
+        }
+
+        tNear[i] = t0;
+        if (t0 <= t1)
+            mask |= 1 << i;
+    }
+
+    return mask;
+#endif
+}
+
+template<class Visit>
+void QBVH::intersect(const TraversalRay& r, const float& tMax, Visit visit) const
+{
+    if (root == QBVH_EMPTY)
+        return;
+
+    //polozky zasobniku si pamatuji vzdalenost kvadru, vzdalene se preskoci
+    struct Entry {
+        uint32_t ref;
+        float tNear;
+    } stack[QBVH_STACK_SIZE];
+    int stackSize = 0;
+
+    stack[stackSize].ref = root;
+    stack[stackSize++].tNear = 0.f;
+
+    while (stackSize > 0) {
+        const Entry entry = stack[--stackSize];
+        if (entry.tNear > tMax)
+            continue;
+
+        if (entry.ref & QBVH_LEAF) {
+            const uint32_t first = entry.ref & QBVH_MAX_OFFSET;
+            const uint32_t n = ((entry.ref & ~QBVH_LEAF) >> QBVH_LEAF_SHIFT) + 1;
+            for (uint32_t i = 0; i < n; ++i)
+                visit(indices[first + i]);
+            continue;
+        }
+
+        const QBVHNode& node = nodes[entry.ref];
+        float tNear[4];
+        int mask = intersectChildren(node, r, tMax, tNear);
+
+        //zasazene potomky seradit od nejvzdalenejsiho, nejblizsi bude navrchu zasobniku
+        Entry hits[4];
+        int hitCount = 0;
+        for (uint32_t i = 0; i < QBVH_WIDTH; ++i) {
+            if (!(mask & (1 << i)) || node.child[i] == QBVH_EMPTY)
+                continue;
+
+            int j = hitCount++;
+            while (j > 0 && hits[j - 1].tNear < tNear[i]) {
+                hits[j] = hits[j - 1];
+                --j;
+            }
+            hits[j].ref = node.child[i];
+            hits[j].tNear = tNear[i];
+        }
+
+        for (int i = 0; i < hitCount; ++i)
+            stack[stackSize++] = hits[i];
+    }
+}
+
+template<class Visit>
+bool QBVH::intersectP(const TraversalRay& r, float tMax, Visit visit) const
+{
+    if (root == QBVH_EMPTY)
+        return false;
+
+    uint32_t stack[QBVH_STACK_SIZE];
+    int stackSize = 0;
+    stack[stackSize++] = root;
+
+    while (stackSize > 0) {
+        const uint32_t ref = stack[--stackSize];
+
+        if (ref & QBVH_LEAF) {
+            const uint32_t first = ref & QBVH_MAX_OFFSET;
+            const uint32_t n = ((ref & ~QBVH_LEAF) >> QBVH_LEAF_SHIFT) + 1;
+            for (uint32_t i = 0; i < n; ++i) {
+                if (visit(indices[first + i]))
+                    return true;
+            }
+            continue;
+        }
+
+        const QBVHNode& node = nodes[ref];
+        float tNear[4];
+        const int mask = intersectChildren(node, r, tMax, tNear);
+
+        for (uint32_t i = 0; i < QBVH_WIDTH; ++i) {
+            if ((mask & (1 << i)) && node.child[i] != QBVH_EMPTY)
+                stack[stackSize++] = node.child[i];
+        }
+    }
+
+    return false;
+}
+
+#endif // QBVH_H
@@ -0,0 +1,142 @@
+#include "raybatch.h"
+
+#include <algorithm>
+#include <limits>
+
+#include "scene.h"
+
+namespace {
+
+/*!
+ * \brief Rozprostre dolnich 10 bitu tak, aby mezi kazdymi dvema byly dva nulove.
+ */
+inline uint32_t expandBits(uint32_t v)
+{
+    v = (v * 0x00010001u) & 0xff0000ffu;
+    v = (v * 0x00000101u) & 0x0f00f00fu;
+    v = (v * 0x00000011u) & 0xc30c30c3u;
+    v = (v * 0x00000005u) & 0x49249249u;
+    return v;
+}
+
+inline uint32_t quantizeAxis(float value, float lo, float extent)
+{
+    if (!(extent > 0.f))
+        return 0;
+
+    const float q = (value - lo) / extent * 1024.f;
+    return static_cast<uint32_t>(std::max(0.f, std::min(q, 1023.f)));
+}
+
+}
+
+void RayBatch::clear()
+{
+    entries.clear();
+}
+
+void RayBatch::add(const Ray& ray, uint32_t sample, const RGBColor& contribution, uint32_t group)
+{
+    Entry e;
+    e.ray = ray;
+    e.sample = sample;
+    e.group = group;
+    e.contribution = contribution;
+    entries.push_back(e);
+}
+
+uint32_t RayBatch::sortKey(const Ray& ray, const BBox& bounds)
+{
+    const uint32_t octant = (ray.d.x < 0.f ? 1 : 0) | (ray.d.y < 0.f ? 2 : 0) | (ray.d.z < 0.f ? 4 : 0);
+
+    const Vector extent = bounds.diagonal();
+    const uint32_t x = quantizeAxis(ray.o.x, bounds.pMin.x, extent.x);
+    const uint32_t y = quantizeAxis(ray.o.y, bounds.pMin.y, extent.y);
+    const uint32_t z = quantizeAxis(ray.o.z, bounds.pMin.z, extent.z);
+
+    //30bitovy Mortonuv kod bez nejnizsiho bitu, aby se nad nej vesel oktant
+    const uint32_t morton = (expandBits(x) << 2) | (expandBits(y) << 1) | expandBits(z);
+    return (octant << 29) | (morton >> 1);
+}
+
+void RayBatch::trace(const Scene& scene, bool sorted, size_t packetSize)
+{
+    results.assign(entries.size(), 0);
+
+    if (!sorted && packetSize <= 1) {
+        for (size_t i = 0; i < entries.size(); ++i)
+            results[i] = scene.intersectP(entries[i].ray);
+        return;
+    }
+
+    //svazky vznikaji jen z paprsku stejne skupiny, ty musi byt pohromade
+    const BBox bounds = scene.worldBound();
+    order.resize(entries.size());
+    for (size_t i = 0; i < entries.size(); ++i) {
+        order[i].group = packetSize > 1 ? entries[i].group : 0;
+        order[i].key = sorted ? sortKey(entries[i].ray, bounds) : 0;
+        order[i].index = static_cast<uint32_t>(i);
+    }
+
+    std::sort(order.begin(), order.end());
+
+    if (packetSize > 1) {
+        tracePackets(scene, std::min(packetSize, SHADOW_PACKET_SIZE));
+        return;
+    }
+
+    for (size_t i = 0; i < order.size(); ++i) {
+        const uint32_t index = order[i].index;
+        results[index] = scene.intersectP(entries[index].ray);
+    }
+}
+
+void RayBatch::tracePackets(const Scene& scene, size_t packetSize)
+{
+    uint32_t lanes[SHADOW_PACKET_SIZE];
+
+    size_t i = 0;
+    while (i < order.size()) {
+        const uint32_t group = order[i].group;
+        packet.clear();
+
+        //po sobe jdouci paprsky skupiny; nekonecne paprsky se sleduji samostatne
+        for (; i < order.size() && order[i].group == group && packet.count < packetSize; ++i) {
+            const uint32_t index = order[i].index;
+            const Ray& ray = entries[index].ray;
+
+            if (ray.maxt < std::numeric_limits<float>::max())
+                lanes[packet.add(ray)] = index;
+            else
+                results[index] = scene.intersectP(ray);
+        }
+
+        if (packet.count == 0)
+            continue;
+
+        packet.finish();
+        const uint64_t occluded = scene.intersectP(packet, packet.all());
+        for (size_t lane = 0; lane < packet.count; ++lane)
+            results[lanes[lane]] = (occluded >> lane) & 1;
+    }
+}
+
+size_t RayBatch::size() const
+{
+    return entries.size();
+}
+
+uint32_t RayBatch::sample(size_t i) const
+{
+    return entries[i].sample;
+}
+
+const RGBColor& RayBatch::contribution(size_t i) const
+{
+    return entries[i].contribution;
+}
+
+bool RayBatch::occluded(size_t i) const
+{
+    return results[i] != 0;
+}
@@ -0,0 +1,105 @@
+#ifndef RAYBATCH_H
+#define RAYBATCH_H
+
+/*!
+ * \file
+ * Davkove sledovani sekundarnich paprsku.\n
+ * Paprsky se behem stinovani jen ukladaji. Pred sledovanim se seradi podle
+ * oktantu smeru a Mortonova kodu pocatku, takze po sobe jdouci paprsky
+ * prochazeji stejne casti akceleracni struktury a zustavaji v cache. Vysledky
+ * se zapisuji zpet na puvodni pozice, poradi pridani se tedy zachovava.\n
+ * Paprsky stejne skupiny (ke stejnemu svetlu) lze sledovat po svazcich,
+ * viz ShadowPacket.
+ */
+
+#include <cstdint>
+#include <vector>
+
+#include "core.h"
+
+#include "color.h"
+#include "geometry.h"
+#include "packet.h"
+
+class Scene;
+
+/*!
+ * Davka paprsku pro test zakryti (stinove paprsky).
+ */
+class RayBatch
+{
+public:
+    /*!
+     * \brief Odebere vsechny paprsky, alokovana pamet zustava.
+     */
+    void clear();
+
+    /*!
+     * \brief Prida paprsek do davky.
+     * \param ray paprsek
+     * \param sample index vzorku, kteremu paprsek patri
+     * \param contribution prispevek ke vzorku, pokud paprsek neni zakryty
+     * \param group skupina paprsku se spolecnym cilem (index svetla)
+     */
+    void add(const Ray& ray, uint32_t sample, const RGBColor& contribution, uint32_t group = 0);
+
+    /*!
+     * \brief Otestuje zakryti vsech paprsku.
+     * \param scene scena
+     * \param sorted seradit paprsky pred sledovanim (jinak v poradi pridani)
+     * \param packetSize nejvetsi velikost svazku (1 = kazdy paprsek zvlast)
+     */
+    void trace(const Scene& scene, bool sorted, size_t packetSize = 1);
+
+    size_t size() const;
+    uint32_t sample(size_t i) const;
+    const RGBColor& contribution(size_t i) const;
+
+    /*!
+     * \brief Vysledek testu paprsku i (platny po trace()).
+     */
+    bool occluded(size_t i) const;
+
+private:
+    /*!
+     * \brief Klic razeni: oktant smeru v nejvyssich bitech, pod nim
+     * Mortonuv kod pocatku v mrizce 1024^3 nad kvadrem sceny.
+     */
+    static uint32_t sortKey(const Ray& ray, const BBox& bounds);
+
+private:
+    void tracePackets(const Scene& scene, size_t packetSize);
+
+private:
+    struct Entry {
+        Ray ray;
+        uint32_t sample;
+        uint32_t group;
+        RGBColor contribution;
+    };
+
+    /*!
+     * Poradi sledovani: podle skupiny, klice razeni a poradi pridani.
+     */
+    struct OrderItem {
+        uint32_t group;
+        uint32_t key;
+        uint32_t index;
+
+        bool operator <(const OrderItem& o) const
+        {
+            if (group != o.group)
+                return group < o.group;
+            if (key != o.key)
+                return key < o.key;
+            return index < o.index;
+        }
+    };
+
+    std::vector<Entry> entries;
+    std::vector<uint8_t> results; ///< zakryti podle poradi pridani
+    std::vector<OrderItem> order; ///< poradi sledovani
+    ShadowPacket packet; ///< prave sledovany svazek
+};
+
+#endif // RAYBATCH_H
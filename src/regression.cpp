@@ -0,0 +1,122 @@
+#include "regression.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+
+namespace {
+
+/*!
+ * Precte dalsi cislo hlavicky PPM, preskakuje bile znaky a komentare.
+ */
+bool readHeaderValue(std::istream& in, size_t& value)
+{
+    for (;;) {
+        const int c = in.peek();
+        if (c == '#') {
+            std::string comment;
+            std::getline(in, comment);
+        } else if (c == ' ' || c == '\t' || c == '\n' || c == '\r') {
+            in.get();
+        } else {
+            break;
+        }
+    }
+
+    return static_cast<bool>(in >> value);
+}
+
+}
+
+bool readPPM(const std::string& path, size_t& width, size_t& height, std::vector<unsigned char>& rgb)
+{
+    std::ifstream ifs(path, std::ios::binary | std::ios::in);
+    if (!ifs)
+        return false;
+
+    std::string magic;
+    size_t maxValue;
+    if (!(ifs >> magic) || magic != "P6"
+            || !readHeaderValue(ifs, width) || !readHeaderValue(ifs, height)
+            || !readHeaderValue(ifs, maxValue) || maxValue != 255)
+        return false;
+
+    //za maximalni hodnotou nasleduje prave jeden bily znak
+    ifs.get();
+
+    //rozmery z hlavicky se overi proti velikosti souboru, nez se podle nich alokuje
+    const std::streampos data = ifs.tellg();
+    if (!ifs.seekg(0, std::ios::end))
+        return false;
+    const size_t available = static_cast<size_t>(ifs.tellg() - data);
+    if (height > 0 && width > available / 3 / height)
+        return false;
+    ifs.seekg(data);
+
+    rgb.resize(width * height * 3);
+    ifs.read(reinterpret_cast<char*>(rgb.data()), rgb.size());
+
+    return static_cast<size_t>(ifs.gcount()) == rgb.size();
+}
+
+bool compareImages(const std::string& path, const std::string& reference, ImageDifference& diff,
+                   std::string& error)
+{
+    size_t width, height, refWidth, refHeight;
+    std::vector<unsigned char> image, expected;
+
+    if (!readPPM(path, width, height, image)) {
+        error = "nelze nacist " + path;
+        return false;
+    }
+    if (!readPPM(reference, refWidth, refHeight, expected)) {
+        error = "nelze nacist referencni obrazek " + reference;
+        return false;
+    }
+    if (width != refWidth || height != refHeight) {
+        error = "obrazek a reference maji ruzne rozmery";
+        return false;
+    }
+
+    double sum = 0.0;
+    int maxDelta = 0;
+    size_t differing = 0;
+    for (size_t i = 0; i < image.size(); i += 3) {
+        int pixelDelta = 0;
+        for (size_t c = 0; c < 3; ++c) {
+            const int delta = std::abs(static_cast<int>(image[i + c]) - static_cast<int>(expected[i + c]));
+            sum += static_cast<double>(delta) * delta;
+            pixelDelta = std::max(pixelDelta, delta);
+        }
+
+        maxDelta = std::max(maxDelta, pixelDelta);
+        if (pixelDelta > IMAGE_VISIBLE_DIFFERENCE)
+            ++differing;
+    }
+
+    const size_t pixels = width * height;
+    diff.rmse = pixels > 0 ? std::sqrt(sum / (3.0 * pixels)) / 255.0 : 0.0;
+    diff.maxError = maxDelta / 255.0;
+    diff.differing = pixels > 0 ? static_cast<double>(differing) / pixels : 0.0;
+
+    return true;
+}
+
+bool loadPerfBaseline(const std::string& path, double& raysPerSecond)
+{
+    std::ifstream ifs(path);
+    std::string key;
+    if (!(ifs >> key >> raysPerSecond) || key != "rays_per_second")
+        return false;
+
+    return raysPerSecond > 0.0;
+}
+
+bool savePerfBaseline(const std::string& path, double raysPerSecond)
+{
+    std::ofstream ofs(path);
+    ofs << "rays_per_second " << raysPerSecond << "\n";
+
+    return ofs.good();
+}
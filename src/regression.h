@@ -0,0 +1,65 @@
+#ifndef REGRESSION_H
+#define REGRESSION_H
+
+/*!
+ * \file
+ * Kontrola regresi: porovnani vystupu s referencnim obrazkem a vykonu
+ * s ulozenou zakladni hodnotou paprsku za sekundu.\n
+ * Obrazky se porovnavaji v 8bitovem sRGB, tj. presne v tom, co uzivatel
+ * vidi. RMSE je pocitana z hodnot v intervalu [0, 1] pres vsechny kanaly.
+ */
+
+#include <string>
+#include <vector>
+
+/*!
+ * Vysledek porovnani dvou obrazku.
+ */
+struct ImageDifference {
+    ImageDifference()
+        : rmse(0.0), maxError(0.0), differing(0.0)
+    {}
+
+    double rmse; ///< odmocnina stredni kvadraticke chyby, hodnoty v [0, 1]
+    double maxError; ///< nejvetsi rozdil jednoho kanalu, hodnoty v [0, 1]
+    double differing; ///< podil pixelu s viditelnym rozdilem (vice nez IMAGE_VISIBLE_DIFFERENCE)
+};
+
+const int IMAGE_VISIBLE_DIFFERENCE = 2; ///< rozdil kanalu v 8bitovych hodnotach, ktery se uz pocita jako viditelny
+
+/*!
+ * \brief Nacte obrazek PPM (P6, 8 bitu na kanal).
+ * \param path cesta k souboru
+ * \param [out] width sirka obrazku
+ * \param [out] height vyska obrazku
+ * \param [out] rgb hodnoty po radcich shora, tri na pixel
+ * \return true pri uspechu
+ */
+bool readPPM(const std::string& path, size_t& width, size_t& height, std::vector<unsigned char>& rgb);
+
+/*!
+ * \brief Porovna dva obrazky PPM.
+ * \param path testovany obrazek
+ * \param reference referencni obrazek
+ * \param [out] diff rozdil obrazku
+ * \param [out] error popis chyby (nelze nacist, ruzne rozmery)
+ * \return false pokud obrazky nelze porovnat
+ */
+bool compareImages(const std::string& path, const std::string& reference, ImageDifference& diff,
+                   std::string& error);
+
+/*!
+ * \brief Nacte zakladni hodnotu vykonu (textovy soubor "rays_per_second <hodnota>").
+ * \param path cesta k souboru
+ * \param [out] raysPerSecond ulozena hodnota
+ * \return false pokud soubor neexistuje nebo je neplatny
+ */
+bool loadPerfBaseline(const std::string& path, double& raysPerSecond);
+
+/*!
+ * \brief Ulozi zakladni hodnotu vykonu.
+ * \return true pri uspechu
+ */
+bool savePerfBaseline(const std::string& path, double raysPerSecond);
+
+#endif // REGRESSION_H
@@ -0,0 +1,84 @@
+#ifndef RNG_H
+#define RNG_H
+
+/*!
+ * \file
+ * Generator nahodnych cisel zalozeny na citaci (Philox4x32-10).\n
+ * Hodnota je cista funkce trojice (pixel, vzorek, dimenze) a seminka, takze
+ * vysledny obrazek nezavisi na poctu vlaken ani na poradi dlazdic. Generator
+ * nema zadny sdileny stav a lze ho vytvaret levne pro kazdy vzorek.
+ */
+
+#include <cstdint>
+
+/*!
+ * Generator nahodnych cisel pro jeden vzorek jednoho pixelu.
+ */
+class SampleRNG
+{
+public:
+    /*!
+     * \brief Konstruktor.
+     * \param pixel index pixelu na filmu
+     * \param sample index vzorku v pixelu
+     * \param seed seminko cele sekvence
+     */
+    SampleRNG(uint64_t pixel, uint32_t sample, uint32_t seed = 0)
+        : pixel(pixel), sample(sample), seed(seed)
+    {}
+
+    /*!
+     * \brief Nahodne 32bitove cislo pro danou dimenzi.
+     * \param dimension index dimenze (napr. 0 a 1 pro polohu v pixelu)
+     */
+    uint32_t bits(uint32_t dimension) const
+    {
+        uint32_t ctr[4] = {
+            static_cast<uint32_t>(pixel),
+            static_cast<uint32_t>(pixel >> 32),
+            sample,
+            dimension >> 2
+        };
+        uint32_t key[2] = { seed, 0x5eed1234u };
+
+        for (int round = 0; round < 10; ++round) {
+            philoxRound(ctr, key);
+            key[0] += 0x9e3779b9u;
+            key[1] += 0xbb67ae85u;
+        }
+
+        return ctr[dimension & 3];
+    }
+
+    /*!
+     * \brief Rovnomerne rozdelene cislo v intervalu [0, 1) pro danou dimenzi.
+     * \param dimension index dimenze
+     */
+    float uniform(uint32_t dimension) const
+    {
+        //24 bitu mantisy, vysledek je vzdy ostre mensi nez 1
+        return (bits(dimension) >> 8) * (1.f / 16777216.f);
+    }
+
+private:
+    static void philoxRound(uint32_t ctr[4], const uint32_t key[2])
+    {
+        const uint64_t p0 = static_cast<uint64_t>(0xd2511f53u) * ctr[0];
+        const uint64_t p1 = static_cast<uint64_t>(0xcd9e8d57u) * ctr[2];
+
+        const uint32_t hi0 = static_cast<uint32_t>(p0 >> 32), lo0 = static_cast<uint32_t>(p0);
+        const uint32_t hi1 = static_cast<uint32_t>(p1 >> 32), lo1 = static_cast<uint32_t>(p1);
+
+        ctr[0] = hi1 ^ ctr[1] ^ key[0];
+        ctr[1] = lo1;
+        ctr[2] = hi0 ^ ctr[3] ^ key[1];
+        ctr[3] = lo0;
+    }
+
+private:
+    uint64_t pixel;
+    uint32_t sample;
+    uint32_t seed;
+};
+
+#endif // RNG_H
@@ -0,0 +1,90 @@
+#include "scene.h"
+
+#include "intersection.h"
+
+Scene::Scene()
+{}
+
+void Scene::addLight(const std::shared_ptr<Light>& light)
+{
+    lights.push_back(light);
+}
+
+std::shared_ptr<Instance> Scene::addObject(const std::shared_ptr<Primitive>& object,
+                                           const Transform& objectToWorld)
+{
+    std::shared_ptr<Instance> instance = std::make_shared<Instance>(object, objectToWorld);
+    instances.push_back(instance);
+
+    //nova instance v horni urovni chybi, musi se postavit znovu
+    topLevel.reset();
+
+    return instance;
+}
+
+void Scene::buildTopLevel()
+{
+    if (topLevel) {
+        topLevel->rebuild();
+        return;
+    }
+
+    std::vector<std::shared_ptr<Primitive> > primitives(instances.begin(), instances.end());
+    topLevel.reset(new BVHAccel(primitives));
+}
+
+bool Scene::intersect(const Ray& ray, Intersection& inter) const
+{
+    if (!topLevel)
+        return false;
+
+    topLevel->intersect(ray, inter);
+    return inter.hitObject;
+}
+
+bool Scene::intersectP(const Ray& ray) const
+{
+    return topLevel && topLevel->intersectP(TraversalRay(ray));
+}
+
+uint64_t Scene::intersectP(const ShadowPacket& packet, uint64_t active) const
+{
+    return topLevel ? topLevel->intersectPacketP(packet, active) : 0;
+}
+
+BBox Scene::worldBound() const
+{
+    return topLevel ? topLevel->worldBound() : BBox();
+}
+
+size_t Scene::memoryUsage() const
+{
+    size_t memory = sizeof(*this);
+    for (size_t i = 0; i < instances.size(); ++i)
+        memory += instances[i]->memoryUsage();
+
+    if (topLevel)
+        memory += topLevel->memoryUsage();
+
+    return memory;
+}
+
+const std::vector<std::shared_ptr<Light> >& Scene::getLights() const
+{
+    return lights;
+}
+
+const std::vector<std::shared_ptr<Instance> >& Scene::getInstances() const
+{
+    return instances;
+}
+
+void Scene::setBackground(const RGBColor& color)
+{
+    background = color;
+}
+
+const RGBColor& Scene::getBackground() const
+{
+    return background;
+}
@@ -0,0 +1,93 @@
+#ifndef SCENE_H
+#define SCENE_H
+
+/*!
+ * \file
+ * Scena jako dvouurovnova akceleracni struktura.\n
+ * Kazdy objekt ma vlastni spodni uroven (napr. BVH nad koulemi v SphereSet),
+ * ktera se stavi jen jednou. Objekty jsou do sceny vlozeny jako instance
+ * s transformaci a nad jejich obalovymi kvadry se stavi horni uroven. Pohyb
+ * objektu tak vyzaduje jen zmenu transformace a prestavbu horni urovne.
+ */
+
+#include <memory>
+#include <vector>
+
+#include "core.h"
+
+#include "accelerator.h"
+#include "color.h"
+#include "light.h"
+#include "primitive.h"
+#include "transform.h"
+
+/*!
+ * Scena: svetla, instance objektu a horni uroven akceleracni struktury.
+ */
+class Scene
+{
+public:
+    Scene();
+
+    /*!
+     * \brief Prida svetlo.
+     */
+    void addLight(const std::shared_ptr<Light>& light);
+
+    /*!
+     * \brief Vlozi objekt do sceny jako novou instanci.
+     * \param object objekt s vlastni spodni urovni
+     * \param objectToWorld umisteni objektu ve scene
+     * \return vytvorena instance, pres kterou lze objekt pozdeji presunout
+     */
+    std::shared_ptr<Instance> addObject(const std::shared_ptr<Primitive>& object,
+                                        const Transform& objectToWorld = Transform());
+
+    /*!
+     * \brief Postavi (znovu) horni uroven nad aktualnimi polohami instanci.
+     * Je nutne ji zavolat po pridani objektu i po kazdem presunu instance.
+     */
+    void buildTopLevel();
+
+    /*!
+     * \brief Najde nejblizsi prusecik paprsku s objekty ve scene.
+     * \param [in]  ray paprsek
+     * \param [out] inter objekt do ktereho se ukladaji data o pruseciku
+     */
+    bool intersect(const Ray& ray, Intersection& inter) const;
+
+    /*!
+     * \brief Zjednodusena verze intersect() pro vypocet stinu.
+     */
+    bool intersectP(const Ray& ray) const;
+
+    /*!
+     * \brief Test zakryti pro svazek stinovych paprsku.
+     * \return maska zakrytych paprsku z active
+     */
+    uint64_t intersectP(const ShadowPacket& packet, uint64_t active) const;
+
+    /*!
+     * \brief Obalovy kvadr vsech instanci (platny po buildTopLevel()).
+     */
+    BBox worldBound() const;
+
+    /*!
+     * \brief Odhad pameti obsazene objekty a akceleracnimi strukturami.
+     */
+    size_t memoryUsage() const;
+
+    const std::vector<std::shared_ptr<Light> >& getLights() const;
+    const std::vector<std::shared_ptr<Instance> >& getInstances() const;
+
+    void setBackground(const RGBColor& color);
+    const RGBColor& getBackground() const;
+
+private:
+    std::vector<std::shared_ptr<Light> > lights; ///< buffer svetel
+    std::vector<std::shared_ptr<Instance> > instances; ///< instance objektu
+    std::unique_ptr<BVHAccel> topLevel; ///< horni uroven nad instancemi
+    RGBColor background; ///< pozadi obrazku
+};
+
+#endif // SCENE_H
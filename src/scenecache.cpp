@@ -0,0 +1,89 @@
+#include "scenecache.h"
+
+SceneCache::SceneCache(const Loader& loader, size_t limit)
+    : loader(loader), memoryLimit(limit), memory(0), hitCount(0), missCount(0), reloadCount(0)
+{}
+
+const CachedScene* SceneCache::acquire(const std::string& path, bool& hit)
+{
+    //otisk se zjisti pred nactenim, soubor prepsany behem nacitani se pozna priste
+    const FileStamp stamp = path.empty() ? FileStamp() : fileStamp(path);
+
+    auto it = index.find(path);
+    if (it != index.end()) {
+        if (it->second->second.stamp == stamp) {
+            hit = true;
+            ++hitCount;
+            entries.splice(entries.begin(), entries, it->second);
+            return &entries.front().second;
+        }
+
+        ++reloadCount;
+        memory -= it->second->second.memory;
+        entries.erase(it->second);
+        index.erase(it);
+    }
+
+    hit = false;
+    ++missCount;
+
+    CachedScene entry;
+    entry.memory = 0;
+    entry.stamp = stamp;
+    if (!loader(path, entry))
+        return 0;
+
+    entries.push_front(std::make_pair(path, entry));
+    index[path] = entries.begin();
+    memory += entry.memory;
+
+    evict();
+
+    return &entries.front().second;
+}
+
+void SceneCache::evict()
+{
+    while (memory > memoryLimit && entries.size() > 1) {
+        memory -= entries.back().second.memory;
+        index.erase(entries.back().first);
+        entries.pop_back();
+    }
+}
+
+void SceneCache::clear()
+{
+    entries.clear();
+    index.clear();
+    memory = 0;
+}
+
+size_t SceneCache::sceneCount() const
+{
+    return entries.size();
+}
+
+size_t SceneCache::memoryUsage() const
+{
+    return memory;
+}
+
+size_t SceneCache::limit() const
+{
+    return memoryLimit;
+}
+
+size_t SceneCache::hits() const
+{
+    return hitCount;
+}
+
+size_t SceneCache::misses() const
+{
+    return missCount;
+}
+
+size_t SceneCache::reloads() const
+{
+    return reloadCount;
+}
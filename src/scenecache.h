@@ -0,0 +1,89 @@
+#ifndef SCENECACHE_H
+#define SCENECACHE_H
+
+/*!
+ * \file
+ * Pamet sestavenych scen pro rezim serveru.\n
+ * Scena vcetne akceleracnich struktur a namapovaneho souboru geometrie
+ * zustava mezi ulohami v pameti, takze opakovany render stejne sceny
+ * preskoci celou pripravu. Pri prekroceni limitu se uvolnuji nejdele
+ * nepouzite sceny. Scena, jejiz soubor byl od nacteni prepsan (zmenila se
+ * velikost nebo cas posledni zmeny), se sestavi znovu.
+ */
+
+#include <cstddef>
+#include <functional>
+#include <list>
+#include <map>
+#include <memory>
+#include <string>
+
+#include "geometryfile.h"
+#include "scene.h"
+
+/*!
+ * Sestavena scena spolu se souborem geometrie, na ktery odkazuje.
+ */
+struct CachedScene {
+    std::shared_ptr<Scene> scene;
+    std::shared_ptr<GeometryFile> geometry; ///< muze byt prazdny (vychozi scena)
+    size_t memory; ///< odhad obsazene pameti v bajtech
+    FileStamp stamp; ///< soubor geometrie v dobe nacteni
+};
+
+/*!
+ * LRU pamet scen s limitem velikosti.
+ */
+class SceneCache
+{
+public:
+    /*!
+     * Funkce, ktera sestavi scenu ze souboru; vraci false pri chybe.
+     */
+    typedef std::function<bool(const std::string& path, CachedScene& entry)> Loader;
+
+    /*!
+     * \brief Konstruktor.
+     * \param loader funkce sestavujici scenu
+     * \param limit nejvetsi soucet pameti drzenych scen v bajtech
+     */
+    SceneCache(const Loader& loader, size_t limit);
+
+    /*!
+     * \brief Vrati scenu z pameti, nebo ji sestavi.
+     * Posledni pouzita scena se neuvolni, i kdyby sama prekrocila limit.
+     * \param path cesta k souboru geometrie (prazdna = vychozi scena)
+     * \param [out] hit true pokud scena uz byla v pameti a jeji soubor se nezmenil
+     * \return scena, nebo 0 pokud ji nelze sestavit
+     */
+    const CachedScene* acquire(const std::string& path, bool& hit);
+
+    /*!
+     * \brief Uvolni vsechny sceny.
+     */
+    void clear();
+
+    size_t sceneCount() const;
+    size_t memoryUsage() const;
+    size_t limit() const;
+    size_t hits() const;
+    size_t misses() const;
+    size_t reloads() const; ///< pocet scen sestavenych znovu po zmene souboru
+
+private:
+    void evict();
+
+private:
+    typedef std::list<std::pair<std::string, CachedScene> > EntryList;
+
+    Loader loader;
+    size_t memoryLimit;
+    size_t memory; ///< soucet pameti drzenych scen
+    size_t hitCount;
+    size_t missCount;
+    size_t reloadCount;
+    EntryList entries; ///< od posledne pouzite
+    std::map<std::string, EntryList::iterator> index;
+};
+
+#endif // SCENECACHE_H
@@ -0,0 +1,225 @@
+#include "server.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace {
+
+bool parseVector(const std::string& value, float out[3])
+{
+    return sscanf(value.c_str(), "%f,%f,%f", &out[0], &out[1], &out[2]) == 3;
+}
+
+/*!
+ * \brief Smaze soubor socketu, pokud existuje.
+ * \param path cesta k socketu
+ * \return false pokud na ceste lezi jiny soubor nez socket (ten zustane)
+ */
+bool removeSocket(const std::string& path)
+{
+    struct stat st;
+    if (lstat(path.c_str(), &st) != 0)
+        return true;
+    if (!S_ISSOCK(st.st_mode))
+        return false;
+
+    unlink(path.c_str());
+    return true;
+}
+
+/*!
+ * \brief Proud nad spojenim socketu, cte a zapisuje primo deskriptor.
+ */
+class SocketBuffer : public std::streambuf
+{
+public:
+    explicit SocketBuffer(int fd)
+        : fd(fd)
+    {
+        setg(input, input, input);
+    }
+
+protected:
+    virtual int_type underflow()
+    {
+        const ssize_t n = ::read(fd, input, sizeof(input));
+        if (n <= 0)
+            return traits_type::eof();
+
+        setg(input, input, input + n);
+        return traits_type::to_int_type(input[0]);
+    }
+
+    virtual std::streamsize xsputn(const char* s, std::streamsize count)
+    {
+        std::streamsize written = 0;
+        while (written < count) {
+            //odpojeny klient nesmi server ukoncit signalem SIGPIPE
+            const ssize_t n = ::send(fd, s + written, count - written, MSG_NOSIGNAL);
+            if (n <= 0)
+                break;
+            written += n;
+        }
+        return written;
+    }
+
+    virtual int_type overflow(int_type c)
+    {
+        if (traits_type::eq_int_type(c, traits_type::eof()))
+            return traits_type::not_eof(c);
+
+        const char ch = traits_type::to_char_type(c);
+        return xsputn(&ch, 1) == 1 ? c : traits_type::eof();
+    }
+
+private:
+    int fd;
+    char input[4096];
+};
+
+}
+
+RenderJob::RenderJob()
+    : width(800), height(800), eye(5.f, 5.f, 5.f), target(0.f, 0.f, 0.f), up(0.f, 1.f, 0.f),
+      fov(0.f), spp(0)
+{}
+
+bool parseJob(const std::string& line, RenderJob& job, std::string& error)
+{
+    std::istringstream in(line);
+    std::string token;
+
+    while (in >> token) {
+        const size_t eq = token.find('=');
+        if (eq == std::string::npos) {
+            error = "ocekavano klic=hodnota: " + token;
+            return false;
+        }
+
+        const std::string key = token.substr(0, eq);
+        const std::string value = token.substr(eq + 1);
+        float v[3];
+
+        if (key == "scene") {
+            job.scene = value;
+        } else if (key == "output") {
+            job.output = value;
+        } else if (key == "width") {
+            job.width = strtoul(value.c_str(), 0, 10);
+        } else if (key == "height") {
+            job.height = strtoul(value.c_str(), 0, 10);
+        } else if (key == "eye" && parseVector(value, v)) {
+            job.eye = Point(v[0], v[1], v[2]);
+        } else if (key == "target" && parseVector(value, v)) {
+            job.target = Point(v[0], v[1], v[2]);
+        } else if (key == "up" && parseVector(value, v)) {
+            job.up = Vector(v[0], v[1], v[2]);
+        } else if (key == "fov") {
+            job.fov = static_cast<float>(atof(value.c_str()));
+        } else if (key == "spp") {
+            job.spp = strtoul(value.c_str(), 0, 10);
+        } else {
+            error = "neplatny parametr: " + token;
+            return false;
+        }
+    }
+
+    if (job.output.empty()) {
+        error = "chybi output";
+        return false;
+    }
+    //zaporne hodnoty projdou strtoul jako obrovska cisla
+    if (job.width == 0 || job.height == 0 || job.width > RENDER_JOB_MAX_SIZE ||
+        job.height > RENDER_JOB_MAX_SIZE) {
+        error = "neplatne rozliseni";
+        return false;
+    }
+    if (job.fov < 0.f || job.fov >= 180.f) {
+        error = "neplatny zorny uhel";
+        return false;
+    }
+
+    return true;
+}
+
+bool serveStream(std::istream& in, std::ostream& out, const CommandHandler& handler)
+{
+    std::string line;
+    while (std::getline(in, line)) {
+        std::istringstream tokens(line);
+        std::string command;
+        if (!(tokens >> command) || command[0] == '#')
+            continue;
+
+        if (command == "quit") {
+            out << "ok bye" << std::endl;
+            return true;
+        }
+
+        std::string arguments;
+        std::getline(tokens, arguments);
+        out << handler(command, arguments) << std::endl;
+    }
+
+    return false;
+}
+
+bool serveSocket(const std::string& path, const CommandHandler& handler)
+{
+    sockaddr_un address;
+    if (path.size() >= sizeof(address.sun_path)) {
+        std::cerr << "Cesta k socketu je prilis dlouha" << std::endl;
+        return false;
+    }
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        perror("socket");
+        return false;
+    }
+
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+
+    //po predchozim behu muze zustat stary socket, jiny soubor se nemaze
+    if (!removeSocket(path)) {
+        std::cerr << "Soubor " << path << " existuje a neni socket" << std::endl;
+        close(fd);
+        return false;
+    }
+
+    if (bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || listen(fd, 4) != 0) {
+        perror("bind");
+        close(fd);
+        return false;
+    }
+
+    std::cout << "Listening on: " << path << std::endl;
+
+    bool quit = false;
+    while (!quit) {
+        int client = accept(fd, 0, 0);
+        if (client < 0) {
+            perror("accept");
+            break;
+        }
+
+        SocketBuffer buffer(client);
+        std::iostream stream(&buffer);
+        quit = serveStream(stream, stream, handler);
+
+        close(client);
+    }
+
+    close(fd);
+    removeSocket(path);
+    return true;
+}
@@ -0,0 +1,79 @@
+#ifndef SERVER_H
+#define SERVER_H
+
+/*!
+ * \file
+ * Rezim serveru: ulohy se ctou po radcich ze standardniho vstupu nebo
+ * z Unix socketu a na kazdou se odpovi jednim radkem.
+ *
+ * \code
+ * render scene=<soubor.geom> output=<obrazek.ppm> [width=<n>] [height=<n>]
+ *        [eye=<x,y,z>] [target=<x,y,z>] [up=<x,y,z>] [fov=<stupne>] [spp=<n>]
+ * stats
+ * quit
+ * \endcode
+ *
+ * Odpoved zacina slovem "ok" nebo "error", za nim nasleduji dvojice klic=hodnota.
+ */
+
+#include <functional>
+#include <iostream>
+#include <string>
+
+#include "geometry.h"
+
+/*!
+ * Nejvetsi sirka i vyska obrazku ulohy; film vetsiho rozliseni by se nemusel vejit do pameti.
+ */
+const size_t RENDER_JOB_MAX_SIZE = 8192;
+
+/*!
+ * Jedna uloha renderu.
+ */
+struct RenderJob {
+    RenderJob();
+
+    std::string scene; ///< soubor geometrie (prazdny = vychozi scena)
+    std::string output; ///< cesta k vystupnimu obrazku
+    size_t width, height; ///< rozliseni
+    Point eye; ///< poloha kamery
+    Point target; ///< cil pohledu
+    Vector up; ///< natoceni kamery
+    float fov; ///< vodorovny zorny uhel ve stupnich (0 = vychozi)
+    unsigned int spp; ///< pocet vzorku na pixel (0 = podle prikazove radky)
+};
+
+/*!
+ * \brief Zpracuje radek s ulohou "render".
+ * \param line radek bez uvodniho slova "render"
+ * \param [out] job vysledna uloha
+ * \param [out] error popis chyby
+ * \return false pokud uloha neni platna
+ */
+bool parseJob(const std::string& line, RenderJob& job, std::string& error);
+
+/*!
+ * Funkce, ktera provede prikaz (radek zacinajici "render" nebo "stats")
+ * a vrati radek odpovedi bez znaku konce radku.
+ */
+typedef std::function<std::string(const std::string& command, const std::string& arguments)> CommandHandler;
+
+/*!
+ * \brief Cte prikazy z proudu, dokud neprijde konec vstupu nebo "quit".
+ * \param in vstup
+ * \param out proud pro odpovedi
+ * \param handler obsluha prikazu
+ * \return true pokud prisel prikaz "quit"
+ */
+bool serveStream(std::istream& in, std::ostream& out, const CommandHandler& handler);
+
+/*!
+ * \brief Prijima spojeni na Unix socketu a obsluhuje je jedno po druhem.
+ * Konci prikazem "quit" nebo chybou socketu.
+ * \param path cesta k socketu (existujici socket se prepise, jiny soubor ne)
+ * \param handler obsluha prikazu
+ * \return false pokud socket nelze vytvorit
+ */
+bool serveSocket(const std::string& path, const CommandHandler& handler);
+
+#endif // SERVER_H
@@ -0,0 +1,141 @@
+#include "simd.h"
+
+#include <cstring>
+
+#include "packet.h"
+
+namespace {
+
+uint64_t packetBox(const ShadowPacket& p, const float* pMin, const float* pMax, uint64_t active)
+{
+    uint64_t hit = 0;
+    for (uint64_t m = active; m != 0; m &= m - 1) {
+        const int i = __builtin_ctzll(m);
+        float t0 = 0.f, t1 = p.maxt[i];
+        for (int a = 0; a < 3; ++a) {
+            float tNear = (pMin[a] - p.o[a][i]) * p.invDir[a][i];
+            float tFar = (pMax[a] - p.o[a][i]) * p.invDir[a][i];
+            if (tNear > tFar)
+                std::swap(tNear, tFar);
+
+            t0 = tNear > t0 ? tNear : t0;
+            t1 = tFar < t1 ? tFar : t1;
+        }
+        hit |= static_cast<uint64_t>(t0 <= t1) << i;
+    }
+
+    return hit;
+}
+
+uint64_t packetSphere(const ShadowPacket& p, const float* center, float radius, uint64_t active)
+{
+    const Point c(center[0], center[1], center[2]);
+
+    uint64_t occluded = 0;
+    for (uint64_t m = active; m != 0; m &= m - 1) {
+        const int i = __builtin_ctzll(m);
+
+        const Vector d(p.d[0][i], p.d[1][i], p.d[2][i]);
+        Vector temp = Point(p.o[0][i], p.o[1][i], p.o[2][i]) - c;
+        float a = dot(d, d);
+        float b = 2 * dot(temp, d);
+        float cc = dot(temp, temp) - radius * radius;
+
+        float t1, t2;
+        if (solveQuadratic(a, b, cc, &t1, &t2)) {
+            const float t = std::min(t1, t2);
+            if (t > EPSILON && t < p.maxt[i])
+                occluded |= uint64_t(1) << i;
+        }
+    }
+
+    return occluded;
+}
+
+size_t toneMap(const float*, unsigned char*, size_t, float, int, const unsigned char*, int)
+{
+    //vse zpracuje skalarni kod volajiciho
+    return 0;
+}
+
+const SimdKernels* const KERNELS[SIMD_ISA_COUNT] = {
+    &SIMD_KERNELS_SCALAR,
+    &SIMD_KERNELS_SSE2,
+    &SIMD_KERNELS_AVX2,
+    &SIMD_KERNELS_AVX512
+};
+
+}
+
+const SimdKernels SIMD_KERNELS_SCALAR = { "scalar", packetBox, packetSphere, toneMap };
+
+const SimdKernels* simdActive = &SIMD_KERNELS_SCALAR;
+
+SimdIsa detectSimdIsa()
+{
+    for (int isa = SIMD_ISA_COUNT - 1; isa > SIMD_SCALAR; --isa) {
+        if (simdIsaSupported(static_cast<SimdIsa>(isa)))
+            return static_cast<SimdIsa>(isa);
+    }
+
+    return SIMD_SCALAR;
+}
+
+bool simdIsaSupported(SimdIsa isa)
+{
+    if (isa < 0 || isa >= SIMD_ISA_COUNT || !KERNELS[isa]->packetBox)
+        return false;
+
+#if defined(__x86_64__) || defined(__i386__)
+    //__builtin_cpu_supports overuje i to, ze system uklada registry AVX pri prepnuti vlakna
+    __builtin_cpu_init();
+    switch (isa) {
+    case SIMD_SSE2:
+        return __builtin_cpu_supports("sse2");
+    case SIMD_AVX2:
+        return __builtin_cpu_supports("avx2");
+    case SIMD_AVX512:
+        return __builtin_cpu_supports("avx512f");
+    default:
+        break;
+    }
+#endif
+
+    return isa == SIMD_SCALAR;
+}
+
+bool selectSimdIsa(SimdIsa isa)
+{
+    if (!simdIsaSupported(isa))
+        return false;
+
+    simdActive = KERNELS[isa];
+    return true;
+}
+
+SimdIsa activeSimdIsa()
+{
+    for (int isa = 0; isa < SIMD_ISA_COUNT; ++isa) {
+        if (KERNELS[isa] == simdActive)
+            return static_cast<SimdIsa>(isa);
+    }
+
+    return SIMD_SCALAR;
+}
+
+const char* simdIsaName(SimdIsa isa)
+{
+    return isa >= 0 && isa < SIMD_ISA_COUNT ? KERNELS[isa]->name : "unknown";
+}
+
+bool parseSimdIsa(const char* name, SimdIsa& isa)
+{
+    for (int i = 0; i < SIMD_ISA_COUNT; ++i) {
+        if (strcmp(name, KERNELS[i]->name) == 0) {
+            isa = static_cast<SimdIsa>(i);
+            return true;
+        }
+    }
+
+    return false;
+}
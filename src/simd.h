@@ -0,0 +1,110 @@
+#ifndef SIMD_H
+#define SIMD_H
+
+/*!
+ * \file
+ * Vyber SIMD variant nejvytizenejsich jader za behu programu.\n
+ * Kazda varianta je v samostatnem souboru prekladanem s vlastnimi prepinaci
+ * (simdsse2.cpp, simdavx2.cpp, simdavx512.cpp), zbytek programu se preklada
+ * bez architekturnich prepinacu a bezi i na starsich procesorech. Pri startu
+ * se podle cpuid vybere nejsirsi varianta, kterou procesor i system podporuji.
+ *
+ * Vsechny varianty davaji bitove stejne vysledky jako skalarni kod: pouzivaji
+ * stejne poradi operaci a prekladaji se s -ffp-contract=off.
+ *
+ * Soubory variant nesmi volat inline funkce ze spolecnych hlavicek, linker
+ * by mohl jejich kopii prelozenou pro AVX pouzit i ve zbytku programu.
+ */
+
+#include <cstddef>
+#include <cstdint>
+
+struct ShadowPacket;
+
+/*!
+ * Instrukcni sady, pro ktere existuje varianta jader.
+ */
+enum SimdIsa {
+    SIMD_SCALAR, ///< prenositelny kod bez intrinsik
+    SIMD_SSE2, ///< 4 paprsky najednou (zaklad x86-64)
+    SIMD_AVX2, ///< 8 paprsku najednou
+    SIMD_AVX512, ///< 16 paprsku najednou (AVX-512F)
+    SIMD_ISA_COUNT
+};
+
+/*!
+ * Tabulka jader jedne varianty. Varianta, kterou prekladac neumi, ma
+ * vsechna jadra nulova.
+ */
+struct SimdKernels {
+    const char* name; ///< nazev varianty
+
+    /*!
+     * \brief Test kvadru pro vsechny paprsky svazku (metoda slabu).
+     * \return maska paprsku z active, ktere kvadr protnou
+     */
+    uint64_t (*packetBox)(const ShadowPacket& packet, const float* pMin, const float* pMax, uint64_t active);
+
+    /*!
+     * \brief Test koule pro vsechny paprsky svazku (jako Sphere::intersectP).
+     * \return maska paprsku z active, ktere koule zakryje
+     */
+    uint64_t (*packetSphere)(const ShadowPacket& packet, const float* center, float radius, uint64_t active);
+
+    /*!
+     * \brief Tonova krivka a kodovani pres tabulku (viz ToneMapper::map).
+     * \param curve ToneCurve
+     * \return pocet zpracovanych hodnot od zacatku, zbytek zpracuje volajici
+     */
+    size_t (*toneMap)(const float* in, unsigned char* out, size_t count, float scale, int curve,
+                      const unsigned char* lut, int lutSize);
+};
+
+extern const SimdKernels SIMD_KERNELS_SCALAR; ///< simd.cpp
+extern const SimdKernels SIMD_KERNELS_SSE2; ///< simdsse2.cpp
+extern const SimdKernels SIMD_KERNELS_AVX2; ///< simdavx2.cpp
+extern const SimdKernels SIMD_KERNELS_AVX512; ///< simdavx512.cpp
+
+extern const SimdKernels* simdActive; ///< prave vybrana varianta
+
+/*!
+ * \brief Jadra vybrane varianty.
+ */
+inline const SimdKernels& simdKernels()
+{
+    return *simdActive;
+}
+
+/*!
+ * \brief Nejsirsi varianta, kterou procesor, system i prekladac podporuji.
+ */
+SimdIsa detectSimdIsa();
+
+/*!
+ * \brief Lze variantu na tomto procesoru pouzit?
+ */
+bool simdIsaSupported(SimdIsa isa);
+
+/*!
+ * \brief Vybere variantu jader.
+ * \return false pokud ji procesor nebo prekladac nepodporuje
+ */
+bool selectSimdIsa(SimdIsa isa);
+
+/*!
+ * \brief Prave vybrana varianta.
+ */
+SimdIsa activeSimdIsa();
+
+/*!
+ * \brief Nazev varianty (scalar, sse2, avx2, avx512).
+ */
+const char* simdIsaName(SimdIsa isa);
+
+/*!
+ * \brief Prevede nazev na variantu.
+ * \return false pro neznamy nazev
+ */
+bool parseSimdIsa(const char* name, SimdIsa& isa);
+
+#endif // SIMD_H
@@ -0,0 +1,147 @@
+/*!
+ * \file
+ * Varianta jader pro AVX2, osm paprsku najednou (viz simd.h).
+ */
+
+#include "simd.h"
+
+#include "packet.h"
+#include "tonemap.h"
+
+#ifdef __AVX2__
+
+#include <immintrin.h>
+
+namespace {
+
+inline __m256 blend(__m256 a, __m256 b, __m256 mask)
+{
+    return _mm256_blendv_ps(a, b, mask);
+}
+
+uint64_t packetBox(const ShadowPacket& p, const float* pMin, const float* pMax, uint64_t active)
+{
+    uint64_t hit = 0;
+    for (size_t base = 0; base < p.count; base += 8) {
+        if (((active >> base) & 0xff) == 0)
+            continue;
+
+        __m256 t0 = _mm256_setzero_ps();
+        __m256 t1 = _mm256_loadu_ps(p.maxt + base);
+        for (int a = 0; a < 3; ++a) {
+            const __m256 o = _mm256_loadu_ps(p.o[a] + base);
+            const __m256 inv = _mm256_loadu_ps(p.invDir[a] + base);
+            const __m256 tNear = _mm256_mul_ps(_mm256_sub_ps(_mm256_set1_ps(pMin[a]), o), inv);
+            const __m256 tFar = _mm256_mul_ps(_mm256_sub_ps(_mm256_set1_ps(pMax[a]), o), inv);
+
+            //poradi operandu min/max odpovida skalarni vymene a porovnani i pro NaN
+            t0 = _mm256_max_ps(_mm256_min_ps(tFar, tNear), t0);
+            t1 = _mm256_min_ps(_mm256_max_ps(tNear, tFar), t1);
+        }
+
+        hit |= static_cast<uint64_t>(_mm256_movemask_ps(_mm256_cmp_ps(t0, t1, _CMP_LE_OQ))) << base;
+    }
+
+    return hit & active;
+}
+
+uint64_t packetSphere(const ShadowPacket& p, const float* center, float radius, uint64_t active)
+{
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 rr = _mm256_set1_ps(radius * radius);
+    const __m256 epsilon = _mm256_set1_ps(EPSILON);
+
+    uint64_t occluded = 0;
+    for (size_t base = 0; base < p.count; base += 8) {
+        if (((active >> base) & 0xff) == 0)
+            continue;
+
+        __m256 d[3], temp[3];
+        for (int k = 0; k < 3; ++k) {
+            d[k] = _mm256_loadu_ps(p.d[k] + base);
+            temp[k] = _mm256_sub_ps(_mm256_loadu_ps(p.o[k] + base), _mm256_set1_ps(center[k]));
+        }
+
+        //stejne poradi operaci jako dot() a solveQuadratic()
+        const __m256 a = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(d[0], d[0]), _mm256_mul_ps(d[1], d[1])),
+                                    _mm256_mul_ps(d[2], d[2]));
+        const __m256 b = _mm256_mul_ps(_mm256_set1_ps(2.f),
+                                    _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(temp[0], d[0]), _mm256_mul_ps(temp[1], d[1])),
+                                               _mm256_mul_ps(temp[2], d[2])));
+        const __m256 c = _mm256_sub_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(temp[0], temp[0]),
+                                                          _mm256_mul_ps(temp[1], temp[1])),
+                                               _mm256_mul_ps(temp[2], temp[2])), rr);
+
+        const __m256 discrim = _mm256_sub_ps(_mm256_mul_ps(b, b), _mm256_mul_ps(_mm256_mul_ps(_mm256_set1_ps(4.f), a), c));
+        const __m256 solvable = _mm256_cmp_ps(discrim, zero, _CMP_NLT_UQ);
+        const __m256 root = _mm256_sqrt_ps(discrim);
+
+        const __m256 q = _mm256_mul_ps(_mm256_set1_ps(-.5f),
+                                    blend(_mm256_add_ps(b, root), _mm256_sub_ps(b, root), _mm256_cmp_ps(b, zero, _CMP_LT_OQ)));
+        const __m256 r0 = _mm256_div_ps(q, a);
+        const __m256 r1 = _mm256_div_ps(c, q);
+
+        const __m256 swap = _mm256_cmp_ps(r0, r1, _CMP_GT_OQ);
+        const __m256 lo = blend(r0, r1, swap);
+        const __m256 hi = blend(r1, r0, swap);
+        const __m256 t = blend(lo, hi, _mm256_cmp_ps(hi, lo, _CMP_LT_OQ));
+
+        const __m256 hit = _mm256_and_ps(_mm256_and_ps(solvable, _mm256_cmp_ps(t, epsilon, _CMP_GT_OQ)),
+                                      _mm256_cmp_ps(t, _mm256_loadu_ps(p.maxt + base), _CMP_LT_OQ));
+        occluded |= static_cast<uint64_t>(_mm256_movemask_ps(hit)) << base;
+    }
+
+    return occluded & active;
+}
+
+size_t toneMap(const float* in, unsigned char* out, size_t count, float scale, int curve,
+               const unsigned char* lut, int lutSize)
+{
+    const __m256 vscale = _mm256_set1_ps(scale);
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 one = _mm256_set1_ps(1.f);
+    const __m256 lutScale = _mm256_set1_ps(float(lutSize - 1));
+
+    alignas(32) int index[8];
+
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        //max(NaN, 0) vraci druhy operand, NaN tedy skonci na nule
+        __m256 x = _mm256_max_ps(_mm256_mul_ps(_mm256_loadu_ps(in + i), vscale), zero);
+
+        switch (curve) {
+        case TONE_REINHARD:
+            x = _mm256_div_ps(x, _mm256_add_ps(one, x));
+            break;
+        case TONE_ACES: {
+            const __m256 num = _mm256_mul_ps(x, _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(2.51f), x), _mm256_set1_ps(0.03f)));
+            const __m256 den = _mm256_add_ps(_mm256_mul_ps(x, _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(2.43f), x),
+                                                                 _mm256_set1_ps(0.59f))), _mm256_set1_ps(0.14f));
+            x = _mm256_div_ps(num, den);
+            break;
+        }
+        default:
+            break;
+        }
+
+        x = _mm256_min_ps(x, one);
+
+        //zaokrouhleni podle vychoziho rezimu (k nejblizsimu)
+        _mm256_store_si256(reinterpret_cast<__m256i*>(index), _mm256_cvtps_epi32(_mm256_mul_ps(x, lutScale)));
+
+        for (int k = 0; k < 8; ++k)
+            out[i + k] = lut[index[k]];
+    }
+
+    return i;
+}
+
+}
+
+const SimdKernels SIMD_KERNELS_AVX2 = { "avx2", packetBox, packetSphere, toneMap };
+
+#else
+
+const SimdKernels SIMD_KERNELS_AVX2 = { "avx2", 0, 0, 0 };
+
+#endif
@@ -0,0 +1,147 @@
+/*!
+ * \file
+ * Varianta jader pro AVX-512F, sestnact paprsku najednou (viz simd.h).
+ */
+
+#include "simd.h"
+
+#include "packet.h"
+#include "tonemap.h"
+
+#ifdef __AVX512F__
+
+#include <immintrin.h>
+
+namespace {
+
+uint64_t packetBox(const ShadowPacket& p, const float* pMin, const float* pMax, uint64_t active)
+{
+    uint64_t hit = 0;
+    for (size_t base = 0; base < p.count; base += 16) {
+        if (((active >> base) & 0xffff) == 0)
+            continue;
+
+        __m512 t0 = _mm512_setzero_ps();
+        __m512 t1 = _mm512_loadu_ps(p.maxt + base);
+        for (int a = 0; a < 3; ++a) {
+            const __m512 o = _mm512_loadu_ps(p.o[a] + base);
+            const __m512 inv = _mm512_loadu_ps(p.invDir[a] + base);
+            const __m512 tNear = _mm512_mul_ps(_mm512_sub_ps(_mm512_set1_ps(pMin[a]), o), inv);
+            const __m512 tFar = _mm512_mul_ps(_mm512_sub_ps(_mm512_set1_ps(pMax[a]), o), inv);
+
+            //poradi operandu min/max odpovida skalarni vymene a porovnani i pro NaN
+            t0 = _mm512_max_ps(_mm512_min_ps(tFar, tNear), t0);
+            t1 = _mm512_min_ps(_mm512_max_ps(tNear, tFar), t1);
+        }
+
+        hit |= static_cast<uint64_t>(_mm512_cmp_ps_mask(t0, t1, _CMP_LE_OQ)) << base;
+    }
+
+    return hit & active;
+}
+
+uint64_t packetSphere(const ShadowPacket& p, const float* center, float radius, uint64_t active)
+{
+    const __m512 zero = _mm512_setzero_ps();
+    const __m512 rr = _mm512_set1_ps(radius * radius);
+    const __m512 epsilon = _mm512_set1_ps(EPSILON);
+
+    uint64_t occluded = 0;
+    for (size_t base = 0; base < p.count; base += 16) {
+        if (((active >> base) & 0xffff) == 0)
+            continue;
+
+        __m512 d[3], temp[3];
+        for (int k = 0; k < 3; ++k) {
+            d[k] = _mm512_loadu_ps(p.d[k] + base);
+            temp[k] = _mm512_sub_ps(_mm512_loadu_ps(p.o[k] + base), _mm512_set1_ps(center[k]));
+        }
+
+        //stejne poradi operaci jako dot() a solveQuadratic()
+        const __m512 a = _mm512_add_ps(_mm512_add_ps(_mm512_mul_ps(d[0], d[0]), _mm512_mul_ps(d[1], d[1])),
+                                       _mm512_mul_ps(d[2], d[2]));
+        const __m512 b = _mm512_mul_ps(_mm512_set1_ps(2.f),
+                                       _mm512_add_ps(_mm512_add_ps(_mm512_mul_ps(temp[0], d[0]),
+                                                                   _mm512_mul_ps(temp[1], d[1])),
+                                                     _mm512_mul_ps(temp[2], d[2])));
+        const __m512 c = _mm512_sub_ps(_mm512_add_ps(_mm512_add_ps(_mm512_mul_ps(temp[0], temp[0]),
+                                                                   _mm512_mul_ps(temp[1], temp[1])),
+                                                     _mm512_mul_ps(temp[2], temp[2])), rr);
+
+        const __m512 discrim = _mm512_sub_ps(_mm512_mul_ps(b, b),
+                                             _mm512_mul_ps(_mm512_mul_ps(_mm512_set1_ps(4.f), a), c));
+        const __mmask16 solvable = _mm512_cmp_ps_mask(discrim, zero, _CMP_NLT_UQ);
+        const __m512 root = _mm512_sqrt_ps(discrim);
+
+        const __m512 q = _mm512_mul_ps(_mm512_set1_ps(-.5f),
+                                       _mm512_mask_blend_ps(_mm512_cmp_ps_mask(b, zero, _CMP_LT_OQ),
+                                                            _mm512_add_ps(b, root), _mm512_sub_ps(b, root)));
+        const __m512 r0 = _mm512_div_ps(q, a);
+        const __m512 r1 = _mm512_div_ps(c, q);
+
+        const __mmask16 swap = _mm512_cmp_ps_mask(r0, r1, _CMP_GT_OQ);
+        const __m512 lo = _mm512_mask_blend_ps(swap, r0, r1);
+        const __m512 hi = _mm512_mask_blend_ps(swap, r1, r0);
+        const __m512 t = _mm512_mask_blend_ps(_mm512_cmp_ps_mask(hi, lo, _CMP_LT_OQ), lo, hi);
+
+        const __mmask16 hit = solvable & _mm512_cmp_ps_mask(t, epsilon, _CMP_GT_OQ)
+                              & _mm512_cmp_ps_mask(t, _mm512_loadu_ps(p.maxt + base), _CMP_LT_OQ);
+        occluded |= static_cast<uint64_t>(hit) << base;
+    }
+
+    return occluded & active;
+}
+
+size_t toneMap(const float* in, unsigned char* out, size_t count, float scale, int curve,
+               const unsigned char* lut, int lutSize)
+{
+    const __m512 vscale = _mm512_set1_ps(scale);
+    const __m512 zero = _mm512_setzero_ps();
+    const __m512 one = _mm512_set1_ps(1.f);
+    const __m512 lutScale = _mm512_set1_ps(float(lutSize - 1));
+
+    alignas(64) int index[16];
+
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        //max(NaN, 0) vraci druhy operand, NaN tedy skonci na nule
+        __m512 x = _mm512_max_ps(_mm512_mul_ps(_mm512_loadu_ps(in + i), vscale), zero);
+
+        switch (curve) {
+        case TONE_REINHARD:
+            x = _mm512_div_ps(x, _mm512_add_ps(one, x));
+            break;
+        case TONE_ACES: {
+            const __m512 num = _mm512_mul_ps(x, _mm512_add_ps(_mm512_mul_ps(_mm512_set1_ps(2.51f), x),
+                                                              _mm512_set1_ps(0.03f)));
+            const __m512 den = _mm512_add_ps(_mm512_mul_ps(x, _mm512_add_ps(_mm512_mul_ps(_mm512_set1_ps(2.43f), x),
+                                                                            _mm512_set1_ps(0.59f))),
+                                             _mm512_set1_ps(0.14f));
+            x = _mm512_div_ps(num, den);
+            break;
+        }
+        default:
+            break;
+        }
+
+        x = _mm512_min_ps(x, one);
+
+        //zaokrouhleni podle vychoziho rezimu (k nejblizsimu)
+        _mm512_store_si512(index, _mm512_cvtps_epi32(_mm512_mul_ps(x, lutScale)));
+
+        for (int k = 0; k < 16; ++k)
+            out[i + k] = lut[index[k]];
+    }
+
+    return i;
+}
+
+}
+
+const SimdKernels SIMD_KERNELS_AVX512 = { "avx512", packetBox, packetSphere, toneMap };
+
+#else
+
+const SimdKernels SIMD_KERNELS_AVX512 = { "avx512", 0, 0, 0 };
+
+#endif
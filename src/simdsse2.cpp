@@ -0,0 +1,149 @@
+/*!
+ * \file
+ * Varianta jader pro SSE2, ctyri paprsky najednou (viz simd.h).
+ */
+
+#include "simd.h"
+
+#include "packet.h"
+#include "tonemap.h"
+
+#ifdef __SSE2__
+
+#include <emmintrin.h>
+
+namespace {
+
+inline __m128 blend(__m128 a, __m128 b, __m128 mask)
+{
+    return _mm_or_ps(_mm_and_ps(mask, b), _mm_andnot_ps(mask, a));
+}
+
+uint64_t packetBox(const ShadowPacket& p, const float* pMin, const float* pMax, uint64_t active)
+{
+    uint64_t hit = 0;
+    for (size_t base = 0; base < p.count; base += 4) {
+        if (((active >> base) & 0xf) == 0)
+            continue;
+
+        __m128 t0 = _mm_setzero_ps();
+        __m128 t1 = _mm_loadu_ps(p.maxt + base);
+        for (int a = 0; a < 3; ++a) {
+            const __m128 o = _mm_loadu_ps(p.o[a] + base);
+            const __m128 inv = _mm_loadu_ps(p.invDir[a] + base);
+            const __m128 tNear = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(pMin[a]), o), inv);
+            const __m128 tFar = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(pMax[a]), o), inv);
+
+            //poradi operandu min/max odpovida skalarni vymene a porovnani i pro NaN
+            t0 = _mm_max_ps(_mm_min_ps(tFar, tNear), t0);
+            t1 = _mm_min_ps(_mm_max_ps(tNear, tFar), t1);
+        }
+
+        hit |= static_cast<uint64_t>(_mm_movemask_ps(_mm_cmple_ps(t0, t1))) << base;
+    }
+
+    return hit & active;
+}
+
+uint64_t packetSphere(const ShadowPacket& p, const float* center, float radius, uint64_t active)
+{
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 rr = _mm_set1_ps(radius * radius);
+    const __m128 epsilon = _mm_set1_ps(EPSILON);
+
+    uint64_t occluded = 0;
+    for (size_t base = 0; base < p.count; base += 4) {
+        if (((active >> base) & 0xf) == 0)
+            continue;
+
+        __m128 d[3], temp[3];
+        for (int k = 0; k < 3; ++k) {
+            d[k] = _mm_loadu_ps(p.d[k] + base);
+            temp[k] = _mm_sub_ps(_mm_loadu_ps(p.o[k] + base), _mm_set1_ps(center[k]));
+        }
+
+        //stejne poradi operaci jako dot() a solveQuadratic()
+        const __m128 a = _mm_add_ps(_mm_add_ps(_mm_mul_ps(d[0], d[0]), _mm_mul_ps(d[1], d[1])),
+                                    _mm_mul_ps(d[2], d[2]));
+        const __m128 b = _mm_mul_ps(_mm_set1_ps(2.f),
+                                    _mm_add_ps(_mm_add_ps(_mm_mul_ps(temp[0], d[0]), _mm_mul_ps(temp[1], d[1])),
+                                               _mm_mul_ps(temp[2], d[2])));
+        const __m128 c = _mm_sub_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(temp[0], temp[0]),
+                                                          _mm_mul_ps(temp[1], temp[1])),
+                                               _mm_mul_ps(temp[2], temp[2])), rr);
+
+        const __m128 discrim = _mm_sub_ps(_mm_mul_ps(b, b), _mm_mul_ps(_mm_mul_ps(_mm_set1_ps(4.f), a), c));
+        const __m128 solvable = _mm_cmpnlt_ps(discrim, zero);
+        const __m128 root = _mm_sqrt_ps(discrim);
+
+        const __m128 q = _mm_mul_ps(_mm_set1_ps(-.5f),
+                                    blend(_mm_add_ps(b, root), _mm_sub_ps(b, root), _mm_cmplt_ps(b, zero)));
+        const __m128 r0 = _mm_div_ps(q, a);
+        const __m128 r1 = _mm_div_ps(c, q);
+
+        const __m128 swap = _mm_cmpgt_ps(r0, r1);
+        const __m128 lo = blend(r0, r1, swap);
+        const __m128 hi = blend(r1, r0, swap);
+        const __m128 t = blend(lo, hi, _mm_cmplt_ps(hi, lo));
+
+        const __m128 hit = _mm_and_ps(_mm_and_ps(solvable, _mm_cmpgt_ps(t, epsilon)),
+                                      _mm_cmplt_ps(t, _mm_loadu_ps(p.maxt + base)));
+        occluded |= static_cast<uint64_t>(_mm_movemask_ps(hit)) << base;
+    }
+
+    return occluded & active;
+}
+
+size_t toneMap(const float* in, unsigned char* out, size_t count, float scale, int curve,
+               const unsigned char* lut, int lutSize)
+{
+    const __m128 vscale = _mm_set1_ps(scale);
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1.f);
+    const __m128 lutScale = _mm_set1_ps(float(lutSize - 1));
+
+    alignas(16) int index[4];
+
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        //max(NaN, 0) vraci druhy operand, NaN tedy skonci na nule
+        __m128 x = _mm_max_ps(_mm_mul_ps(_mm_loadu_ps(in + i), vscale), zero);
+
+        switch (curve) {
+        case TONE_REINHARD:
+            x = _mm_div_ps(x, _mm_add_ps(one, x));
+            break;
+        case TONE_ACES: {
+            const __m128 num = _mm_mul_ps(x, _mm_add_ps(_mm_mul_ps(_mm_set1_ps(2.51f), x), _mm_set1_ps(0.03f)));
+            const __m128 den = _mm_add_ps(_mm_mul_ps(x, _mm_add_ps(_mm_mul_ps(_mm_set1_ps(2.43f), x),
+                                                                 _mm_set1_ps(0.59f))), _mm_set1_ps(0.14f));
+            x = _mm_div_ps(num, den);
+            break;
+        }
+        default:
+            break;
+        }
+
+        x = _mm_min_ps(x, one);
+
+        //zaokrouhleni podle vychoziho rezimu (k nejblizsimu)
+        _mm_store_si128(reinterpret_cast<__m128i*>(index), _mm_cvtps_epi32(_mm_mul_ps(x, lutScale)));
+
+        out[i] = lut[index[0]];
+        out[i + 1] = lut[index[1]];
+        out[i + 2] = lut[index[2]];
+        out[i + 3] = lut[index[3]];
+    }
+
+    return i;
+}
+
+}
+
+const SimdKernels SIMD_KERNELS_SSE2 = { "sse2", packetBox, packetSphere, toneMap };
+
+#else
+
+const SimdKernels SIMD_KERNELS_SSE2 = { "sse2", 0, 0, 0 };
+
+#endif
@@ -4,13 +4,44 @@ CONFIG += c++11
 CONFIG -= app_bundle
 CONFIG -= qt
 
+unix: LIBS += -pthread
+
 SOURCES += main.cpp \
     film.cpp \
     primitive.cpp \
     light.cpp \
     geometry.cpp \
     camera.cpp \
-    material.cpp
+    material.cpp \
+    geometryfile.cpp \
+    options.cpp \
+    checkpoint.cpp \
+    tile.cpp \
+    denoise.cpp \
+    imageio.cpp \
+    preview.cpp \
+    tonemap.cpp \
+    accelerator.cpp \
+    bvh.cpp \
+    scene.cpp \
+    transform.cpp \
+    qbvh.cpp \
+    raybatch.cpp \
+    scenecache.cpp \
+    server.cpp \
+    bvhcache.cpp \
+    numa.cpp \
+    budget.cpp \
+    texture.cpp \
+    texturecache.cpp \
+    perfcounters.cpp \
+    trace.cpp \
+    heatmap.cpp \
+    regression.cpp \
+    simd.cpp \
+    simdsse2.cpp \
+    imagewriter.cpp \
+    views.cpp
 
 HEADERS += \
     geometry.h \
@@ -21,5 +52,53 @@ HEADERS += \
     light.h \
     material.h \
     primitive.h \
-    camera.h
+    camera.h \
+    geometryfile.h \
+    options.h \
+    checkpoint.h \
+    rng.h \
+    tile.h \
+    denoise.h \
+    imageio.h \
+    preview.h \
+    tonemap.h \
+    accelerator.h \
+    bvh.h \
+    scene.h \
+    transform.h \
+    qbvh.h \
+    raybatch.h \
+    packet.h \
+    scenecache.h \
+    server.h \
+    bvhcache.h \
+    numa.h \
+    budget.h \
+    texture.h \
+    texturecache.h \
+    perfcounters.h \
+    trace.h \
+    heatmap.h \
+    regression.h \
+    simd.h \
+    imagewriter.h \
+    views.h
+
+# varianty SIMD jader s vlastnimi prepinaci, vybiraji se za behu (viz simd.h)
+contains(QMAKE_HOST.arch, x86_64) {
+    AVX2_SOURCES = simdavx2.cpp
+    avx2.input = AVX2_SOURCES
+    avx2.output = ${QMAKE_FILE_BASE}.o
+    avx2.commands = $$QMAKE_CXX -c $$QMAKE_CXXFLAGS -std=c++11 -mavx2 -ffp-contract=off ${QMAKE_FILE_NAME} -o ${QMAKE_FILE_OUT}
+    avx2.variable_out = OBJECTS
+
+    AVX512_SOURCES = simdavx512.cpp
+    avx512.input = AVX512_SOURCES
+    avx512.output = ${QMAKE_FILE_BASE}.o
+    avx512.commands = $$QMAKE_CXX -c $$QMAKE_CXXFLAGS -std=c++11 -mavx512f -ffp-contract=off ${QMAKE_FILE_NAME} -o ${QMAKE_FILE_OUT}
+    avx512.variable_out = OBJECTS
 
+    QMAKE_EXTRA_COMPILERS += avx2 avx512
+} else {
+    SOURCES += simdavx2.cpp simdavx512.cpp
+}
@@ -0,0 +1,111 @@
+/*!
+ * \file
+ * Nastroj pro prevod obrazku PPM (P6, 8 bitu, sRGB) do souboru textury
+ * s dlazdicemi a urovnemi detailu (viz texture.h).
+ */
+
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "texture.h"
+
+using namespace std;
+
+/*!
+ * \brief Prevod 8bitove hodnoty sRGB na linearni.
+ */
+float toLinear(unsigned char value)
+{
+    const float c = value / 255.f;
+    return c <= 0.04045f ? c / 12.92f : pow((c + 0.055f) / 1.055f, 2.4f);
+}
+
+/*!
+ * \brief Nacte obrazek PPM typu P6.
+ * \return false pri chybe ve vstupu
+ */
+bool readPPM(const string& path, size_t& width, size_t& height, vector<RGBColor>& texels)
+{
+    ifstream ifs(path, ios::binary);
+    string magic;
+    unsigned int maxValue;
+    if (!(ifs >> magic >> width >> height >> maxValue) || magic != "P6" || maxValue != 255) {
+        cerr << path << " neni 8bitovy obrazek PPM (P6)" << endl;
+        return false;
+    }
+    ifs.get();
+
+    //rozmery z hlavicky se overi proti velikosti souboru, nez se podle nich alokuje
+    const streampos data = ifs.tellg();
+    ifs.seekg(0, ios::end);
+    const size_t available = static_cast<size_t>(ifs.tellg() - data);
+    ifs.seekg(data);
+    if (height > 0 && width > available / 3 / height) {
+        cerr << path << " je prilis kratky" << endl;
+        return false;
+    }
+
+    vector<unsigned char> raw(width * height * 3);
+    if (!ifs.read(reinterpret_cast<char*>(raw.data()), raw.size())) {
+        cerr << path << " je prilis kratky" << endl;
+        return false;
+    }
+
+    texels.resize(width * height);
+    for (size_t i = 0; i < texels.size(); ++i)
+        texels[i] = RGBColor(toLinear(raw[3 * i]), toLinear(raw[3 * i + 1]), toLinear(raw[3 * i + 2]));
+
+    return true;
+}
+
+/*!
+ * \brief Vygeneruje sachovnici pro testovani.
+ * \param size delka hrany textury
+ * \param cells pocet poli v radku
+ */
+void generateChecker(size_t size, size_t cells, vector<RGBColor>& texels)
+{
+    texels.resize(size * size);
+    const size_t cell = max<size_t>(size / max<size_t>(cells, 1), 1);
+    for (size_t y = 0; y < size; ++y) {
+        for (size_t x = 0; x < size; ++x) {
+            const bool odd = ((x / cell) + (y / cell)) % 2 != 0;
+            texels[y * size + x] = odd ? RGBColor(0.9f, 0.9f, 0.9f) : RGBColor(0.1f, 0.3f, 0.8f);
+        }
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    size_t width, height;
+    vector<RGBColor> texels;
+    string output;
+
+    if (argc == 5 && strcmp(argv[1], "--checker") == 0) {
+        width = height = strtoul(argv[2], 0, 10);
+        generateChecker(width, strtoul(argv[3], 0, 10), texels);
+        output = argv[4];
+    } else if (argc == 3) {
+        if (!readPPM(argv[1], width, height, texels))
+            return 1;
+        output = argv[2];
+    } else {
+        cout << "Pouziti: " << argv[0] << " <vstup.ppm> <vystup.tex>\n"
+             << "         " << argv[0] << " --checker <velikost> <pocet poli> <vystup.tex>\n";
+        return 1;
+    }
+
+    if (!writeTextureFile(output, width, height, texels)) {
+        cerr << "Zapis do " << output << " selhal" << endl;
+        return 1;
+    }
+
+    cout << "Texture: " << width << "x" << height << ", written: " << output << endl;
+
+    return 0;
+}
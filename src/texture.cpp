@@ -0,0 +1,280 @@
+#include "texture.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace {
+
+const RGBColor MISSING_TEXTURE(1.f, 0.f, 1.f); ///< barva textury, kterou nelze nacist
+
+float decodeSRGB(uint8_t value)
+{
+    static float table[256];
+    static std::once_flag initialized;
+    std::call_once(initialized, []() {
+        for (int i = 0; i < 256; ++i) {
+            const float c = i / 255.f;
+            table[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+        }
+    });
+
+    return table[value];
+}
+
+uint8_t encodeSRGB(float c)
+{
+    c = std::min(std::max(c, 0.f), 1.f);
+    c = c <= 0.0031308f ? 12.92f * c : 1.055f * std::pow(c, 1.f / 2.4f) - 0.055f;
+    return static_cast<uint8_t>(c * 255.f + 0.5f);
+}
+
+size_t tileBytes(uint32_t tileSize)
+{
+    return static_cast<size_t>(tileSize) * tileSize * 3;
+}
+
+std::atomic<uint64_t> nextTextureId(0);
+
+/*!
+ * \brief Overi hlavicku nactenou ze souboru. Rozmery urovni musi odpovidat
+ * dlazdicim, dlazdice se musi vejit do klice v pameti (viz Texture::texel)
+ * a lezet cele v souboru.
+ * \param header hlavicka
+ * \param fileSize velikost souboru v bajtech
+ */
+bool validHeader(const TextureFileHeader& header, uint64_t fileSize)
+{
+    if (header.magic != TEXTURE_FILE_MAGIC
+            || header.version != TEXTURE_FILE_VERSION
+            || header.tileSize != TEXTURE_TILE_SIZE
+            || header.levelCount == 0 || header.levelCount > TEXTURE_MAX_LEVELS)
+        return false;
+
+    for (uint32_t i = 0; i < header.levelCount; ++i) {
+        const TextureLevel& l = header.levels[i];
+        if (l.width == 0 || l.height == 0
+                || l.tilesX != (static_cast<uint64_t>(l.width) + TEXTURE_TILE_SIZE - 1) / TEXTURE_TILE_SIZE
+                || l.tilesY != (static_cast<uint64_t>(l.height) + TEXTURE_TILE_SIZE - 1) / TEXTURE_TILE_SIZE
+                || l.tilesX > (1u << 17) || l.tilesY > (1u << 18))
+            return false;
+
+        const uint64_t bytes = static_cast<uint64_t>(l.tilesX) * l.tilesY * tileBytes(TEXTURE_TILE_SIZE);
+        if (l.offset > fileSize || bytes > fileSize - l.offset)
+            return false;
+    }
+
+    return true;
+}
+
+}
+
+bool writeTextureFile(const std::string& path, size_t width, size_t height,
+                      const std::vector<RGBColor>& texels)
+{
+    if (width == 0 || height == 0 || texels.size() != width * height)
+        return false;
+
+    TextureFileHeader header;
+    memset(&header, 0, sizeof(header));
+    header.magic = TEXTURE_FILE_MAGIC;
+    header.version = TEXTURE_FILE_VERSION;
+    header.tileSize = TEXTURE_TILE_SIZE;
+
+    //vsechny urovne az po jediny texel
+    std::vector<std::vector<RGBColor> > levels(1, texels);
+    size_t w = width, h = height;
+    while (w > 1 || h > 1) {
+        if (levels.size() == TEXTURE_MAX_LEVELS)
+            return false;
+
+        const size_t nw = std::max<size_t>(w / 2, 1), nh = std::max<size_t>(h / 2, 1);
+        const std::vector<RGBColor>& src = levels.back();
+        std::vector<RGBColor> dst(nw * nh);
+        for (size_t y = 0; y < nh; ++y) {
+            for (size_t x = 0; x < nw; ++x) {
+                const size_t x0 = std::min(2 * x, w - 1), x1 = std::min(2 * x + 1, w - 1);
+                const size_t y0 = std::min(2 * y, h - 1), y1 = std::min(2 * y + 1, h - 1);
+                dst[y * nw + x] = (src[y0 * w + x0] + src[y0 * w + x1]
+                                   + src[y1 * w + x0] + src[y1 * w + x1]) * 0.25f;
+            }
+        }
+
+        levels.push_back(dst);
+        w = nw;
+        h = nh;
+    }
+
+    uint64_t offset = sizeof(TextureFileHeader);
+    w = width;
+    h = height;
+    for (size_t l = 0; l < levels.size(); ++l) {
+        TextureLevel& level = header.levels[l];
+        level.width = static_cast<uint32_t>(w);
+        level.height = static_cast<uint32_t>(h);
+        level.tilesX = static_cast<uint32_t>((w + TEXTURE_TILE_SIZE - 1) / TEXTURE_TILE_SIZE);
+        level.tilesY = static_cast<uint32_t>((h + TEXTURE_TILE_SIZE - 1) / TEXTURE_TILE_SIZE);
+        level.offset = offset;
+        offset += static_cast<uint64_t>(level.tilesX) * level.tilesY * tileBytes(TEXTURE_TILE_SIZE);
+
+        w = std::max<size_t>(w / 2, 1);
+        h = std::max<size_t>(h / 2, 1);
+    }
+    header.levelCount = static_cast<uint32_t>(levels.size());
+
+    std::ofstream ofs(path, std::ios::binary | std::ios::out);
+    if (!ofs)
+        return false;
+
+    ofs.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+    //dlazdice po radcich, okraj se doplni opakovanim posledniho texelu
+    std::vector<uint8_t> tile(tileBytes(TEXTURE_TILE_SIZE));
+    for (size_t l = 0; l < levels.size(); ++l) {
+        const TextureLevel& level = header.levels[l];
+        for (uint32_t ty = 0; ty < level.tilesY; ++ty) {
+            for (uint32_t tx = 0; tx < level.tilesX; ++tx) {
+                uint8_t* out = tile.data();
+                for (uint32_t y = 0; y < TEXTURE_TILE_SIZE; ++y) {
+                    const size_t sy = std::min<size_t>(ty * TEXTURE_TILE_SIZE + y, level.height - 1);
+                    for (uint32_t x = 0; x < TEXTURE_TILE_SIZE; ++x, out += 3) {
+                        const size_t sx = std::min<size_t>(tx * TEXTURE_TILE_SIZE + x, level.width - 1);
+                        const RGBColor& c = levels[l][sy * level.width + sx];
+                        out[0] = encodeSRGB(c.r);
+                        out[1] = encodeSRGB(c.g);
+                        out[2] = encodeSRGB(c.b);
+                    }
+                }
+                ofs.write(reinterpret_cast<const char*>(tile.data()), tile.size());
+            }
+        }
+    }
+
+    return ofs.good();
+}
+
+
+//Texture
+Texture::Texture(const std::string& path, const std::shared_ptr<TextureCache>& cache)
+    : filePath(path), cache(cache), id(nextTextureId++), valid(false)
+{
+    memset(&header, 0, sizeof(header));
+}
+
+bool Texture::open() const
+{
+    std::call_once(opened, [this]() {
+        std::ifstream ifs(filePath, std::ios::binary);
+        if (!ifs.read(reinterpret_cast<char*>(&header), sizeof(header))
+                || !ifs.seekg(0, std::ios::end)
+                || !validHeader(header, static_cast<uint64_t>(ifs.tellg()))) {
+            std::cerr << "Chyba: nelze nacist texturu " << filePath << std::endl;
+            return;
+        }
+
+        valid = true;
+    });
+
+    return valid;
+}
+
+bool Texture::loadTile(uint32_t level, uint32_t tx, uint32_t ty, TextureTile& tile, size_t& fileBytes) const
+{
+    const TextureLevel& l = header.levels[level];
+    const size_t bytes = tileBytes(header.tileSize);
+    const uint64_t offset = l.offset + (static_cast<uint64_t>(ty) * l.tilesX + tx) * bytes;
+
+    //soubor se otevira jen na dobu cteni, pocet textur tak neomezuji ani deskriptory
+    int fd = ::open(filePath.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    std::vector<uint8_t> raw(bytes);
+    const ssize_t read = pread(fd, raw.data(), bytes, offset);
+    ::close(fd);
+    if (read != static_cast<ssize_t>(bytes))
+        return false;
+
+    tile.size = header.tileSize;
+    tile.texels.resize(static_cast<size_t>(header.tileSize) * header.tileSize);
+    for (size_t i = 0; i < tile.texels.size(); ++i)
+        tile.texels[i] = RGBColor(decodeSRGB(raw[3 * i]), decodeSRGB(raw[3 * i + 1]), decodeSRGB(raw[3 * i + 2]));
+
+    fileBytes = bytes;
+    return true;
+}
+
+RGBColor Texture::texel(uint32_t level, int x, int y, std::shared_ptr<const TextureTile>& tile,
+                        uint64_t& tileKey) const
+{
+    const TextureLevel& l = header.levels[level];
+
+    //u se opakuje, v se orizne
+    x %= static_cast<int>(l.width);
+    if (x < 0)
+        x += l.width;
+    y = std::min(std::max(y, 0), static_cast<int>(l.height) - 1);
+
+    const uint32_t size = header.tileSize;
+    const uint32_t tx = x / size, ty = y / size;
+    const uint64_t key = id << 40 | static_cast<uint64_t>(level) << 35
+                         | static_cast<uint64_t>(ty) << 17 | tx;
+
+    //sousedni texely lezi vetsinou ve stejne dlazdici
+    if (!tile || key != tileKey) {
+        tile = cache->acquire(key, [&](TextureTile& t, size_t& fileBytes) {
+            return loadTile(level, tx, ty, t, fileBytes);
+        });
+        tileKey = key;
+        if (!tile)
+            return MISSING_TEXTURE;
+    }
+
+    return tile->texels[(y % size) * size + x % size];
+}
+
+RGBColor Texture::lookup(float u, float v, float footprint) const
+{
+    if (!open())
+        return MISSING_TEXTURE;
+
+    //uroven, na ktere stopa paprsku pokryje priblizne jeden texel
+    const float texels = footprint * std::max(header.levels[0].width, header.levels[0].height);
+    const float lod = texels > 1.f ? std::log2(texels) : 0.f;
+    const uint32_t level = std::min(static_cast<uint32_t>(lod + 0.5f), header.levelCount - 1);
+    const TextureLevel& l = header.levels[level];
+
+    const float x = (u - std::floor(u)) * l.width - 0.5f;
+    const float y = std::min(std::max(v, 0.f), 1.f) * l.height - 0.5f;
+    const int x0 = static_cast<int>(std::floor(x)), y0 = static_cast<int>(std::floor(y));
+    const float fx = x - x0, fy = y - y0;
+
+    std::shared_ptr<const TextureTile> tile;
+    uint64_t tileKey = 0;
+    const RGBColor c00 = texel(level, x0, y0, tile, tileKey);
+    const RGBColor c10 = texel(level, x0 + 1, y0, tile, tileKey);
+    const RGBColor c01 = texel(level, x0, y0 + 1, tile, tileKey);
+    const RGBColor c11 = texel(level, x0 + 1, y0 + 1, tile, tileKey);
+
+    return (c00 * (1.f - fx) + c10 * fx) * (1.f - fy) + (c01 * (1.f - fx) + c11 * fx) * fy;
+}
+
+RGBColor Texture::average() const
+{
+    if (!open())
+        return MISSING_TEXTURE;
+
+    std::shared_ptr<const TextureTile> tile;
+    uint64_t tileKey = 0;
+    return texel(header.levelCount - 1, 0, 0, tile, tileKey);
+}
+
+const std::string& Texture::path() const
+{
+    return filePath;
+}
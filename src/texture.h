@@ -0,0 +1,119 @@
+#ifndef TEXTURE_H
+#define TEXTURE_H
+
+/*!
+ * \file
+ * Textury ulozene po dlazdicich s predpocitanymi urovnemi detailu (mipmapami).\n
+ * Soubor textury obsahuje hlavicku s tabulkou urovni a za ni dlazdice vsech
+ * urovni. Dlazdice ma pevnou velikost TEXTURE_TILE_SIZE x TEXTURE_TILE_SIZE
+ * texelu RGB po 8 bitech v kodovani sRGB, dlazdice na okraji jsou doplnene.
+ * Texture soubor otevre az pri prvnim pristupu a cte jen dlazdice, ktere
+ * paprsky skutecne potrebuji; drzi je sdilena TextureCache.
+ */
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "core.h"
+
+#include "color.h"
+#include "texturecache.h"
+
+const uint32_t TEXTURE_FILE_MAGIC = 0x52584554; ///< "TEXR" v little endian
+const uint32_t TEXTURE_FILE_VERSION = 1; ///< verze formatu
+const uint32_t TEXTURE_TILE_SIZE = 64; ///< delka hrany dlazdice v texelech
+const uint32_t TEXTURE_MAX_LEVELS = 20; ///< maximalni pocet urovni detailu
+
+/*!
+ * Popis jedne urovne detailu v souboru textury.
+ */
+struct TextureLevel {
+    uint32_t width; ///< sirka urovne v texelech
+    uint32_t height; ///< vyska urovne v texelech
+    uint32_t tilesX; ///< pocet dlazdic v radku
+    uint32_t tilesY; ///< pocet radku dlazdic
+    uint64_t offset; ///< pozice prvni dlazdice od zacatku souboru
+};
+
+/*!
+ * Hlavicka souboru textury.
+ */
+struct TextureFileHeader {
+    uint32_t magic; ///< TEXTURE_FILE_MAGIC
+    uint32_t version; ///< TEXTURE_FILE_VERSION
+    uint32_t tileSize; ///< TEXTURE_TILE_SIZE
+    uint32_t levelCount; ///< pocet platnych zaznamu v levels
+    TextureLevel levels[TEXTURE_MAX_LEVELS]; ///< uroven 0 je nejpodrobnejsi
+};
+
+/*!
+ * \brief Zapise texturu do souboru vcetne vsech urovni detailu.
+ * Kazda dalsi uroven vznikne prumerovanim 2 x 2 texelu predchozi urovne
+ * v linearnich hodnotach, posledni uroven ma jediny texel.
+ * \param path cilovy soubor
+ * \param width sirka
+ * \param height vyska
+ * \param texels linearni hodnoty po radcich
+ * \return true pri uspechu
+ */
+bool writeTextureFile(const std::string& path, size_t width, size_t height,
+                      const std::vector<RGBColor>& texels);
+
+/*!
+ * Textura ctena po dlazdicich pres sdilenou pamet dlazdic.
+ */
+class Texture
+{
+public:
+    /*!
+     * \brief Konstruktor. Soubor se neotevira, dokud neni potreba.
+     * \param path soubor textury (viz writeTextureFile)
+     * \param cache sdilena pamet dlazdic
+     */
+    Texture(const std::string& path, const std::shared_ptr<TextureCache>& cache);
+
+    /*!
+     * \brief Bilinearne filtrovana hodnota na urovni odpovidajici stope paprsku.
+     * Souradnice u se opakuje, v se orizne na [0, 1].
+     * \param u vodorovna souradnice
+     * \param v svisla souradnice
+     * \param footprint sirka stopy paprsku v jednotkach souradnic (0 = nejpodrobnejsi uroven)
+     * \return linearni barva, pri chybe souboru fialova
+     */
+    RGBColor lookup(float u, float v, float footprint) const;
+
+    /*!
+     * \brief Prumerna barva textury (nejhrubsi uroven).
+     */
+    RGBColor average() const;
+
+    /*!
+     * \brief Cesta k souboru textury.
+     */
+    const std::string& path() const;
+
+private:
+    Texture(const Texture&);
+    Texture& operator =(const Texture&);
+
+    bool open() const;
+    RGBColor texel(uint32_t level, int x, int y, std::shared_ptr<const TextureTile>& tile,
+                   uint64_t& tileKey) const;
+    bool loadTile(uint32_t level, uint32_t tx, uint32_t ty, TextureTile& tile, size_t& fileBytes) const;
+
+private:
+    std::string filePath;
+    std::shared_ptr<TextureCache> cache;
+    uint64_t id; ///< cast klice dlazdic v pameti, jednoznacna pro kazdou texturu
+
+    mutable std::once_flag opened;
+    mutable bool valid; ///< hlavicka byla uspesne nactena
+    mutable TextureFileHeader header;
+};
+
+#endif // TEXTURE_H
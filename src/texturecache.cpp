@@ -0,0 +1,104 @@
+#include "texturecache.h"
+
+TextureCache::TextureCache(size_t limit)
+    : memoryLimit(limit), hitCount(0), missCount(0), loadedBytes(0), evictionCount(0)
+{}
+
+TextureCache::Shard& TextureCache::shard(uint64_t key)
+{
+    //sousedni dlazdice maji podobne klice, promichani je rozprostre do vsech casti
+    const uint64_t h = key * 0x9e3779b97f4a7c15ull;
+    return shards[(h >> 32) % TEXTURE_CACHE_SHARDS];
+}
+
+std::shared_ptr<const TextureTile> TextureCache::find(uint64_t key)
+{
+    Shard& s = shard(key);
+    std::lock_guard<std::mutex> lock(s.mutex);
+
+    auto it = s.index.find(key);
+    if (it == s.index.end())
+        return std::shared_ptr<const TextureTile>();
+
+    ++hitCount;
+    s.entries.splice(s.entries.begin(), s.entries, it->second);
+    return s.entries.front().second;
+}
+
+std::shared_ptr<const TextureTile> TextureCache::insert(uint64_t key,
+                                                        const std::shared_ptr<const TextureTile>& tile,
+                                                        size_t fileBytes)
+{
+    ++missCount;
+    loadedBytes += fileBytes;
+
+    Shard& s = shard(key);
+    std::lock_guard<std::mutex> lock(s.mutex);
+
+    auto it = s.index.find(key);
+    if (it != s.index.end()) {
+        s.entries.splice(s.entries.begin(), s.entries, it->second);
+        return s.entries.front().second;
+    }
+
+    s.entries.push_front(std::make_pair(key, tile));
+    s.index[key] = s.entries.begin();
+    s.memory += tile->memoryUsage();
+
+    //kazda cast ma svuj podil limitu, posledni vlozena dlazdice zustava vzdy
+    const size_t shardLimit = memoryLimit / TEXTURE_CACHE_SHARDS;
+    while (s.memory > shardLimit && s.entries.size() > 1) {
+        s.memory -= s.entries.back().second->memoryUsage();
+        s.index.erase(s.entries.back().first);
+        s.entries.pop_back();
+        ++evictionCount;
+    }
+
+    return tile;
+}
+
+void TextureCache::clear()
+{
+    for (size_t i = 0; i < TEXTURE_CACHE_SHARDS; ++i) {
+        std::lock_guard<std::mutex> lock(shards[i].mutex);
+        shards[i].entries.clear();
+        shards[i].index.clear();
+        shards[i].memory = 0;
+    }
+}
+
+size_t TextureCache::hits() const
+{
+    return hitCount;
+}
+
+size_t TextureCache::misses() const
+{
+    return missCount;
+}
+
+size_t TextureCache::bytesLoaded() const
+{
+    return loadedBytes;
+}
+
+size_t TextureCache::evictions() const
+{
+    return evictionCount;
+}
+
+size_t TextureCache::memoryUsage() const
+{
+    size_t memory = 0;
+    for (size_t i = 0; i < TEXTURE_CACHE_SHARDS; ++i) {
+        std::lock_guard<std::mutex> lock(shards[i].mutex);
+        memory += shards[i].memory;
+    }
+
+    return memory;
+}
+
+size_t TextureCache::limit() const
+{
+    return memoryLimit;
+}
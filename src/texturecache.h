@@ -0,0 +1,148 @@
+#ifndef TEXTURECACHE_H
+#define TEXTURECACHE_H
+
+/*!
+ * \file
+ * Sdilena pamet dlazdic textur s pevnym limitem velikosti.\n
+ * Dlazdice se nacitaji az pri prvnim pristupu a pri prekroceni limitu se
+ * uvolnuji nejdele nepouzite. Pamet je rozdelena na nezavisle casti podle klice,
+ * kazda s vlastnim zamkem, aby se vlakna pri soucasnych dotazech nebrzdila.
+ * Dlazdice se predavaji pres shared_ptr, takze vyhozeni z pameti nezneplatni
+ * dlazdici, kterou prave nektere vlakno cte.
+ */
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "core.h"
+
+#include "color.h"
+
+const size_t TEXTURE_CACHE_SHARDS = 16; ///< pocet nezavislych casti pameti
+
+/*!
+ * Jedna dlazdice jedne urovne textury v linearnich hodnotach.
+ */
+struct TextureTile {
+    std::vector<RGBColor> texels; ///< texely po radcich, vzdy cela ctvercova dlazdice
+    size_t size; ///< delka hrany dlazdice v texelech
+
+    /*!
+     * \brief Obsazena pamet v bajtech.
+     */
+    size_t memoryUsage() const
+    {
+        return sizeof(TextureTile) + texels.size() * sizeof(RGBColor);
+    }
+};
+
+/*!
+ * LRU pamet dlazdic textur.
+ */
+class TextureCache
+{
+public:
+    /*!
+     * \brief Konstruktor.
+     * \param limit nejvetsi soucet pameti drzenych dlazdic v bajtech
+     */
+    explicit TextureCache(size_t limit);
+
+    /*!
+     * \brief Vrati dlazdici z pameti, nebo ji nacte.
+     * Nacitani probiha mimo zamek; pokud stejnou dlazdici soucasne nacte vic
+     * vlaken, pouzije se ta, ktera byla vlozena prvni.
+     * \param key jednoznacny klic dlazdice
+     * \param load funkce bool(TextureTile& tile, size_t& fileBytes), ktera dlazdici nacte
+     * \return dlazdice, nebo 0 pokud ji nelze nacist
+     */
+    template<class Load>
+    std::shared_ptr<const TextureTile> acquire(uint64_t key, Load load);
+
+    /*!
+     * \brief Uvolni vsechny dlazdice.
+     */
+    void clear();
+
+    /*!
+     * \brief Pocet dotazu, ktere nasly dlazdici v pameti.
+     */
+    size_t hits() const;
+
+    /*!
+     * \brief Pocet dotazu, ktere musely dlazdici nacist.
+     */
+    size_t misses() const;
+
+    /*!
+     * \brief Celkovy pocet bajtu nactenych ze souboru textur.
+     */
+    size_t bytesLoaded() const;
+
+    /*!
+     * \brief Pocet dlazdic uvolnenych kvuli limitu.
+     */
+    size_t evictions() const;
+
+    /*!
+     * \brief Soucet pameti prave drzenych dlazdic.
+     */
+    size_t memoryUsage() const;
+
+    /*!
+     * \brief Limit pameti v bajtech.
+     */
+    size_t limit() const;
+
+private:
+    typedef std::list<std::pair<uint64_t, std::shared_ptr<const TextureTile> > > Entries;
+
+    struct Shard {
+        Shard()
+            : memory(0)
+        {}
+
+        mutable std::mutex mutex;
+        Entries entries; ///< od naposledy pouziteho
+        std::unordered_map<uint64_t, Entries::iterator> index;
+        size_t memory;
+    };
+
+    Shard& shard(uint64_t key);
+    std::shared_ptr<const TextureTile> find(uint64_t key);
+    std::shared_ptr<const TextureTile> insert(uint64_t key, const std::shared_ptr<const TextureTile>& tile,
+                                              size_t fileBytes);
+
+private:
+    size_t memoryLimit;
+    Shard shards[TEXTURE_CACHE_SHARDS];
+
+    std::atomic<size_t> hitCount;
+    std::atomic<size_t> missCount;
+    std::atomic<size_t> loadedBytes;
+    std::atomic<size_t> evictionCount;
+};
+
+template<class Load>
+std::shared_ptr<const TextureTile> TextureCache::acquire(uint64_t key, Load load)
+{
+    std::shared_ptr<const TextureTile> tile = find(key);
+    if (tile)
+        return tile;
+
+    std::shared_ptr<TextureTile> loaded = std::make_shared<TextureTile>();
+    size_t fileBytes = 0;
+    if (!load(*loaded, fileBytes))
+        return std::shared_ptr<const TextureTile>();
+
+    return insert(key, loaded, fileBytes);
+}
+
+#endif // TEXTURECACHE_H
@@ -0,0 +1,88 @@
+#include "tile.h"
+
+#include <algorithm>
+#include <assert.h>
+
+TileGrid::TileGrid(const CropWindow& window, size_t tileSize)
+    : _window(window), _tileSize(tileSize)
+{
+    assert(tileSize > 0);
+    columns = (window.width() + tileSize - 1) / tileSize;
+    rows = (window.height() + tileSize - 1) / tileSize;
+}
+
+size_t TileGrid::count() const
+{
+    return columns * rows;
+}
+
+Tile TileGrid::tile(size_t index) const
+{
+    assert(index < count());
+
+    Tile t;
+    t.x0 = _window.x0 + (index % columns) * _tileSize;
+    t.y0 = _window.y0 + (index / columns) * _tileSize;
+    t.x1 = std::min(t.x0 + _tileSize, _window.x1);
+    t.y1 = std::min(t.y0 + _tileSize, _window.y1);
+
+    return t;
+}
+
+size_t TileGrid::index(size_t x, size_t y) const
+{
+    assert(x >= _window.x0 && x < _window.x1 && y >= _window.y0 && y < _window.y1);
+    return (y - _window.y0) / _tileSize * columns + (x - _window.x0) / _tileSize;
+}
+
+const CropWindow& TileGrid::window() const
+{
+    return _window;
+}
+
+size_t TileGrid::tileSize() const
+{
+    return _tileSize;
+}
+
+
+//TileQueues
+TileQueues::TileQueues(size_t tileCount, size_t queueCount)
+    : count(tileCount), queues(std::max<size_t>(queueCount, 1)),
+      nextTile(new std::atomic<size_t>[queues])
+{
+    for (size_t q = 0; q < queues; ++q)
+        nextTile[q] = begin(q);
+}
+
+bool TileQueues::next(size_t queue, size_t& tile, bool& stolen)
+{
+    for (size_t i = 0; i < queues; ++i) {
+        const size_t q = (queue + i) % queues;
+        if (nextTile[q].load(std::memory_order_relaxed) >= end(q))
+            continue;
+
+        tile = nextTile[q]++;
+        if (tile < end(q)) {
+            stolen = i > 0;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+size_t TileQueues::queueCount() const
+{
+    return queues;
+}
+
+size_t TileQueues::begin(size_t queue) const
+{
+    return count * queue / queues;
+}
+
+size_t TileQueues::end(size_t queue) const
+{
+    return count * (queue + 1) / queues;
+}
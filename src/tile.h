@@ -0,0 +1,130 @@
+#ifndef TILE_H
+#define TILE_H
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+/*!
+ * Obdelnik pixelu [x0, x1) x [y0, y1) na filmu.
+ */
+struct Tile {
+    size_t x0, y0; ///< levy horni roh (vcetne)
+    size_t x1, y1; ///< pravy dolni roh (bez)
+
+    size_t width() const
+    {
+        return x1 - x0;
+    }
+
+    size_t height() const
+    {
+        return y1 - y0;
+    }
+
+    size_t pixelCount() const
+    {
+        return width() * height();
+    }
+};
+
+typedef Tile CropWindow; ///< semantika
+
+typedef std::vector<std::atomic<bool> > TileFlags; ///< priznaky dokoncenych dlazdic
+
+/*!
+ * Rozdeleni vyrezu filmu na ctvercove dlazdice. Dlazdice na okraji mohou byt mensi.
+ * Poradi dlazdic je po radcich od leveho horniho rohu.
+ */
+class TileGrid
+{
+public:
+    /*!
+     * \brief Konstruktor.
+     * \param window vyrez filmu, ktery se ma renderovat
+     * \param tileSize delka hrany dlazdice v pixelech
+     */
+    TileGrid(const CropWindow& window, size_t tileSize);
+
+    /*!
+     * \brief Celkovy pocet dlazdic.
+     */
+    size_t count() const;
+
+    /*!
+     * \brief Vraci dlazdici s danym indexem.
+     * \param index index v intervalu [0, count())
+     */
+    Tile tile(size_t index) const;
+
+    /*!
+     * \brief Index dlazdice, ktera obsahuje dany pixel.
+     * \param x poloha ve vodorovnem smeru (uvnitr vyrezu)
+     * \param y poloha ve svislem smeru (uvnitr vyrezu)
+     */
+    size_t index(size_t x, size_t y) const;
+
+    /*!
+     * \brief Renderovany vyrez filmu.
+     */
+    const CropWindow& window() const;
+
+    /*!
+     * \brief Delka hrany dlazdice.
+     */
+    size_t tileSize() const;
+
+private:
+    CropWindow _window;
+    size_t _tileSize;
+    size_t columns; ///< pocet dlazdic v radku
+    size_t rows; ///< pocet radku dlazdic
+};
+
+/*!
+ * Fronty dlazdic, jedna pro kazdy NUMA uzel. Kazda fronta vlastni souvisly
+ * usek indexu dlazdic, tj. vodorovny pas obrazku. Vlakno bere dlazdice nejdrive
+ * z fronty sveho uzlu a teprve po jejim vycerpani pomaha ostatnim frontam.
+ */
+class TileQueues
+{
+public:
+    /*!
+     * \brief Konstruktor.
+     * \param tileCount pocet dlazdic
+     * \param queueCount pocet front (alespon 1)
+     */
+    TileQueues(size_t tileCount, size_t queueCount);
+
+    /*!
+     * \brief Vezme dalsi dlazdici.
+     * \param queue fronta uzlu volajiciho vlakna
+     * \param [out] tile index dlazdice
+     * \param [out] stolen dlazdice pochazi z fronty jineho uzlu
+     * \return false pokud jsou vsechny fronty prazdne
+     */
+    bool next(size_t queue, size_t& tile, bool& stolen);
+
+    /*!
+     * \brief Pocet front.
+     */
+    size_t queueCount() const;
+
+    /*!
+     * \brief Prvni dlazdice fronty.
+     */
+    size_t begin(size_t queue) const;
+
+    /*!
+     * \brief Dlazdice za posledni dlazdici fronty.
+     */
+    size_t end(size_t queue) const;
+
+private:
+    size_t count; ///< pocet dlazdic
+    size_t queues; ///< pocet front
+    std::unique_ptr<std::atomic<size_t>[]> nextTile; ///< dalsi dlazdice kazde fronty
+};
+
+#endif // TILE_H
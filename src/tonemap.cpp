@@ -0,0 +1,65 @@
+#include "tonemap.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "simd.h"
+
+namespace {
+
+const int LUT_BITS = 14; ///< presnost tabulky, staci i pro nejtmavsi odstiny sRGB
+const int LUT_SIZE = 1 << LUT_BITS;
+
+inline float srgbEncode(float v)
+{
+    return v <= 0.0031308f ? 12.92f * v : 1.055f * std::pow(v, 1.f / 2.4f) - 0.055f;
+}
+
+inline float applyCurve(ToneCurve curve, float x)
+{
+    switch (curve) {
+    case TONE_REINHARD:
+        return x / (1.f + x);
+    case TONE_ACES:
+        return (x * (2.51f * x + 0.03f)) / (x * (2.43f * x + 0.59f) + 0.14f);
+    default:
+        return x;
+    }
+}
+
+}
+
+ToneMapper::ToneMapper(const ToneMapParams& params)
+    : _params(params), scale(std::pow(2.f, params.exposure)), lut(LUT_SIZE)
+{
+    for (int i = 0; i < LUT_SIZE; ++i) {
+        float v = i / float(LUT_SIZE - 1);
+        if (params.srgb)
+            v = srgbEncode(v);
+        lut[i] = static_cast<unsigned char>(std::min(255.f, v * 255.f + 0.5f));
+    }
+}
+
+const ToneMapParams& ToneMapper::params() const
+{
+    return _params;
+}
+
+unsigned char ToneMapper::mapScalar(float v) const
+{
+    //stejne chovani jako vektorova verze: NaN na vstupu da 0, NaN z krivky da 1
+    float x = v * scale > 0.f ? v * scale : 0.f;
+    x = applyCurve(_params.curve, x);
+    x = x < 1.f ? x : 1.f;
+
+    return lut[static_cast<int>(x * (LUT_SIZE - 1) + 0.5f)];
+}
+
+void ToneMapper::map(const float* in, unsigned char* out, size_t count) const
+{
+    //vybrana SIMD varianta zpracuje nasobky sve sirky, zbytek se dopocita skalarne
+    size_t i = simdKernels().toneMap(in, out, count, scale, _params.curve, lut.data(), LUT_SIZE);
+
+    for (; i < count; ++i)
+        out[i] = mapScalar(in[i]);
+}
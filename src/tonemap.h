@@ -0,0 +1,69 @@
+#ifndef TONEMAP_H
+#define TONEMAP_H
+
+#include <cstddef>
+#include <vector>
+
+/*!
+ * Krivka pro prevod linearnich hodnot s neomezenym rozsahem do intervalu [0, 1].
+ */
+enum ToneCurve {
+    TONE_CLAMP, ///< prosty orez
+    TONE_REINHARD, ///< x / (1 + x)
+    TONE_ACES ///< aproximace filmove krivky ACES (Narkowicz)
+};
+
+/*!
+ * Parametry vystupniho zpracovani obrazu.
+ */
+struct ToneMapParams {
+    ToneMapParams()
+        : exposure(0.f), curve(TONE_CLAMP), srgb(true)
+    {}
+
+    float exposure; ///< expozice v clonovych cislech (nasobitel 2^exposure)
+    ToneCurve curve; ///< tonova krivka
+    bool srgb; ///< kodovat do sRGB (jinak linearne)
+};
+
+/*!
+ * Prevod linearnich hodnot filmu na 8bitove hodnoty vystupu.
+ * Expozice a tonova krivka se pocitaji vektorove (SSE, ctyri slozky naraz),
+ * kodovani sRGB se cte z predpocitane tabulky.
+ */
+class ToneMapper
+{
+public:
+    /*!
+     * \brief Konstruktor, predpocita tabulku kodovani.
+     * \param params parametry zpracovani
+     */
+    explicit ToneMapper(const ToneMapParams& params);
+
+    /*!
+     * \brief Prevede pole linearnich hodnot na 8bitove hodnoty.
+     * Slozky se zpracovavaji nezavisle, na poradi kanalu nezalezi.
+     * \param in vstupni hodnoty
+     * \param out vystupni hodnoty
+     * \param count pocet hodnot (ne pixelu)
+     */
+    void map(const float* in, unsigned char* out, size_t count) const;
+
+    /*!
+     * \brief Parametry zpracovani.
+     */
+    const ToneMapParams& params() const;
+
+private:
+    /*!
+     * \brief Skalarni verze pro zbytek pole.
+     */
+    unsigned char mapScalar(float v) const;
+
+private:
+    ToneMapParams _params;
+    float scale; ///< 2^exposure
+    std::vector<unsigned char> lut; ///< kodovani [0, 1] -> 0-255
+};
+
+#endif // TONEMAP_H
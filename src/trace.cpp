@@ -0,0 +1,201 @@
+#include "trace.h"
+
+#include <algorithm>
+#include <cstdio>
+
+#include <unistd.h>
+
+namespace {
+
+/*!
+ * Buffer vlakna pro naposledy pouzity zaznam. Po skonceni vlakna se buffer
+ * uvolni pro dalsi vlakno, kazdy snimek tak nealokuje nove buffery.
+ */
+struct ThreadSlot {
+    ThreadSlot()
+        : owner(0), buffer(0)
+    {}
+
+    ~ThreadSlot()
+    {
+        if (buffer)
+            buffer->active.store(false, std::memory_order_release);
+    }
+
+    const TraceRecorder* owner;
+    TraceBuffer* buffer;
+};
+
+thread_local ThreadSlot slot;
+
+void writeString(FILE* f, const std::string& s)
+{
+    fputc('"', f);
+    for (size_t i = 0; i < s.size(); ++i) {
+        if (s[i] == '"' || s[i] == '\\')
+            fputc('\\', f);
+        if (static_cast<unsigned char>(s[i]) >= 0x20)
+            fputc(s[i], f);
+    }
+    fputc('"', f);
+}
+
+}
+
+TraceBuffer::TraceBuffer()
+    : events(new TraceEvent[TRACE_BUFFER_EVENTS]), written(0), track(TRACE_NO_TRACK), active(true)
+{}
+
+TraceRecorder::TraceRecorder()
+    : start(std::chrono::steady_clock::now())
+{}
+
+uint64_t TraceRecorder::now() const
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now() - start).count();
+}
+
+void TraceRecorder::record(const TraceEvent& event)
+{
+    TraceBuffer* b = buffer();
+
+    //do bufferu pise jen jeho vlakno, citac se zvysi az po zapisu udalosti
+    const uint64_t n = b->written.load(std::memory_order_relaxed);
+    TraceEvent& e = b->events[n % TRACE_BUFFER_EVENTS];
+    e = event;
+    e.track = b->track;
+    b->written.store(n + 1, std::memory_order_release);
+}
+
+void TraceRecorder::nameThread(const std::string& name)
+{
+    TraceBuffer* b = buffer();
+
+    std::lock_guard<std::mutex> lock(mutex);
+    b->track = trackOf(name);
+}
+
+bool TraceRecorder::write(const std::string& path) const
+{
+    FILE* f = fopen(path.c_str(), "w");
+    if (!f)
+        return false;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    const int pid = getpid();
+
+    //nepojmenovana vlakna sdileji radek s ostatnimi vlakny stejneho bufferu
+    std::vector<std::string> names(tracks);
+    std::vector<uint32_t> unnamed(buffers.size(), TRACE_NO_TRACK);
+    for (size_t i = 0; i < buffers.size(); ++i) {
+        const uint64_t written = std::min<uint64_t>(buffers[i]->written.load(std::memory_order_acquire),
+                                                    TRACE_BUFFER_EVENTS);
+        for (uint64_t n = 0; n < written && unnamed[i] == TRACE_NO_TRACK; ++n) {
+            if (buffers[i]->events[n].track == TRACE_NO_TRACK) {
+                unnamed[i] = static_cast<uint32_t>(names.size());
+                names.push_back("thread " + std::to_string(i));
+            }
+        }
+    }
+
+    fprintf(f, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    fprintf(f, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":0,\"args\":{\"name\":\"raytracer\"}}",
+            pid);
+
+    for (size_t t = 0; t < names.size(); ++t) {
+        fprintf(f, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%zu,\"args\":{\"name\":",
+                pid, t);
+        writeString(f, names[t]);
+        fprintf(f, "}}");
+        fprintf(f, ",\n{\"name\":\"thread_sort_index\",\"ph\":\"M\",\"pid\":%d,\"tid\":%zu,"
+                "\"args\":{\"sort_index\":%zu}}", pid, t, t);
+    }
+
+    for (size_t i = 0; i < buffers.size(); ++i) {
+        const TraceBuffer& b = *buffers[i];
+        const uint64_t written = b.written.load(std::memory_order_acquire);
+        const uint64_t first = written > TRACE_BUFFER_EVENTS ? written - TRACE_BUFFER_EVENTS : 0;
+
+        //udalosti od nejstarsi, casy v mikrosekundach
+        for (uint64_t n = first; n < written; ++n) {
+            const TraceEvent& e = b.events[n % TRACE_BUFFER_EVENTS];
+            fprintf(f, ",\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,"
+                    "\"pid\":%d,\"tid\":%u", e.name, e.category, e.begin * 1e-3,
+                    (e.end - e.begin) * 1e-3, pid, e.track == TRACE_NO_TRACK ? unnamed[i] : e.track);
+            if (e.argName)
+                fprintf(f, ",\"args\":{\"%s\":%lld}", e.argName, static_cast<long long>(e.arg));
+            fputc('}', f);
+        }
+    }
+
+    fprintf(f, "\n]}\n");
+
+    const bool ok = ferror(f) == 0;
+    return fclose(f) == 0 && ok;
+}
+
+size_t TraceRecorder::eventCount() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    size_t count = 0;
+    for (size_t i = 0; i < buffers.size(); ++i)
+        count += std::min<uint64_t>(buffers[i]->written.load(std::memory_order_acquire), TRACE_BUFFER_EVENTS);
+
+    return count;
+}
+
+size_t TraceRecorder::droppedCount() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    size_t count = 0;
+    for (size_t i = 0; i < buffers.size(); ++i) {
+        const uint64_t written = buffers[i]->written.load(std::memory_order_acquire);
+        if (written > TRACE_BUFFER_EVENTS)
+            count += written - TRACE_BUFFER_EVENTS;
+    }
+
+    return count;
+}
+
+TraceBuffer* TraceRecorder::buffer()
+{
+    if (slot.owner == this)
+        return slot.buffer;
+
+    if (slot.buffer)
+        slot.buffer->active.store(false, std::memory_order_release);
+
+    //prvni zapis vlakna: buffer po skoncenem vlaknu, jinak novy;
+    //buffery prezivaji sva vlakna az do zapisu souboru
+    std::lock_guard<std::mutex> lock(mutex);
+    slot.owner = this;
+    slot.buffer = 0;
+    for (size_t i = 0; i < buffers.size() && !slot.buffer; ++i) {
+        if (!buffers[i]->active.load(std::memory_order_acquire)) {
+            slot.buffer = buffers[i].get();
+            slot.buffer->active.store(true, std::memory_order_relaxed);
+            slot.buffer->track = TRACE_NO_TRACK;
+        }
+    }
+
+    if (!slot.buffer) {
+        buffers.push_back(std::unique_ptr<TraceBuffer>(new TraceBuffer()));
+        slot.buffer = buffers.back().get();
+    }
+
+    return slot.buffer;
+}
+
+uint32_t TraceRecorder::trackOf(const std::string& name)
+{
+    for (size_t i = 0; i < tracks.size(); ++i) {
+        if (tracks[i] == name)
+            return static_cast<uint32_t>(i);
+    }
+
+    tracks.push_back(name);
+    return static_cast<uint32_t>(tracks.size() - 1);
+}
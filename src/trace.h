@@ -0,0 +1,158 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+/*!
+ * \file
+ * Zaznam casove osy renderu ve formatu Chrome trace event.\n
+ * Kazde vlakno zapisuje udalosti (zacatek a konec useku) do vlastniho
+ * kruhoveho bufferu pevne velikosti, zapis tedy nepotrebuje zamek ani
+ * alokaci. Pri zaplneni se prepisuji nejstarsi udalosti. Vysledny JSON
+ * lze otevrit v about://tracing nebo v Perfettu (ui.perfetto.dev).
+ */
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+const size_t TRACE_BUFFER_EVENTS = 1 << 16; ///< kapacita kruhoveho bufferu jednoho vlakna
+const uint32_t TRACE_NO_TRACK = ~0u; ///< vlakno nema pojmenovany radek
+
+/*!
+ * Jeden dokonceny usek. Jmena musi byt retezcove literaly, aby zapis
+ * nekopiroval data.
+ */
+struct TraceEvent {
+    const char* name; ///< nazev useku
+    const char* category; ///< kategorie (filtr v prohlizeci)
+    const char* argName; ///< nazev ciselneho argumentu (0 = bez argumentu)
+    int64_t arg; ///< hodnota argumentu, napr. index dlazdice
+    uint32_t track; ///< radek vlakna, vyplni TraceRecorder::record
+    uint64_t begin; ///< zacatek v ns od vytvoreni zaznamu
+    uint64_t end; ///< konec v ns od vytvoreni zaznamu
+};
+
+/*!
+ * Kruhovy buffer udalosti jednoho vlakna. Po skonceni vlakna ho prevezme
+ * dalsi nove vlakno.
+ */
+struct TraceBuffer {
+    TraceBuffer();
+
+    std::unique_ptr<TraceEvent[]> events; ///< TRACE_BUFFER_EVENTS udalosti
+    std::atomic<uint64_t> written; ///< pocet vsech zapsanych udalosti
+    uint32_t track; ///< pojmenovany radek vlakna (tid), jinak TRACE_NO_TRACK
+    std::atomic<bool> active; ///< buffer patri zijicimu vlaknu
+};
+
+/*!
+ * Zaznam casove osy vsech vlaken.
+ */
+class TraceRecorder
+{
+public:
+    TraceRecorder();
+
+    /*!
+     * \brief Cas od vytvoreni zaznamu v ns.
+     */
+    uint64_t now() const;
+
+    /*!
+     * \brief Prida dokonceny usek do bufferu volajiciho vlakna.
+     */
+    void record(const TraceEvent& event);
+
+    /*!
+     * \brief Pojmenuje radek volajiciho vlakna. Vlakna se stejnym jmenem
+     * (napr. "worker 0" v kazdem snimku) sdileji jeden radek.
+     */
+    void nameThread(const std::string& name);
+
+    /*!
+     * \brief Zapise vsechny udalosti jako Chrome trace JSON.
+     * Vlakna, ktera zapisuji, musi byt v tu chvili dokoncena.
+     * \param path cilovy soubor
+     * \return true pri uspechu
+     */
+    bool write(const std::string& path) const;
+
+    /*!
+     * \brief Pocet zaznamenanych udalosti ve vsech bufferech.
+     */
+    size_t eventCount() const;
+
+    /*!
+     * \brief Pocet udalosti prepsanych pri zaplneni bufferu.
+     */
+    size_t droppedCount() const;
+
+private:
+    TraceRecorder(const TraceRecorder&);
+    TraceRecorder& operator =(const TraceRecorder&);
+
+    TraceBuffer* buffer();
+    uint32_t trackOf(const std::string& name);
+
+private:
+    const std::chrono::steady_clock::time_point start;
+
+    mutable std::mutex mutex; ///< chrani seznam bufferu a jmena radku
+    std::vector<std::unique_ptr<TraceBuffer> > buffers; ///< buffery vsech vlaken, ktera kdy zapisovala
+    std::vector<std::string> tracks; ///< jmena radku, index je tid
+};
+
+/*!
+ * Usek od vytvoreni do zniceni objektu. Bez zaznamu nic nemeri.
+ */
+class TraceScope
+{
+public:
+    /*!
+     * \brief Zacne usek.
+     * \param recorder zaznam casove osy (0 = nezaznamenavat)
+     * \param name nazev useku (retezcovy literal)
+     * \param category kategorie useku (retezcovy literal)
+     * \param argName nazev argumentu (0 = bez argumentu)
+     * \param arg hodnota argumentu
+     */
+    TraceScope(TraceRecorder* recorder, const char* name, const char* category,
+               const char* argName = 0, int64_t arg = 0)
+        : recorder(recorder)
+    {
+        if (!recorder)
+            return;
+
+        event.name = name;
+        event.category = category;
+        event.argName = argName;
+        event.arg = arg;
+        event.begin = recorder->now();
+    }
+
+    /*!
+     * \brief Ukonci usek a zapise ho.
+     */
+    ~TraceScope()
+    {
+        if (!recorder)
+            return;
+
+        event.end = recorder->now();
+        recorder->record(event);
+    }
+
+private:
+    TraceScope(const TraceScope&);
+    TraceScope& operator =(const TraceScope&);
+
+private:
+    TraceRecorder* recorder;
+    TraceEvent event;
+};
+
+#endif // TRACE_H
@@ -0,0 +1,172 @@
+#include "transform.h"
+
+#include <cstring>
+
+namespace {
+
+void identity(float m[4][4])
+{
+    for (int i = 0; i < 4; ++i) {
+        for (int j = 0; j < 4; ++j)
+            m[i][j] = i == j ? 1.f : 0.f;
+    }
+}
+
+void multiply(const float a[4][4], const float b[4][4], float r[4][4])
+{
+    for (int i = 0; i < 4; ++i) {
+        for (int j = 0; j < 4; ++j) {
+            r[i][j] = a[i][0] * b[0][j] + a[i][1] * b[1][j]
+                      + a[i][2] * b[2][j] + a[i][3] * b[3][j];
+        }
+    }
+}
+
+}
+
+Transform::Transform()
+{
+    identity(m);
+    identity(mInv);
+}
+
+Transform::Transform(const float m[4][4], const float mInv[4][4])
+{
+    memcpy(this->m, m, sizeof(this->m));
+    memcpy(this->mInv, mInv, sizeof(this->mInv));
+}
+
+Transform Transform::translate(const Vector& delta)
+{
+    float m[4][4], mInv[4][4];
+    identity(m);
+    identity(mInv);
+
+    for (int i = 0; i < 3; ++i) {
+        m[i][3] = delta[i];
+        mInv[i][3] = -delta[i];
+    }
+
+    return Transform(m, mInv);
+}
+
+Transform Transform::scale(float x, float y, float z)
+{
+    float m[4][4], mInv[4][4];
+    identity(m);
+    identity(mInv);
+
+    m[0][0] = x;
+    m[1][1] = y;
+    m[2][2] = z;
+    mInv[0][0] = 1.f / x;
+    mInv[1][1] = 1.f / y;
+    mInv[2][2] = 1.f / z;
+
+    return Transform(m, mInv);
+}
+
+Transform Transform::rotate(float angle, const Vector& axis)
+{
+    Vector a(axis);
+    a.normalize();
+
+    const float rad = angle * float(M_PI) / 180.f;
+    const float s = std::sin(rad);
+    const float c = std::cos(rad);
+
+    float m[4][4];
+    identity(m);
+
+    m[0][0] = a.x * a.x + (1.f - a.x * a.x) * c;
+    m[0][1] = a.x * a.y * (1.f - c) - a.z * s;
+    m[0][2] = a.x * a.z * (1.f - c) + a.y * s;
+    m[1][0] = a.x * a.y * (1.f - c) + a.z * s;
+    m[1][1] = a.y * a.y + (1.f - a.y * a.y) * c;
+    m[1][2] = a.y * a.z * (1.f - c) - a.x * s;
+    m[2][0] = a.x * a.z * (1.f - c) - a.y * s;
+    m[2][1] = a.y * a.z * (1.f - c) + a.x * s;
+    m[2][2] = a.z * a.z + (1.f - a.z * a.z) * c;
+
+    //inverze rotace je transpozice
+    float mInv[4][4];
+    for (int i = 0; i < 4; ++i) {
+        for (int j = 0; j < 4; ++j)
+            mInv[i][j] = m[j][i];
+    }
+
+    return Transform(m, mInv);
+}
+
+Transform Transform::operator *(const Transform& t) const
+{
+    float r[4][4], rInv[4][4];
+    multiply(m, t.m, r);
+    multiply(t.mInv, mInv, rInv);
+
+    return Transform(r, rInv);
+}
+
+Transform Transform::inverse() const
+{
+    return Transform(mInv, m);
+}
+
+bool Transform::isIdentity() const
+{
+    for (int i = 0; i < 4; ++i) {
+        for (int j = 0; j < 4; ++j) {
+            if (m[i][j] != (i == j ? 1.f : 0.f))
+                return false;
+        }
+    }
+
+    return true;
+}
+
+Point Transform::operator()(const Point& p) const
+{
+    return Point(m[0][0] * p.x + m[0][1] * p.y + m[0][2] * p.z + m[0][3],
+                 m[1][0] * p.x + m[1][1] * p.y + m[1][2] * p.z + m[1][3],
+                 m[2][0] * p.x + m[2][1] * p.y + m[2][2] * p.z + m[2][3]);
+}
+
+Vector Transform::operator()(const Vector& v) const
+{
+    return Vector(m[0][0] * v.x + m[0][1] * v.y + m[0][2] * v.z,
+                  m[1][0] * v.x + m[1][1] * v.y + m[1][2] * v.z,
+                  m[2][0] * v.x + m[2][1] * v.y + m[2][2] * v.z);
+}
+
+Normal Transform::operator()(const Normal& n) const
+{
+    return Normal(mInv[0][0] * n.x + mInv[1][0] * n.y + mInv[2][0] * n.z,
+                  mInv[0][1] * n.x + mInv[1][1] * n.y + mInv[2][1] * n.z,
+                  mInv[0][2] * n.x + mInv[1][2] * n.y + mInv[2][2] * n.z);
+}
+
+BBox Transform::operator()(const BBox& b) const
+{
+    BBox r;
+    if (b.isEmpty())
+        return r;
+
+    for (int i = 0; i < 8; ++i) {
+        Point corner(i & 1 ? b.pMax.x : b.pMin.x,
+                     i & 2 ? b.pMax.y : b.pMin.y,
+                     i & 4 ? b.pMax.z : b.pMin.z);
+        r.expand((*this)(corner));
+    }
+
+    return r;
+}
+
+Ray Transform::operator()(const Ray& r) const
+{
+    return Ray((*this)(r.o), (*this)(r.d), r.mint, r.maxt, r.depth);
+}
+
+TraversalRay Transform::operator()(const TraversalRay& r) const
+{
+    return TraversalRay((*this)(r.o), (*this)(r.d), r.tMin, r.tMax);
+}
@@ -0,0 +1,93 @@
+#ifndef TRANSFORM_H
+#define TRANSFORM_H
+
+/*!
+ * \file
+ */
+
+#include "core.h"
+
+#include "geometry.h"
+
+/*!
+ * Afinni transformace prostoru.\n
+ * Uchovava matici i jeji inverzi, takze prevod paprsku do prostoru objektu
+ * ani transformace normal nevyzaduji pocitani inverze za behu.
+ */
+class Transform
+{
+public:
+    /*!
+     * Defaultni konstruktor, vytvori identitu.
+     */
+    Transform();
+
+    /*!
+     * Konstruktor z matice a jeji inverze.
+     * \param m matice 4x4 po radcich
+     * \param mInv inverzni matice
+     */
+    Transform(const float m[4][4], const float mInv[4][4]);
+
+    /*!
+     * Posunuti o vektor.
+     */
+    static Transform translate(const Vector& delta);
+
+    /*!
+     * Zmena meritka v jednotlivych osach.
+     */
+    static Transform scale(float x, float y, float z);
+
+    /*!
+     * Rotace kolem osy prochazejici pocatkem.
+     * \param angle uhel ve stupnich
+     * \param axis osa rotace
+     */
+    static Transform rotate(float angle, const Vector& axis);
+
+    /*!
+     * Skladani transformaci, vysledek nejdrive aplikuje t a potom this.
+     */
+    Transform operator *(const Transform& t) const;
+
+    /*!
+     * Inverzni transformace.
+     */
+    Transform inverse() const;
+
+    /*!
+     * Je transformace identita?
+     */
+    bool isIdentity() const;
+
+    Point operator()(const Point& p) const;
+    Vector operator()(const Vector& v) const;
+
+    /*!
+     * Normaly se transformuji transponovanou inverzi, vysledek neni normalizovan.
+     */
+    Normal operator()(const Normal& n) const;
+
+    /*!
+     * Obalovy kvadr transformovaneho kvadru (vsech osm rohu).
+     */
+    BBox operator()(const BBox& b) const;
+
+    /*!
+     * Paprsek s transformovanym pocatkem i smerem. Smer se nenormalizuje,
+     * takze parametr t zustava v obou prostorech stejny.
+     */
+    Ray operator()(const Ray& r) const;
+
+    /*!
+     * Pruchodovy paprsek v cilovem prostoru, meze parametru t se zachovaji.
+     */
+    TraversalRay operator()(const TraversalRay& r) const;
+
+private:
+    float m[4][4]; ///< matice transformace
+    float mInv[4][4]; ///< inverzni matice
+};
+
+#endif // TRANSFORM_H
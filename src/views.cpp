@@ -0,0 +1,136 @@
+#include "views.h"
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+#include "imageio.h"
+
+namespace {
+
+/*!
+ * \brief Osy u (doprava) a v (dolu) obrazu pohledu, stejne jako v Camera.
+ */
+void viewBasis(const RenderJob& view, Vector& u, Vector& v)
+{
+    Vector w = view.eye - view.target;
+    w.normalize();
+    u = cross(view.up, w);
+    u.normalize();
+    v = cross(u, w);
+    v.normalize();
+}
+
+/*!
+ * \brief Pohled posunuty o offset, smer pohledu se nemeni.
+ */
+RenderJob shifted(const RenderJob& base, const Vector& offset, const std::string& suffix)
+{
+    RenderJob view = base;
+    view.eye = base.eye + offset;
+    view.target = base.target + offset;
+    view.output = derivedPath(base.output, suffix);
+    return view;
+}
+
+}
+
+bool loadViews(const std::string& path, std::vector<RenderJob>& views, std::string& error)
+{
+    std::ifstream ifs(path);
+    if (!ifs) {
+        error = "nelze otevrit " + path;
+        return false;
+    }
+
+    std::string line;
+    for (size_t number = 1; std::getline(ifs, line); ++number) {
+        const size_t first = line.find_first_not_of(" \t\r");
+        if (first == std::string::npos || line[first] == '#')
+            continue;
+
+        std::ostringstream where;
+        where << path << ":" << number << ": ";
+
+        RenderJob view;
+        std::string message;
+        if (!parseJob(line, view, message)) {
+            error = where.str() + message;
+            return false;
+        }
+        if (!view.scene.empty() || view.spp != 0) {
+            error = where.str() + "scena a pocet vzorku plati pro celou davku";
+            return false;
+        }
+
+        views.push_back(view);
+    }
+
+    if (views.empty()) {
+        error = path + " neobsahuje zadny pohled";
+        return false;
+    }
+
+    return true;
+}
+
+std::vector<RenderJob> stereoViews(const RenderJob& base, float separation)
+{
+    Vector u, v;
+    viewBasis(base, u, v);
+
+    std::vector<RenderJob> views;
+    views.push_back(shifted(base, u * (-0.5f * separation), "left.ppm"));
+    views.push_back(shifted(base, u * (0.5f * separation), "right.ppm"));
+    return views;
+}
+
+std::vector<RenderJob> cubemapViews(const RenderJob& base)
+{
+    static const struct {
+        const char* name;
+        float dir[3];
+        float up[3];
+    } faces[6] = {
+        { "px", { 1.f, 0.f, 0.f }, { 0.f, 1.f, 0.f } },
+        { "nx", { -1.f, 0.f, 0.f }, { 0.f, 1.f, 0.f } },
+        { "py", { 0.f, 1.f, 0.f }, { 0.f, 0.f, -1.f } },
+        { "ny", { 0.f, -1.f, 0.f }, { 0.f, 0.f, 1.f } },
+        { "pz", { 0.f, 0.f, 1.f }, { 0.f, 1.f, 0.f } },
+        { "nz", { 0.f, 0.f, -1.f }, { 0.f, 1.f, 0.f } }
+    };
+
+    std::vector<RenderJob> views;
+    for (size_t i = 0; i < 6; ++i) {
+        RenderJob view = base;
+        view.target = base.eye + Vector(faces[i].dir[0], faces[i].dir[1], faces[i].dir[2]);
+        view.up = Vector(faces[i].up[0], faces[i].up[1], faces[i].up[2]);
+        view.fov = 90.f;
+        view.height = base.width;
+        view.output = derivedPath(base.output, std::string(faces[i].name) + ".ppm");
+        views.push_back(view);
+    }
+
+    return views;
+}
+
+std::vector<RenderJob> cameraArrayViews(const RenderJob& base, size_t columns, size_t rows, float spacing)
+{
+    Vector u, v;
+    viewBasis(base, u, v);
+
+    std::vector<RenderJob> views;
+    for (size_t r = 0; r < rows; ++r) {
+        for (size_t c = 0; c < columns; ++c) {
+            const float x = (c - 0.5f * (columns - 1)) * spacing;
+            const float y = (r - 0.5f * (rows - 1)) * spacing;
+
+            //dva size_t az po 20 cislicich, "_", ".ppm" a koncova nula
+            char suffix[48];
+            snprintf(suffix, sizeof(suffix), "%02zu_%02zu.ppm", r, c);
+            views.push_back(shifted(base, u * x + v * y, suffix));
+        }
+    }
+
+    return views;
+}
@@ -0,0 +1,61 @@
+#ifndef VIEWS_H
+#define VIEWS_H
+
+/*!
+ * \file
+ * Davky pohledu pro render vice kamer nad jednou sdilenou scenou:
+ * seznam kamer ze souboru, stereo par, krychlova mapa a pole kamer
+ * (svetelne pole). Pohled se popisuje stejne jako uloha serveru
+ * (viz RenderJob), pouziva se jen kamera, rozliseni a vystupni obrazek.
+ *
+ * Soubor pohledu ma na kazdem radku jeden pohled, prazdne radky
+ * a radky zacinajici znakem # se preskakuji:
+ * \code
+ * output=left.ppm eye=4.9,5,5 target=-0.1,0,0
+ * output=right.ppm eye=5.1,5,5 target=0.1,0,0 width=400 height=400
+ * \endcode
+ */
+
+#include <string>
+#include <vector>
+
+#include "server.h"
+
+/*!
+ * \brief Nacte pohledy ze souboru.
+ * Kazdy pohled musi mit vystupni obrazek, scena a pocet vzorku plati
+ * pro celou davku a na radku je nelze zadat.
+ * \param path cesta k souboru
+ * \param [out] views nactene pohledy
+ * \param [out] error popis chyby
+ * \return false pokud soubor nelze precist nebo obsahuje neplatny radek
+ */
+bool loadViews(const std::string& path, std::vector<RenderJob>& views, std::string& error);
+
+/*!
+ * \brief Stereo par s rovnobeznymi osami (output.left.ppm a output.right.ppm).
+ * \param base stredni pohled
+ * \param separation vzdalenost oci ve smeru osy u kamery
+ */
+std::vector<RenderJob> stereoViews(const RenderJob& base, float separation);
+
+/*!
+ * \brief Sest sten krychlove mapy z mista pozorovatele zakladniho pohledu
+ * (output.px.ppm, output.nx.ppm, ... output.nz.ppm). Steny jsou ctvercove
+ * se zornym uhlem 90 stupnu, bocni steny maji nahoru +Y, horni stena -Z
+ * a dolni +Z.
+ * \param base zakladni pohled, pouzije se poloha oka a sirka
+ */
+std::vector<RenderJob> cubemapViews(const RenderJob& base);
+
+/*!
+ * \brief Pravidelne pole kamer v rovine kolme na smer pohledu, vsechny
+ * s rovnobeznymi osami (output.RR_SS.ppm, radky shora).
+ * \param base stredni pohled
+ * \param columns pocet kamer v radku
+ * \param rows pocet radku
+ * \param spacing vzdalenost sousednich kamer
+ */
+std::vector<RenderJob> cameraArrayViews(const RenderJob& base, size_t columns, size_t rows, float spacing);
+
+#endif // VIEWS_H